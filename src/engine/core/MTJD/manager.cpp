@@ -25,6 +25,7 @@ struct ManagerImpl : public Manager
 		, m_worker_tasks(allocator)
 		, m_allocator(allocator)
 		, m_pending_trans(allocator)
+		, m_blocked_job(nullptr)
 	{
 #if TYPE == MULTI_THREAD
 		uint32 threads_num = getCpuThreadsCount();
@@ -106,22 +107,20 @@ struct ManagerImpl : public Manager
 #endif // TYPE == MULTI_THREAD
 	}
 
-	void scheduleCpu(Job* job)
+	// returns false when all transactions are in flight, the job must be retried later
+	bool scheduleCpu(Job* job)
 	{
 		JobTrans* tr = m_trans_queue.alloc(false);
-		if (tr)
+		if (!tr) return false;
+
+		tr->data = job;
+		if (!m_trans_queue.push(tr, false))
 		{
-			tr->data = job;
-			if (!m_trans_queue.push(tr, false))
-			{
-				m_trans_queue.dealoc(tr);
-				pushReadyJob(job);
-			}
-			else
-			{
-				m_pending_trans.push(tr);
-			}
+			m_trans_queue.dealoc(tr);
+			return false;
 		}
+		m_pending_trans.push(tr);
+		return true;
 	}
 
 	void doScheduling()
@@ -148,10 +147,18 @@ struct ManagerImpl : public Manager
 					}
 				}
 
-				Job* job = getNextReadyJob();
-				if (job)
+				// a job which did not fit is kept aside and retried before the ready queue,
+				// the next finished transaction calls doScheduling again
+				Job* job = m_blocked_job ? m_blocked_job : getNextReadyJob();
+				m_blocked_job = nullptr;
+				while (job)
 				{
-					scheduleCpu(job);
+					if (!scheduleCpu(job))
+					{
+						m_blocked_job = job;
+						break;
+					}
+					job = getNextReadyJob();
 				}
 
 				count = MT::atomicDecrement(&m_scheduling_counter);
@@ -211,6 +218,7 @@ struct ManagerImpl : public Manager
 	JobsTable			m_ready_to_execute[(size_t)Priority::Count];
 	JobTransQueue		m_trans_queue;
 	TransTable			m_pending_trans;
+	Job*				m_blocked_job;
 	Array<WorkerTask*>	m_worker_tasks;
 	Scheduler			m_scheduler;
 
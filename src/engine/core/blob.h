@@ -49,6 +49,7 @@ namespace Lumix
 			const void* skip(int size);
 			const void* getData() const { return (const void*)m_data; }
 			int getSize() const { return m_size; }
+			int getPosition() const { return m_pos; }
 			void setPosition(int pos) { m_pos = pos; }
 			void rewind() { m_pos = 0; }
 
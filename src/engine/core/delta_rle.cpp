@@ -0,0 +1,121 @@
+#include "core/delta_rle.h"
+
+
+namespace Lumix
+{
+
+
+// packets start with a control byte, < 128 means that many + 1 literal bytes follow,
+// otherwise the next byte is repeated control - 125 times
+static const int MAX_LITERALS = 128;
+static const int MIN_RUN = 3;
+static const int MAX_RUN = 255 - 125;
+
+
+namespace
+{
+
+
+// differences are visited byte plane by byte plane, pixel by pixel
+struct DeltaReader
+{
+	uint8 get(int index) const
+	{
+		int plane = index / pixel_count;
+		int pixel = index % pixel_count;
+		int offset = pixel * stride + plane;
+		return pixel > 0 ? uint8(data[offset] - data[offset - stride]) : data[offset];
+	}
+
+	const uint8* data;
+	int stride;
+	int pixel_count;
+};
+
+
+} // anonymous namespace
+
+
+void compressDeltaRLE(const uint8* data, int size, int stride, Array<uint8>& out)
+{
+	ASSERT(stride > 0 && size % stride == 0);
+	out.clear();
+	DeltaReader reader = {data, stride, size / stride};
+
+	int i = 0;
+	while (i < size)
+	{
+		uint8 value = reader.get(i);
+		int run = 1;
+		while (i + run < size && run < MAX_RUN && reader.get(i + run) == value) ++run;
+		if (run >= MIN_RUN)
+		{
+			out.push(uint8(run + 125));
+			out.push(value);
+			i += run;
+			continue;
+		}
+
+		int control_index = out.size();
+		out.push(0);
+		int literals = 0;
+		while (i < size && literals < MAX_LITERALS)
+		{
+			uint8 literal = reader.get(i);
+			if (i + 2 < size && reader.get(i + 1) == literal && reader.get(i + 2) == literal) break;
+			out.push(literal);
+			++literals;
+			++i;
+		}
+		out[control_index] = uint8(literals - 1);
+	}
+}
+
+
+bool decompressDeltaRLE(const uint8* data, int size, int stride, uint8* out, int out_size)
+{
+	if (stride <= 0 || out_size % stride != 0) return false;
+
+	int pixel_count = out_size / stride;
+	int out_index = 0;
+	auto put = [&](uint8 delta)
+	{
+		int plane = out_index / pixel_count;
+		int pixel = out_index % pixel_count;
+		int offset = pixel * stride + plane;
+		out[offset] = pixel > 0 ? uint8(out[offset - stride] + delta) : delta;
+		++out_index;
+	};
+
+	int i = 0;
+	while (i < size)
+	{
+		int control = data[i];
+		++i;
+		if (control < MAX_LITERALS)
+		{
+			int count = control + 1;
+			if (i + count > size || out_index + count > out_size) return false;
+			for (int j = 0; j < count; ++j)
+			{
+				put(data[i + j]);
+			}
+			i += count;
+		}
+		else
+		{
+			int count = control - 125;
+			if (i >= size || out_index + count > out_size) return false;
+			uint8 value = data[i];
+			++i;
+			for (int j = 0; j < count; ++j)
+			{
+				put(value);
+			}
+		}
+	}
+	return out_index == out_size;
+}
+
+
+} // namespace Lumix
@@ -0,0 +1,24 @@
+#pragma once
+
+
+#include "lumix.h"
+#include "core/array.h"
+
+
+namespace Lumix
+{
+
+
+// Lossless codec for smooth images such as heightmaps. Each byte of a pixel is replaced by its
+// difference to the same byte of the previous pixel, the differences are grouped by byte and
+// runs of equal ones are run-length encoded. stride is the size of a pixel in bytes.
+LUMIX_ENGINE_API void compressDeltaRLE(const uint8* data, int size, int stride, Array<uint8>& out);
+// returns false if data is malformed or does not decode to exactly out_size bytes
+LUMIX_ENGINE_API bool decompressDeltaRLE(const uint8* data,
+	int size,
+	int stride,
+	uint8* out,
+	int out_size);
+
+
+} // namespace Lumix
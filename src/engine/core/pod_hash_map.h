@@ -431,6 +431,8 @@ namespace Lumix
 
 		iterator find(const key_type& key) { return iterator(_find(key), this); }
 
+		const_iterator find(const key_type& key) const { return const_iterator(_find(key), this); }
+
 		value_type& at(const key_type& key)
 		{
 			node_type* n = _find(key);
@@ -601,6 +603,18 @@ namespace Lumix
 			return &m_sentinel;
 		}
 
+		const node_type* _find(const key_type& key) const
+		{
+			size_type pos = getPosition(key);
+			for(const node_type* n = &m_table[pos]; nullptr != n && &m_sentinel != n->m_next; n = n->m_next)
+			{
+				if(n->m_key == key)
+					return n;
+			}
+
+			return &m_sentinel;
+		}
+
 		void deleteNode(node_type*& n, node_type* prev)
 		{
 			if(nullptr == prev)
@@ -0,0 +1,66 @@
+#include "core/radix_sort.h"
+#include "core/string.h"
+
+
+namespace Lumix
+{
+
+
+void radixSort(uint64* keys, int* values, uint64* tmp_keys, int* tmp_values, int size)
+{
+	if (size < 2) return;
+
+	int histograms[8][256];
+	setMemory(histograms, 0, sizeof(histograms));
+	for (int i = 0; i < size; ++i)
+	{
+		uint64 key = keys[i];
+		for (int pass = 0; pass < 8; ++pass)
+		{
+			++histograms[pass][(key >> (pass * 8)) & 0xff];
+		}
+	}
+
+	uint64* LUMIX_RESTRICT src_keys = keys;
+	int* LUMIX_RESTRICT src_values = values;
+	uint64* LUMIX_RESTRICT dst_keys = tmp_keys;
+	int* LUMIX_RESTRICT dst_values = tmp_values;
+	for (int pass = 0; pass < 8; ++pass)
+	{
+		int* histogram = histograms[pass];
+		int shift = pass * 8;
+		// all keys share this byte, the pass would not change the order
+		if (histogram[(src_keys[0] >> shift) & 0xff] == size) continue;
+
+		int offset = 0;
+		for (int i = 0; i < 256; ++i)
+		{
+			int count = histogram[i];
+			histogram[i] = offset;
+			offset += count;
+		}
+
+		for (int i = 0; i < size; ++i)
+		{
+			int dst = histogram[(src_keys[i] >> shift) & 0xff]++;
+			dst_keys[dst] = src_keys[i];
+			dst_values[dst] = src_values[i];
+		}
+
+		uint64* tmp_k = src_keys;
+		src_keys = dst_keys;
+		dst_keys = tmp_k;
+		int* tmp_v = src_values;
+		src_values = dst_values;
+		dst_values = tmp_v;
+	}
+
+	if (src_keys != keys)
+	{
+		copyMemory(keys, src_keys, sizeof(keys[0]) * size);
+		copyMemory(values, src_values, sizeof(values[0]) * size);
+	}
+}
+
+
+} // namespace Lumix
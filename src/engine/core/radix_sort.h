@@ -0,0 +1,20 @@
+#pragma once
+
+
+#include "lumix.h"
+
+
+namespace Lumix
+{
+
+
+// Stable LSD radix sort of 64-bit keys with an int payload. tmp_keys and tmp_values must
+// hold size elements each; the sorted result is always returned in keys and values.
+LUMIX_ENGINE_API void radixSort(uint64* keys,
+	int* values,
+	uint64* tmp_keys,
+	int* tmp_values,
+	int size);
+
+
+} // namespace Lumix
@@ -0,0 +1,193 @@
+#pragma once
+
+
+#include "lumix.h"
+#include <emmintrin.h>
+#include <xmmintrin.h>
+
+
+namespace Lumix
+{
+
+
+typedef __m128 float4;
+typedef __m128i int4;
+
+
+LUMIX_FORCE_INLINE float4 f4LoadUnaligned(const void* src)
+{
+	return _mm_loadu_ps((const float*)src);
+}
+
+
+LUMIX_FORCE_INLINE void f4StoreUnaligned(void* dest, float4 value)
+{
+	_mm_storeu_ps((float*)dest, value);
+}
+
+
+LUMIX_FORCE_INLINE float4 f4Splat(float value)
+{
+	return _mm_set_ps1(value);
+}
+
+
+LUMIX_FORCE_INLINE float4 f4Set(float x, float y, float z, float w)
+{
+	return _mm_set_ps(w, z, y, x);
+}
+
+
+LUMIX_FORCE_INLINE float4 f4Add(float4 a, float4 b)
+{
+	return _mm_add_ps(a, b);
+}
+
+
+LUMIX_FORCE_INLINE float4 f4Sub(float4 a, float4 b)
+{
+	return _mm_sub_ps(a, b);
+}
+
+
+LUMIX_FORCE_INLINE float4 f4Mul(float4 a, float4 b)
+{
+	return _mm_mul_ps(a, b);
+}
+
+
+LUMIX_FORCE_INLINE float4 f4Div(float4 a, float4 b)
+{
+	return _mm_div_ps(a, b);
+}
+
+
+LUMIX_FORCE_INLINE float4 f4Sqrt(float4 a)
+{
+	return _mm_sqrt_ps(a);
+}
+
+
+LUMIX_FORCE_INLINE float4 f4Min(float4 a, float4 b)
+{
+	return _mm_min_ps(a, b);
+}
+
+
+LUMIX_FORCE_INLINE float4 f4Max(float4 a, float4 b)
+{
+	return _mm_max_ps(a, b);
+}
+
+
+LUMIX_FORCE_INLINE float4 f4CmpLT(float4 a, float4 b)
+{
+	return _mm_cmplt_ps(a, b);
+}
+
+
+LUMIX_FORCE_INLINE float4 f4CmpGT(float4 a, float4 b)
+{
+	return _mm_cmpgt_ps(a, b);
+}
+
+
+// per lane mask ? if_true : if_false, mask lanes must be all ones or all zeros
+LUMIX_FORCE_INLINE float4 f4Select(float4 mask, float4 if_true, float4 if_false)
+{
+	return _mm_or_ps(_mm_and_ps(mask, if_true), _mm_andnot_ps(mask, if_false));
+}
+
+
+// bit i is set if the sign bit of lane i is set, i.e. a lane of a comparison result is true
+LUMIX_FORCE_INLINE int f4MoveMask(float4 a)
+{
+	return _mm_movemask_ps(a);
+}
+
+
+LUMIX_FORCE_INLINE int4 f4ToInt4(float4 a)
+{
+	return _mm_cvttps_epi32(a);
+}
+
+
+LUMIX_FORCE_INLINE float4 i4ToFloat4(int4 a)
+{
+	return _mm_cvtepi32_ps(a);
+}
+
+
+LUMIX_FORCE_INLINE void i4StoreUnaligned(void* dest, int4 value)
+{
+	_mm_storeu_si128((int4*)dest, value);
+}
+
+
+LUMIX_FORCE_INLINE int4 i4Add(int4 a, int4 b)
+{
+	return _mm_add_epi32(a, b);
+}
+
+
+// zero extends 4 consecutive uint16 values to int32 lanes
+LUMIX_FORCE_INLINE int4 i4LoadU16(const uint16* src)
+{
+	return _mm_unpacklo_epi16(_mm_loadl_epi64((const int4*)src), _mm_setzero_si128());
+}
+
+
+// stores the low 16 bits of each lane as 4 consecutive uint16 values
+LUMIX_FORCE_INLINE void i4StoreU16(uint16* dest, int4 value)
+{
+	// sign extending the low halves keeps packs_epi32 from saturating them
+	int4 low = _mm_srai_epi32(_mm_slli_epi32(value, 16), 16);
+	_mm_storel_epi64((int4*)dest, _mm_packs_epi32(low, low));
+}
+
+
+// 8 uint16 lanes set to value
+LUMIX_FORCE_INLINE int4 i4SplatU16(uint16 value)
+{
+	return _mm_set1_epi16((short)value);
+}
+
+
+// loads 4 packed xyz triplets (12 floats) and splits them into one register per component
+LUMIX_FORCE_INLINE void f4LoadXYZ(const float* src, float4& x, float4& y, float4& z)
+{
+	float4 a = _mm_loadu_ps(src); // x0 y0 z0 x1
+	float4 b = _mm_loadu_ps(src + 4); // y1 z1 x2 y2
+	float4 c = _mm_loadu_ps(src + 8); // z2 x3 y3 z3
+
+	x = _mm_shuffle_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 3, 0)),
+		_mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2)),
+		_MM_SHUFFLE(2, 0, 1, 0));
+	y = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)),
+		_mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)),
+		_MM_SHUFFLE(2, 0, 2, 0));
+	z = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)),
+		_mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 3, 0)),
+		_MM_SHUFFLE(1, 0, 2, 0));
+}
+
+
+// inverse of f4LoadXYZ
+LUMIX_FORCE_INLINE void f4StoreXYZ(float* dest, float4 x, float4 y, float4 z)
+{
+	float4 a = _mm_shuffle_ps(_mm_shuffle_ps(x, y, _MM_SHUFFLE(0, 0, 0, 0)),
+		_mm_shuffle_ps(z, x, _MM_SHUFFLE(1, 1, 0, 0)),
+		_MM_SHUFFLE(2, 0, 2, 0));
+	float4 b = _mm_shuffle_ps(_mm_shuffle_ps(y, z, _MM_SHUFFLE(1, 1, 1, 1)),
+		_mm_shuffle_ps(x, y, _MM_SHUFFLE(2, 2, 2, 2)),
+		_MM_SHUFFLE(2, 0, 2, 0));
+	float4 c = _mm_shuffle_ps(_mm_shuffle_ps(z, x, _MM_SHUFFLE(3, 3, 2, 2)),
+		_mm_shuffle_ps(y, z, _MM_SHUFFLE(3, 3, 3, 3)),
+		_MM_SHUFFLE(2, 0, 2, 0));
+	_mm_storeu_ps(dest, a);
+	_mm_storeu_ps(dest + 4, b);
+	_mm_storeu_ps(dest + 8, c);
+}
+
+
+} // namespace Lumix
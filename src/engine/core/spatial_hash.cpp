@@ -0,0 +1,255 @@
+#include "spatial_hash.h"
+#include "core/math_utils.h"
+
+
+namespace Lumix
+{
+
+
+static uint32 getCellKey(int x, int y, int z)
+{
+	// unsigned, so far cells wrap instead of overflowing
+	return (uint32)x * 73856093U ^ (uint32)y * 19349663U ^ (uint32)z * 83492791U;
+}
+
+
+SpatialHash::SpatialHash(float cell_size, IAllocator& allocator)
+	: m_cell_size(cell_size)
+	, m_inv_cell_size(1 / cell_size)
+	, m_count(0)
+	, m_nodes(allocator)
+	, m_cells(allocator)
+{
+}
+
+
+int SpatialHash::getCellCoord(float value) const
+{
+	float scaled = value * m_inv_cell_size;
+	int coord = int(scaled);
+	return scaled < coord ? coord - 1 : coord;
+}
+
+
+void SpatialHash::link(int id)
+{
+	Node& node = m_nodes[id];
+	node.cell_x = getCellCoord(node.position.x);
+	node.cell_y = getCellCoord(node.position.y);
+	node.cell_z = getCellCoord(node.position.z);
+	node.prev = -1;
+
+	uint32 key = getCellKey(node.cell_x, node.cell_y, node.cell_z);
+	CellMap::iterator iter = m_cells.find(key);
+	if (iter.isValid())
+	{
+		node.next = iter.value();
+		m_nodes[node.next].prev = id;
+		iter.value() = id;
+	}
+	else
+	{
+		node.next = -1;
+		m_cells.insert(key, id);
+	}
+}
+
+
+void SpatialHash::unlink(int id)
+{
+	Node& node = m_nodes[id];
+	if (node.next >= 0) m_nodes[node.next].prev = node.prev;
+	if (node.prev >= 0)
+	{
+		m_nodes[node.prev].next = node.next;
+		return;
+	}
+
+	uint32 key = getCellKey(node.cell_x, node.cell_y, node.cell_z);
+	if (node.next >= 0)
+	{
+		m_cells[key] = node.next;
+	}
+	else
+	{
+		m_cells.erase(key);
+	}
+}
+
+
+void SpatialHash::add(int id, const Vec3& position)
+{
+	ASSERT(id >= 0);
+	while (id >= m_nodes.size())
+	{
+		m_nodes.pushEmpty().is_valid = false;
+	}
+	if (m_nodes[id].is_valid)
+	{
+		move(id, position);
+		return;
+	}
+
+	m_nodes[id].position = position;
+	m_nodes[id].is_valid = true;
+	link(id);
+	++m_count;
+}
+
+
+void SpatialHash::remove(int id)
+{
+	if (!contains(id)) return;
+
+	unlink(id);
+	m_nodes[id].is_valid = false;
+	--m_count;
+}
+
+
+void SpatialHash::move(int id, const Vec3& position)
+{
+	if (!contains(id)) return;
+
+	Node& node = m_nodes[id];
+	node.position = position;
+	if (getCellCoord(position.x) == node.cell_x && getCellCoord(position.y) == node.cell_y &&
+		getCellCoord(position.z) == node.cell_z)
+	{
+		return;
+	}
+	unlink(id);
+	link(id);
+}
+
+
+bool SpatialHash::contains(int id) const
+{
+	return id >= 0 && id < m_nodes.size() && m_nodes[id].is_valid;
+}
+
+
+void SpatialHash::clear()
+{
+	m_nodes.clear();
+	m_cells.clear();
+	m_count = 0;
+}
+
+
+template <typename T>
+void SpatialHash::forEachInBox(const Vec3& min, const Vec3& max, T& callback) const
+{
+	float cell_count = ((max.x - min.x) * m_inv_cell_size + 2) *
+					   ((max.y - min.y) * m_inv_cell_size + 2) *
+					   ((max.z - min.z) * m_inv_cell_size + 2);
+	if (cell_count > m_cells.size())
+	{
+		for (int i = 0, c = m_nodes.size(); i < c; ++i)
+		{
+			if (m_nodes[i].is_valid) callback(i, m_nodes[i].position);
+		}
+		return;
+	}
+
+	int from_x = getCellCoord(min.x);
+	int from_y = getCellCoord(min.y);
+	int from_z = getCellCoord(min.z);
+	int to_x = getCellCoord(max.x);
+	int to_y = getCellCoord(max.y);
+	int to_z = getCellCoord(max.z);
+
+	for (int z = from_z; z <= to_z; ++z)
+	{
+		for (int y = from_y; y <= to_y; ++y)
+		{
+			for (int x = from_x; x <= to_x; ++x)
+			{
+				CellMap::const_iterator iter = m_cells.find(getCellKey(x, y, z));
+				if (!iter.isValid()) continue;
+
+				for (int id = iter.value(); id >= 0; id = m_nodes[id].next)
+				{
+					const Node& node = m_nodes[id];
+					// different cells can share a key, skip nodes of the other cells
+					if (node.cell_x == x && node.cell_y == y && node.cell_z == z)
+					{
+						callback(id, node.position);
+					}
+				}
+			}
+		}
+	}
+}
+
+
+void SpatialHash::getInRadius(const Vec3& center, float radius, Array<int>& result) const
+{
+	float squared_radius = radius * radius;
+	auto callback = [&](int id, const Vec3& position)
+	{
+		if ((position - center).squaredLength() <= squared_radius) result.push(id);
+	};
+	Vec3 extents(radius, radius, radius);
+	forEachInBox(center - extents, center + extents, callback);
+}
+
+
+void SpatialHash::getInAABB(const Vec3& min, const Vec3& max, Array<int>& result) const
+{
+	auto callback = [&](int id, const Vec3& position)
+	{
+		if (position.x >= min.x && position.y >= min.y && position.z >= min.z &&
+			position.x <= max.x && position.y <= max.y && position.z <= max.z)
+		{
+			result.push(id);
+		}
+	};
+	forEachInBox(min, max, callback);
+}
+
+
+int SpatialHash::getNearest(const Vec3& point,
+	float max_distance,
+	int max_count,
+	int* result) const
+{
+	ASSERT(max_count > 0);
+	static const int MAX_RESULT_COUNT = 64;
+	ASSERT(max_count <= MAX_RESULT_COUNT);
+	float squared_distances[MAX_RESULT_COUNT];
+	int count = 0;
+	float radius = Math::minValue(m_cell_size, max_distance);
+
+	for (;;)
+	{
+		count = 0;
+		float squared_radius = radius * radius;
+		int visited = 0;
+		auto callback = [&](int id, const Vec3& position)
+		{
+			++visited;
+			float squared_distance = (position - point).squaredLength();
+			if (squared_distance > squared_radius) return;
+			if (count == max_count && squared_distance >= squared_distances[count - 1]) return;
+
+			int i = count < max_count ? count++ : count - 1;
+			for (; i > 0 && squared_distances[i - 1] > squared_distance; --i)
+			{
+				squared_distances[i] = squared_distances[i - 1];
+				result[i] = result[i - 1];
+			}
+			squared_distances[i] = squared_distance;
+			result[i] = id;
+		};
+		Vec3 extents(radius, radius, radius);
+		forEachInBox(point - extents, point + extents, callback);
+
+		// everything closer than radius has been found, so the result is final
+		if (count == max_count || radius >= max_distance || visited == m_count) return count;
+		radius = Math::minValue(radius * 2, max_distance);
+	}
+}
+
+
+} // namespace Lumix
@@ -0,0 +1,60 @@
+#pragma once
+
+
+#include "lumix.h"
+#include "core/array.h"
+#include "core/pod_hash_map.h"
+#include "core/vec.h"
+
+
+namespace Lumix
+{
+
+
+// Uniform grid of points stored in a hash map, so only occupied cells take memory.
+// Ids are small non-negative integers, e.g. entities or component indices.
+class LUMIX_ENGINE_API SpatialHash
+{
+public:
+	SpatialHash(float cell_size, IAllocator& allocator);
+
+	void add(int id, const Vec3& position);
+	void remove(int id);
+	void move(int id, const Vec3& position);
+	bool contains(int id) const;
+	void clear();
+	int getCount() const { return m_count; }
+	float getCellSize() const { return m_cell_size; }
+
+	void getInRadius(const Vec3& center, float radius, Array<int>& result) const;
+	void getInAABB(const Vec3& min, const Vec3& max, Array<int>& result) const;
+	int getNearest(const Vec3& point, float max_distance, int max_count, int* result) const;
+
+private:
+	struct Node
+	{
+		Vec3 position;
+		int cell_x, cell_y, cell_z;
+		int prev;
+		int next;
+		bool is_valid;
+	};
+
+	typedef PODHashMap<uint32, int> CellMap;
+
+private:
+	int getCellCoord(float value) const;
+	void link(int id);
+	void unlink(int id);
+	template <typename T> void forEachInBox(const Vec3& min, const Vec3& max, T& callback) const;
+
+private:
+	float m_cell_size;
+	float m_inv_cell_size;
+	int m_count;
+	Array<Node> m_nodes;
+	CellMap m_cells;
+};
+
+
+} // namespace Lumix
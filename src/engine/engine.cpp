@@ -8,6 +8,7 @@
 #include "core/path.h"
 #include "core/profiler.h"
 #include "core/resource_manager.h"
+#include "core/string.h"
 #include "core/timer.h"
 #include "core/fs/disk_file_device.h"
 #include "core/fs/file_system.h"
@@ -25,6 +26,7 @@ namespace Lumix
 {
 
 static const uint32 SERIALIZED_ENGINE_MAGIC = 0x5f4c454e; // == '_LEN'
+static const uint32 SERIALIZED_DELTA_MAGIC = 0x5f4c4544; // == '_LED'
 static const uint32 HIERARCHY_HASH = crc32("hierarchy");
 
 
@@ -36,6 +38,7 @@ enum class SerializedEngineVersion : int32
 	SCENE_VERSION,
 	HIERARCHY_COMPONENT,
 	SCENE_VERSION_CHECK,
+	SCENE_SIZE_PREFIX,
 
 	LATEST // must be the last one
 };
@@ -76,6 +79,13 @@ public:
 		, m_is_game_running(false)
 		, m_component_types(m_allocator)
 		, m_last_time_delta(0)
+		, m_current_state(m_allocator)
+		, m_restore_delta(m_allocator)
+		, m_created_entities(m_allocator)
+		, m_destroyed_entities(m_allocator)
+		, m_transformed_entities(m_allocator)
+		, m_scene_blob(m_allocator)
+		, m_scene_sections(m_allocator)
 	{
 		m_mtjd_manager = MTJD::Manager::create(m_allocator);
 		if (!fs)
@@ -243,6 +253,7 @@ public:
 				context.m_scenes[i]->update(dt);
 			}
 		}
+		context.m_universe->getCommandQueue().playback(*context.m_universe);
 		m_plugin_manager->update(dt);
 		m_input_system->update(dt);
 		getFileSystem().updateAsyncTransactions();
@@ -339,7 +350,10 @@ public:
 		{
 			serializer.writeString(ctx.m_scenes[i]->getPlugin().getName());
 			serializer.write(ctx.m_scenes[i]->getVersion());
-			ctx.m_scenes[i]->serialize(serializer);
+			m_scene_blob.clear();
+			ctx.m_scenes[i]->serialize(m_scene_blob);
+			serializer.write((int32)m_scene_blob.getSize());
+			serializer.write(m_scene_blob.getData(), m_scene_blob.getSize());
 		}
 		uint32 crc = crc32((const uint8*)serializer.getData() + pos,
 							 serializer.getSize() - pos);
@@ -347,6 +361,54 @@ public:
 	}
 
 
+	void deserializeScenes(UniverseContext& ctx,
+		InputBlob& serializer,
+		SerializedEngineVersion version)
+	{
+		int32 scene_count;
+		serializer.read(scene_count);
+		for (int i = 0; i < scene_count; ++i)
+		{
+			char tmp[32];
+			serializer.readString(tmp, sizeof(tmp));
+			IScene* scene = ctx.getScene(crc32(tmp));
+			int scene_version = -1;
+			if (version > SerializedEngineVersion::SCENE_VERSION)
+			{
+				serializer.read(scene_version);
+			}
+			scene->deserialize(serializer, scene_version);
+		}
+	}
+
+
+	void deserializeSceneSections(UniverseContext& ctx, InputBlob& serializer)
+	{
+		PROFILE_FUNCTION();
+		int32 scene_count;
+		serializer.read(scene_count);
+		for (int i = 0; i < scene_count; ++i)
+		{
+			char tmp[32];
+			serializer.readString(tmp, sizeof(tmp));
+			IScene* scene = ctx.getScene(crc32(tmp));
+			int32 version;
+			int32 size;
+			serializer.read(version);
+			serializer.read(size);
+			const void* data = serializer.skip(size);
+			if (!scene)
+			{
+				g_log_warning.log("engine") << "Skipping data of missing scene " << tmp;
+				continue;
+			}
+
+			InputBlob blob(data, size);
+			scene->deserialize(blob, version);
+		}
+	}
+
+
 	bool deserialize(UniverseContext& ctx, InputBlob& serializer) override
 	{
 		SerializedEngineHeader header;
@@ -380,28 +442,244 @@ public:
 		}
 
 		m_plugin_manager->deserialize(serializer);
+		if (header.m_version > SerializedEngineVersion::SCENE_SIZE_PREFIX)
+		{
+			deserializeSceneSections(ctx, serializer);
+		}
+		else
+		{
+			deserializeScenes(ctx, serializer, header.m_version);
+		}
+		g_path_manager.clear();
+		return true;
+	}
+
+
+	void takeSnapshot(UniverseContext& ctx, UniverseSnapshot& snapshot) override
+	{
+		PROFILE_FUNCTION();
+		snapshot.m_paths.clear();
+		snapshot.m_universe.clear();
+		snapshot.m_scene_data.clear();
+		snapshot.m_scenes.clear();
+
+		g_path_manager.serialize(snapshot.m_paths);
+		ctx.m_universe->serialize(snapshot.m_universe);
+		for (auto* scene : ctx.m_scenes)
+		{
+			auto& info = snapshot.m_scenes.pushEmpty();
+			info.hash = crc32(scene->getPlugin().getName());
+			info.version = scene->getVersion();
+			info.offset = snapshot.m_scene_data.getSize();
+			scene->serialize(snapshot.m_scene_data);
+			info.size = snapshot.m_scene_data.getSize() - info.offset;
+		}
+	}
+
+
+	static bool isSceneChanged(const UniverseSnapshot& from, const UniverseSnapshot& to, int index)
+	{
+		if (index >= from.m_scenes.size()) return true;
+
+		auto& src = from.m_scenes[index];
+		auto& dst = to.m_scenes[index];
+		if (src.hash != dst.hash || src.size != dst.size) return true;
+
+		return compareMemory((const uint8*)from.m_scene_data.getData() + src.offset,
+				   (const uint8*)to.m_scene_data.getData() + dst.offset,
+				   dst.size) != 0;
+	}
+
+
+	// the universe delta goes last, so everything before it can be validated
+	// before the universe delta is applied
+	static void serializeDelta(const UniverseSnapshot& from,
+		const UniverseSnapshot& to,
+		OutputBlob& delta)
+	{
+		delta.write(SERIALIZED_DELTA_MAGIC);
+		delta.write(SerializedEngineVersion::LATEST);
+
+		// local matrices of children are computed from the transformations when the hierarchy
+		// is deserialized, so it is reloaded whenever the universe changes
+		bool is_universe_changed = from.m_universe.getSize() != to.m_universe.getSize() ||
+								   compareMemory(from.m_universe.getData(),
+									   to.m_universe.getData(),
+									   to.m_universe.getSize()) != 0;
+
+		bool any_scene_changed = false;
+		for (int i = 0; i < to.m_scenes.size(); ++i)
+		{
+			any_scene_changed = any_scene_changed || isSceneChanged(from, to, i);
+		}
+		any_scene_changed = any_scene_changed || is_universe_changed;
+		delta.write(any_scene_changed);
+		if (any_scene_changed)
+		{
+			delta.write((int32)to.m_paths.getSize());
+			delta.write(to.m_paths.getData(), to.m_paths.getSize());
+		}
+
+		delta.write((int32)to.m_scenes.size());
+		for (int i = 0; i < to.m_scenes.size(); ++i)
+		{
+			auto& scene = to.m_scenes[i];
+			bool is_changed = isSceneChanged(from, to, i) ||
+							  (scene.hash == HIERARCHY_HASH && is_universe_changed);
+			delta.write(scene.hash);
+			delta.write(is_changed);
+			if (!is_changed) continue;
+
+			delta.write(scene.version);
+			delta.write((int32)scene.size);
+			delta.write((const uint8*)to.m_scene_data.getData() + scene.offset, scene.size);
+		}
+
+		InputBlob from_universe(from.m_universe);
+		InputBlob to_universe(to.m_universe);
+		Universe::serializeDelta(from_universe, to_universe, delta);
+	}
+
+
+	void serializeDelta(UniverseContext& ctx,
+		const UniverseSnapshot& baseline,
+		OutputBlob& delta) override
+	{
+		PROFILE_FUNCTION();
+		takeSnapshot(ctx, m_current_state);
+		serializeDelta(baseline, m_current_state, delta);
+	}
+
+
+	static const void* readDeltaSection(InputBlob& delta, int32& size)
+	{
+		if (!delta.read(&size, sizeof(size))) return nullptr;
+		if (size < 0 || size > delta.getSize() - delta.getPosition()) return nullptr;
+		return delta.skip(size);
+	}
+
+
+	bool deserializeDelta(UniverseContext& ctx, InputBlob& delta) override
+	{
+		PROFILE_FUNCTION();
+		uint32 magic;
+		delta.read(magic);
+		if (magic != SERIALIZED_DELTA_MAGIC)
+		{
+			g_log_error.log("engine") << "Wrong or corrupted delta";
+			return false;
+		}
+		SerializedEngineVersion version;
+		delta.read(version);
+		if (version != SerializedEngineVersion::LATEST)
+		{
+			g_log_error.log("engine") << "Unsupported delta version";
+			return false;
+		}
+
+		bool has_paths = delta.read<bool>();
+		int32 paths_size = 0;
+		const void* paths = has_paths ? readDeltaSection(delta, paths_size) : nullptr;
+		if (has_paths && !paths)
+		{
+			g_log_error.log("engine") << "Corrupted delta";
+			return false;
+		}
+
+		m_scene_sections.clear();
 		int32 scene_count;
-		serializer.read(scene_count);
+		if (!delta.read(&scene_count, sizeof(scene_count)) || scene_count < 0)
+		{
+			g_log_error.log("engine") << "Corrupted delta";
+			return false;
+		}
 		for (int i = 0; i < scene_count; ++i)
 		{
-			char tmp[32];
-			serializer.readString(tmp, sizeof(tmp));
-			IScene* scene = ctx.getScene(crc32(tmp));
-			int scene_version = -1;
-			if (header.m_version > SerializedEngineVersion::SCENE_VERSION)
+			uint32 hash;
+			delta.read(hash);
+			if (!delta.read<bool>()) continue;
+
+			SceneSection section;
+			delta.read(section.version);
+			section.data = readDeltaSection(delta, section.size);
+			if (!section.data)
 			{
-				serializer.read(scene_version);
+				g_log_error.log("engine") << "Corrupted delta";
+				return false;
 			}
-			scene->deserialize(serializer, scene_version);
+			section.scene = ctx.getScene(hash);
+			if (!section.scene)
+			{
+				g_log_warning.log("engine") << "Skipping delta of missing scene " << hash;
+				continue;
+			}
+			m_scene_sections.push(section);
+		}
+
+		Universe& universe = *ctx.m_universe;
+		if (!universe.deserializeDelta(
+				delta, m_created_entities, m_destroyed_entities, m_transformed_entities))
+		{
+			g_log_error.log("engine") << "Corrupted universe delta";
+			return false;
+		}
+
+		for (auto entity : m_created_entities)
+		{
+			universe.entityCreated().invoke(entity);
+		}
+
+		if (has_paths)
+		{
+			InputBlob paths_blob(paths, paths_size);
+			g_path_manager.deserialize(paths_blob);
+		}
+		for (auto& section : m_scene_sections)
+		{
+			InputBlob scene_blob(section.data, section.size);
+			universe.beginComponentReload(*section.scene);
+			section.scene->deserialize(scene_blob, section.version);
+			universe.endComponentReload();
+		}
+		if (has_paths)
+		{
+			g_path_manager.clear();
+		}
+
+		for (auto entity : m_destroyed_entities)
+		{
+			universe.entityDestroyed().invoke(entity);
+		}
+		for (auto entity : m_transformed_entities)
+		{
+			universe.entityTransformed().invoke(entity);
 		}
-		g_path_manager.clear();
 		return true;
 	}
 
 
+	void restoreSnapshot(UniverseContext& ctx, const UniverseSnapshot& snapshot) override
+	{
+		PROFILE_FUNCTION();
+		takeSnapshot(ctx, m_current_state);
+		m_restore_delta.clear();
+		serializeDelta(m_current_state, snapshot, m_restore_delta);
+		InputBlob delta(m_restore_delta);
+		deserializeDelta(ctx, delta);
+	}
+
+
 	float getLastTimeDelta() override { return m_last_time_delta; }
 
 private:
+	struct SceneSection
+	{
+		IScene* scene;
+		int32 version;
+		int32 size;
+		const void* data;
+	};
+
 	struct ComponentType
 	{
 		ComponentType(IAllocator& allocator)
@@ -438,6 +716,13 @@ private:
 	float m_last_time_delta;
 	bool m_is_game_running;
 	PlatformData m_platform_data;
+	UniverseSnapshot m_current_state;
+	OutputBlob m_restore_delta;
+	Array<Entity> m_created_entities;
+	Array<Entity> m_destroyed_entities;
+	Array<Entity> m_transformed_entities;
+	OutputBlob m_scene_blob;
+	Array<SceneSection> m_scene_sections;
 
 private:
 	void operator=(const EngineImpl&);
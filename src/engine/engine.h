@@ -3,6 +3,7 @@
 
 #include "lumix.h"
 #include "core/array.h"
+#include "core/blob.h"
 
 
 namespace Lumix
@@ -17,7 +18,6 @@ namespace MTJD
 class Manager;
 }
 
-class InputBlob;
 class EditorServer;
 class Hierarchy;
 class InputSystem;
@@ -25,7 +25,6 @@ class IPlugin;
 class IPropertyDescriptor;
 class IScene;
 class JsonSerializer;
-class OutputBlob;
 class PluginManager;
 class ResourceManager;
 class Universe;
@@ -47,6 +46,31 @@ struct LUMIX_ENGINE_API UniverseContext
 
 
 
+struct LUMIX_ENGINE_API UniverseSnapshot
+{
+	struct Scene
+	{
+		uint32 hash;
+		int32 version;
+		int offset;
+		int size;
+	};
+
+	UniverseSnapshot(IAllocator& allocator)
+		: m_paths(allocator)
+		, m_universe(allocator)
+		, m_scene_data(allocator)
+		, m_scenes(allocator)
+	{
+	}
+
+	OutputBlob m_paths;
+	OutputBlob m_universe;
+	OutputBlob m_scene_data;
+	Array<Scene> m_scenes;
+};
+
+
 class LUMIX_ENGINE_API Engine
 {
 public:
@@ -79,6 +103,12 @@ public:
 	virtual void update(UniverseContext& context) = 0;
 	virtual uint32 serialize(UniverseContext& ctx, OutputBlob& serializer) = 0;
 	virtual bool deserialize(UniverseContext& ctx, InputBlob& serializer) = 0;
+	virtual void takeSnapshot(UniverseContext& ctx, UniverseSnapshot& snapshot) = 0;
+	virtual void restoreSnapshot(UniverseContext& ctx, const UniverseSnapshot& snapshot) = 0;
+	virtual void serializeDelta(UniverseContext& ctx,
+		const UniverseSnapshot& baseline,
+		OutputBlob& delta) = 0;
+	virtual bool deserializeDelta(UniverseContext& ctx, InputBlob& delta) = 0;
 	virtual float getFPS() const = 0;
 	virtual float getLastTimeDelta() = 0;
 
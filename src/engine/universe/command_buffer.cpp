@@ -0,0 +1,239 @@
+#include "command_buffer.h"
+#include "core/math_utils.h"
+#include "core/mt/atomic.h"
+#include "core/profiler.h"
+#include "core/quat.h"
+#include "core/vec.h"
+#include "engine/iplugin.h"
+#include "universe.h"
+#include <cstdlib>
+
+
+namespace Lumix
+{
+
+
+enum class CommandType : uint8
+{
+	CREATE_ENTITY,
+	DESTROY_ENTITY,
+	CREATE_COMPONENT,
+	DESTROY_COMPONENT
+};
+
+
+static Entity toPlaceholder(int index)
+{
+	return -2 - index;
+}
+
+
+static Entity resolveEntity(Entity entity, const Array<Entity>& created_entities)
+{
+	return entity < INVALID_ENTITY ? created_entities[-2 - entity] : entity;
+}
+
+
+CommandBuffer::CommandBuffer(IAllocator& allocator)
+	: m_commands(allocator)
+	, m_created_entities_count(0)
+{
+}
+
+
+Entity CommandBuffer::createEntity(const Vec3& position, const Quat& rotation)
+{
+	m_commands.write(CommandType::CREATE_ENTITY);
+	m_commands.write(position);
+	m_commands.write(rotation);
+	Entity placeholder = toPlaceholder(m_created_entities_count);
+	++m_created_entities_count;
+	return placeholder;
+}
+
+
+void CommandBuffer::destroyEntity(Entity entity)
+{
+	m_commands.write(CommandType::DESTROY_ENTITY);
+	m_commands.write(entity);
+}
+
+
+void CommandBuffer::createComponent(IScene* scene, uint32 type, Entity entity)
+{
+	m_commands.write(CommandType::CREATE_COMPONENT);
+	m_commands.write(scene);
+	m_commands.write(type);
+	m_commands.write(entity);
+}
+
+
+void CommandBuffer::destroyComponent(IScene* scene, uint32 type, ComponentIndex component)
+{
+	m_commands.write(CommandType::DESTROY_COMPONENT);
+	m_commands.write(scene);
+	m_commands.write(type);
+	m_commands.write(component);
+}
+
+
+void CommandBuffer::clear()
+{
+	m_commands.clear();
+	m_created_entities_count = 0;
+}
+
+
+void CommandBuffer::playback(Universe& universe, Array<Entity>& created_entities)
+{
+	created_entities.clear();
+	InputBlob blob(m_commands);
+	while (blob.getPosition() < blob.getSize())
+	{
+		CommandType type;
+		blob.read(type);
+		switch (type)
+		{
+			case CommandType::CREATE_ENTITY:
+			{
+				Vec3 position;
+				Quat rotation;
+				blob.read(position);
+				blob.read(rotation);
+				created_entities.push(universe.createEntity(position, rotation));
+				break;
+			}
+			case CommandType::DESTROY_ENTITY:
+			{
+				Entity entity;
+				blob.read(entity);
+				universe.destroyEntity(resolveEntity(entity, created_entities));
+				break;
+			}
+			case CommandType::CREATE_COMPONENT:
+			{
+				IScene* scene;
+				uint32 cmp_type;
+				Entity entity;
+				blob.read(scene);
+				blob.read(cmp_type);
+				blob.read(entity);
+				scene->createComponent(cmp_type, resolveEntity(entity, created_entities));
+				break;
+			}
+			case CommandType::DESTROY_COMPONENT:
+			{
+				IScene* scene;
+				uint32 cmp_type;
+				ComponentIndex component;
+				blob.read(scene);
+				blob.read(cmp_type);
+				blob.read(component);
+				scene->destroyComponent(component, cmp_type);
+				break;
+			}
+			default: ASSERT(false); return;
+		}
+	}
+	clear();
+}
+
+
+CommandQueue::CommandQueue(IAllocator& allocator)
+	: m_allocator(allocator)
+	, m_count(0)
+	, m_overflow_mutex(false)
+	, m_overflow_buffers(allocator)
+	, m_overflow_slots(allocator)
+	, m_sorted_slots(allocator)
+	, m_created_entities(allocator)
+{
+	for (int i = 0; i < MAX_BUFFERS; ++i)
+	{
+		m_buffers[i] = nullptr;
+	}
+}
+
+
+CommandQueue::~CommandQueue()
+{
+	for (int i = 0; i < MAX_BUFFERS; ++i)
+	{
+		LUMIX_DELETE(m_allocator, m_buffers[i]);
+	}
+	for (auto* buffer : m_overflow_buffers)
+	{
+		LUMIX_DELETE(m_allocator, buffer);
+	}
+}
+
+
+CommandBuffer& CommandQueue::allocBuffer(uint32 sort_key)
+{
+	int32 index = MT::atomicIncrement(&m_count) - 1;
+	if (index >= MAX_BUFFERS) return allocOverflowBuffer(sort_key, index);
+
+	if (!m_buffers[index])
+	{
+		m_buffers[index] = LUMIX_NEW(m_allocator, CommandBuffer)(m_allocator);
+	}
+	m_slots[index].sort_key = sort_key;
+	m_slots[index].index = index;
+	m_slots[index].buffer = m_buffers[index];
+	return *m_buffers[index];
+}
+
+
+CommandBuffer& CommandQueue::allocOverflowBuffer(uint32 sort_key, int32 index)
+{
+	MT::SpinLock lock(m_overflow_mutex);
+	if (m_overflow_buffers.size() == m_overflow_slots.size())
+	{
+		m_overflow_buffers.push(LUMIX_NEW(m_allocator, CommandBuffer)(m_allocator));
+	}
+	Slot& slot = m_overflow_slots.emplace();
+	slot.sort_key = sort_key;
+	slot.index = index;
+	slot.buffer = m_overflow_buffers[m_overflow_slots.size() - 1];
+	return *slot.buffer;
+}
+
+
+// qsort is not stable, equal keys are ordered by the allocation index instead
+int CommandQueue::compareSlots(const void* a, const void* b)
+{
+	auto* slot_a = (const Slot*)a;
+	auto* slot_b = (const Slot*)b;
+	if (slot_a->sort_key != slot_b->sort_key) return slot_a->sort_key < slot_b->sort_key ? -1 : 1;
+	return slot_a->index < slot_b->index ? -1 : (slot_a->index > slot_b->index ? 1 : 0);
+}
+
+
+void CommandQueue::playback(Universe& universe)
+{
+	PROFILE_FUNCTION();
+	int count = m_count;
+	if (count == 0) return;
+
+	m_sorted_slots.clear();
+	for (int i = 0, c = Math::minValue(count, MAX_BUFFERS); i < c; ++i)
+	{
+		m_sorted_slots.push(m_slots[i]);
+	}
+	for (const auto& slot : m_overflow_slots)
+	{
+		m_sorted_slots.push(slot);
+	}
+	ASSERT(m_sorted_slots.size() == count);
+
+	qsort(m_sorted_slots.begin(), count, sizeof(m_sorted_slots[0]), compareSlots);
+	for (const auto& slot : m_sorted_slots)
+	{
+		slot.buffer->playback(universe, m_created_entities);
+	}
+	m_overflow_slots.clear();
+	m_count = 0;
+}
+
+
+} // !namespace Lumix
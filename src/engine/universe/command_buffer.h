@@ -0,0 +1,85 @@
+#pragma once
+
+
+#include "lumix.h"
+#include "core/array.h"
+#include "core/blob.h"
+#include "core/mt/sync.h"
+
+
+namespace Lumix
+{
+
+
+class IScene;
+struct Quat;
+class Universe;
+struct Vec3;
+
+
+// Records universe changes without touching the universe, so it can be filled
+// from any thread. Entities returned by createEntity are placeholders, they are
+// valid only as arguments of other commands in the same buffer.
+class LUMIX_ENGINE_API CommandBuffer
+{
+public:
+	explicit CommandBuffer(IAllocator& allocator);
+
+	Entity createEntity(const Vec3& position, const Quat& rotation);
+	void destroyEntity(Entity entity);
+	void createComponent(IScene* scene, uint32 type, Entity entity);
+	void destroyComponent(IScene* scene, uint32 type, ComponentIndex component);
+
+	bool empty() const { return m_commands.getSize() == 0; }
+	void clear();
+	void playback(Universe& universe, Array<Entity>& created_entities);
+
+private:
+	OutputBlob m_commands;
+	int m_created_entities_count;
+};
+
+
+// Multiple producers get their buffers from the queue without locking, the
+// buffers are played back on the main thread in the order of their sort keys,
+// so the result does not depend on which thread finished first. Buffers with
+// equal sort keys are played back in the order they were allocated. Buffers
+// allocated after the first MAX_BUFFERS in a frame are taken under a lock.
+class LUMIX_ENGINE_API CommandQueue
+{
+public:
+	static const int MAX_BUFFERS = 1024;
+
+public:
+	explicit CommandQueue(IAllocator& allocator);
+	~CommandQueue();
+
+	CommandBuffer& allocBuffer(uint32 sort_key);
+	void playback(Universe& universe);
+
+private:
+	struct Slot
+	{
+		uint32 sort_key;
+		int32 index;
+		CommandBuffer* buffer;
+	};
+
+private:
+	CommandBuffer& allocOverflowBuffer(uint32 sort_key, int32 index);
+	static int compareSlots(const void* a, const void* b);
+
+private:
+	IAllocator& m_allocator;
+	CommandBuffer* m_buffers[MAX_BUFFERS];
+	Slot m_slots[MAX_BUFFERS];
+	volatile int32 m_count;
+	MT::SpinMutex m_overflow_mutex;
+	Array<CommandBuffer*> m_overflow_buffers;
+	Array<Slot> m_overflow_slots;
+	Array<Slot> m_sorted_slots;
+	Array<Entity> m_created_entities;
+};
+
+
+} // !namespace Lumix
@@ -236,6 +236,14 @@ public:
 
 	void deserialize(InputBlob& serializer, int /*version*/) override
 	{
+		// snapshots are restored into a scene which already has components
+		for (auto iter = m_children.begin(), end = m_children.end(); iter != end; ++iter)
+		{
+			LUMIX_DELETE(m_allocator, iter.value());
+		}
+		m_children.clear();
+		m_parents.clear();
+
 		int32 size;
 		serializer.read(size);
 		for (int i = 0; i < size; ++i)
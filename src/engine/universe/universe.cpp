@@ -1,8 +1,10 @@
 #include "universe.h"
 #include "core/blob.h"
 #include "core/crc32.h"
+#include "core/math_utils.h"
 #include "core/matrix.h"
 #include "core/json_serializer.h"
+#include "core/string.h"
 #include <cstdint>
 
 
@@ -11,6 +13,7 @@ namespace Lumix
 
 
 static const int RESERVED_ENTITIES_COUNT = 5000;
+static const float SPATIAL_HASH_CELL_SIZE = 16.0f;
 
 
 Universe::~Universe()
@@ -30,9 +33,46 @@ Universe::Universe(IAllocator& allocator)
 	, m_entity_moved(m_allocator)
 	, m_entity_map(m_allocator)
 	, m_first_free_slot(-1)
+	, m_components(m_allocator)
+	, m_reloaded_components(m_allocator)
+	, m_reloaded_scene(nullptr)
+	, m_command_queue(m_allocator)
+	, m_spatial_hash(SPATIAL_HASH_CELL_SIZE, m_allocator)
 {
 	m_transformations.reserve(RESERVED_ENTITIES_COUNT);
 	m_entity_map.reserve(RESERVED_ENTITIES_COUNT);
+
+	m_entity_created.bind<Universe, &Universe::onEntityCreated>(this);
+	m_entity_destroyed.bind<Universe, &Universe::onEntityDestroyed>(this);
+	m_entity_moved.bind<Universe, &Universe::onEntityMoved>(this);
+}
+
+
+void Universe::onEntityCreated(Entity entity)
+{
+	m_spatial_hash.add(entity, getPosition(entity));
+}
+
+
+void Universe::onEntityDestroyed(Entity entity)
+{
+	m_spatial_hash.remove(entity);
+}
+
+
+void Universe::onEntityMoved(Entity entity)
+{
+	m_spatial_hash.move(entity, getPosition(entity));
+}
+
+
+void Universe::rebuildSpatialHash()
+{
+	m_spatial_hash.clear();
+	for (auto& transform : m_transformations)
+	{
+		m_spatial_hash.add(transform.entity, transform.position);
+	}
 }
 
 
@@ -202,6 +242,13 @@ void Universe::destroyEntity(Entity entity)
 {
 	if (entity < 0 || m_entity_map[entity] < 0) return;
 
+	removeEntity(entity);
+	m_entity_destroyed.invoke(entity);
+}
+
+
+void Universe::removeEntity(Entity entity)
+{
 	int last_item_id = m_transformations.back().entity;
 	m_entity_map[last_item_id] = m_entity_map[entity];
 	m_transformations.eraseFast(m_entity_map[entity]);
@@ -216,7 +263,6 @@ void Universe::destroyEntity(Entity entity)
 	}
 
 	m_first_free_slot = entity;
-	m_entity_destroyed.invoke(entity);
 }
 
 
@@ -279,14 +325,9 @@ void Universe::serialize(OutputBlob& serializer)
 }
 
 
-void Universe::deserialize(InputBlob& serializer)
+void Universe::deserializeNames(InputBlob& serializer)
 {
 	int32 count;
-	serializer.read(count);
-	m_transformations.resize(count);
-
-	serializer.read(&m_transformations[0], sizeof(m_transformations[0]) * m_transformations.size());
-
 	serializer.read(count);
 	m_id_to_name_map.clear();
 	m_name_to_id_map.clear();
@@ -299,6 +340,18 @@ void Universe::deserialize(InputBlob& serializer)
 		m_id_to_name_map.insert(key, string(name, m_allocator));
 		m_name_to_id_map.insert(crc32(name), key);
 	}
+}
+
+
+void Universe::deserialize(InputBlob& serializer)
+{
+	int32 count;
+	serializer.read(count);
+	m_transformations.resize(count);
+
+	serializer.read(&m_transformations[0], sizeof(m_transformations[0]) * m_transformations.size());
+
+	deserializeNames(serializer);
 
 	serializer.read(m_first_free_slot);
 	serializer.read(count);
@@ -307,6 +360,301 @@ void Universe::deserialize(InputBlob& serializer)
 	{
 		serializer.read(&m_entity_map[0], sizeof(m_entity_map[0]) * count);
 	}
+	m_components.clear();
+	rebuildSpatialHash();
+}
+
+
+namespace
+{
+
+
+struct SerializedUniverse
+{
+	SerializedUniverse(InputBlob& blob, int transformation_size)
+	{
+		blob.read(transformation_count);
+		transformations = (const uint8*)blob.skip(transformation_size * transformation_count);
+
+		names = (const uint8*)blob.getData() + blob.getPosition();
+		int32 name_count;
+		blob.read(name_count);
+		for (int i = 0; i < name_count; ++i)
+		{
+			blob.skip(sizeof(uint32));
+			int32 name_size;
+			blob.read(name_size);
+			blob.skip(name_size);
+		}
+		names_size = int((const uint8*)blob.getData() + blob.getPosition() - names);
+
+		blob.read(first_free_slot);
+		blob.read(entity_map_size);
+		entity_map = (const uint8*)blob.skip(sizeof(int32) * entity_map_size);
+	}
+
+	int32 transformation_count;
+	const uint8* transformations;
+	const uint8* names;
+	int names_size;
+	int32 first_free_slot;
+	int32 entity_map_size;
+	const uint8* entity_map;
+};
+
+
+enum class EntityChange
+{
+	NONE,
+	DESTROYED,
+	CREATED,
+	MOVED,
+	FREE_SLOT
+};
+
+
+} // anonymous namespace
+
+
+static int32 getEntityMapValue(const SerializedUniverse& universe, int entity)
+{
+	if (entity >= universe.entity_map_size) return INT32_MIN;
+
+	int32 value;
+	copyMemory(&value, universe.entity_map + entity * sizeof(int32), sizeof(value));
+	return value;
+}
+
+
+static EntityChange getEntityChange(const SerializedUniverse& from,
+	const SerializedUniverse& to,
+	int entity,
+	int transformation_size)
+{
+	int32 src = getEntityMapValue(from, entity);
+	int32 dst = getEntityMapValue(to, entity);
+	if (src >= 0 && dst < 0) return EntityChange::DESTROYED;
+	if (src < 0 && dst >= 0) return EntityChange::CREATED;
+	if (src >= 0)
+	{
+		bool is_moved = compareMemory(from.transformations + src * transformation_size,
+							to.transformations + dst * transformation_size,
+							transformation_size) != 0;
+		return is_moved ? EntityChange::MOVED : EntityChange::NONE;
+	}
+	if (entity < to.entity_map_size && (entity >= from.entity_map_size || src != dst))
+	{
+		return EntityChange::FREE_SLOT;
+	}
+	return EntityChange::NONE;
+}
+
+
+static void serializeEntityChanges(const SerializedUniverse& from,
+	const SerializedUniverse& to,
+	EntityChange change,
+	int transformation_size,
+	OutputBlob& delta)
+{
+	int entity_count = Math::maxValue(from.entity_map_size, to.entity_map_size);
+	int32 count = 0;
+	for (int i = 0; i < entity_count; ++i)
+	{
+		if (getEntityChange(from, to, i, transformation_size) == change) ++count;
+	}
+
+	delta.write(count);
+	for (int i = 0; i < entity_count; ++i)
+	{
+		if (getEntityChange(from, to, i, transformation_size) != change) continue;
+
+		switch (change)
+		{
+			case EntityChange::DESTROYED: delta.write((int32)i); break;
+			case EntityChange::CREATED:
+			case EntityChange::MOVED:
+				delta.write(to.transformations + getEntityMapValue(to, i) * transformation_size,
+					transformation_size);
+				break;
+			case EntityChange::FREE_SLOT:
+				delta.write((int32)i);
+				delta.write(getEntityMapValue(to, i));
+				break;
+			default: ASSERT(false); break;
+		}
+	}
+}
+
+
+void Universe::serializeDelta(InputBlob& from, InputBlob& to, OutputBlob& delta)
+{
+	SerializedUniverse src(from, sizeof(Transformation));
+	SerializedUniverse dst(to, sizeof(Transformation));
+
+	delta.write(dst.entity_map_size);
+	delta.write(dst.first_free_slot);
+	serializeEntityChanges(src, dst, EntityChange::DESTROYED, sizeof(Transformation), delta);
+	serializeEntityChanges(src, dst, EntityChange::CREATED, sizeof(Transformation), delta);
+	serializeEntityChanges(src, dst, EntityChange::MOVED, sizeof(Transformation), delta);
+	serializeEntityChanges(src, dst, EntityChange::FREE_SLOT, sizeof(Transformation), delta);
+
+	bool names_changed = src.names_size != dst.names_size ||
+						 compareMemory(src.names, dst.names, dst.names_size) != 0;
+	delta.write(names_changed);
+	if (names_changed)
+	{
+		delta.write(dst.names, dst.names_size);
+	}
+}
+
+
+static bool containsEntity(const Array<Entity>& sorted_entities, Entity entity)
+{
+	int from = 0;
+	int to = sorted_entities.size();
+	while (from < to)
+	{
+		int mid = (from + to) / 2;
+		if (sorted_entities[mid] < entity)
+		{
+			from = mid + 1;
+		}
+		else
+		{
+			to = mid;
+		}
+	}
+	return from < sorted_entities.size() && sorted_entities[from] == entity;
+}
+
+
+static bool readSortedEntity(InputBlob& delta, Entity prev, int32 entity_map_size, Entity& entity)
+{
+	if (!delta.read(&entity, sizeof(entity))) return false;
+	return entity > prev && entity >= 0 && entity < entity_map_size;
+}
+
+
+bool Universe::deserializeDelta(InputBlob& delta,
+	Array<Entity>& created_entities,
+	Array<Entity>& destroyed_entities,
+	Array<Entity>& transformed_entities)
+{
+	// the delta is read and validated first, so a corrupted one does not touch the universe
+	int32 entity_map_size;
+	int32 first_free_slot;
+	int32 count;
+	if (!delta.read(&entity_map_size, sizeof(entity_map_size)) || entity_map_size < 0) return false;
+	if (!delta.read(&first_free_slot, sizeof(first_free_slot))) return false;
+
+	destroyed_entities.clear();
+	if (!delta.read(&count, sizeof(count)) || count < 0) return false;
+	for (int i = 0; i < count; ++i)
+	{
+		Entity entity;
+		Entity prev = destroyed_entities.empty() ? -1 : destroyed_entities.back();
+		if (!readSortedEntity(delta, prev, m_entity_map.size(), entity)) return false;
+		if (!hasEntity(entity)) return false;
+		destroyed_entities.push(entity);
+	}
+	for (int i = entity_map_size; i < m_entity_map.size(); ++i)
+	{
+		if (hasEntity(i) && !containsEntity(destroyed_entities, i)) return false;
+	}
+
+	Array<Transformation> created(m_allocator);
+	created_entities.clear();
+	if (!delta.read(&count, sizeof(count)) || count < 0) return false;
+	for (int i = 0; i < count; ++i)
+	{
+		Transformation& trans = created.pushEmpty();
+		Entity prev = created_entities.empty() ? -1 : created_entities.back();
+		if (!delta.read(&trans, sizeof(trans))) return false;
+		if (trans.entity <= prev || trans.entity < 0 || trans.entity >= entity_map_size) return false;
+		if (hasEntity(trans.entity)) return false;
+		created_entities.push(trans.entity);
+	}
+
+	Array<Transformation> moved(m_allocator);
+	transformed_entities.clear();
+	if (!delta.read(&count, sizeof(count)) || count < 0) return false;
+	for (int i = 0; i < count; ++i)
+	{
+		Transformation& trans = moved.pushEmpty();
+		Entity prev = transformed_entities.empty() ? -1 : transformed_entities.back();
+		if (!delta.read(&trans, sizeof(trans))) return false;
+		if (trans.entity <= prev || trans.entity >= entity_map_size || !hasEntity(trans.entity)) return false;
+		if (containsEntity(destroyed_entities, trans.entity)) return false;
+		transformed_entities.push(trans.entity);
+	}
+
+	// every entity id the map grows by must be either created or free
+	int new_ids_count = 0;
+	for (auto entity : created_entities)
+	{
+		if (entity >= m_entity_map.size()) ++new_ids_count;
+	}
+	Array<Entity> free_entities(m_allocator);
+	Array<int32> free_values(m_allocator);
+	if (!delta.read(&count, sizeof(count)) || count < 0) return false;
+	for (int i = 0; i < count; ++i)
+	{
+		Entity entity;
+		int32 value;
+		Entity prev = free_entities.empty() ? -1 : free_entities.back();
+		if (!readSortedEntity(delta, prev, entity_map_size, entity)) return false;
+		if (!delta.read(&value, sizeof(value))) return false;
+		if (value >= 0 || (value != INT32_MIN && -value >= entity_map_size)) return false;
+		if (containsEntity(created_entities, entity)) return false;
+		if (hasEntity(entity) && !containsEntity(destroyed_entities, entity)) return false;
+		if (entity >= m_entity_map.size()) ++new_ids_count;
+		free_entities.push(entity);
+		free_values.push(value);
+	}
+	if (new_ids_count != Math::maxValue(0, entity_map_size - m_entity_map.size())) return false;
+	if (first_free_slot != -1)
+	{
+		if (first_free_slot < 0 || first_free_slot >= entity_map_size) return false;
+		if (containsEntity(created_entities, first_free_slot)) return false;
+		if (hasEntity(first_free_slot) && !containsEntity(destroyed_entities, first_free_slot))
+		{
+			return false;
+		}
+	}
+	bool names_changed;
+	if (!delta.read(&names_changed, sizeof(names_changed))) return false;
+
+	for (auto entity : destroyed_entities)
+	{
+		removeEntity(entity);
+	}
+
+	int old_size = m_entity_map.size();
+	m_entity_map.resize(entity_map_size);
+	for (int i = old_size; i < entity_map_size; ++i)
+	{
+		m_entity_map[i] = INT32_MIN;
+	}
+	for (auto& trans : created)
+	{
+		m_entity_map[trans.entity] = m_transformations.size();
+		m_transformations.push(trans);
+	}
+	for (auto& trans : moved)
+	{
+		m_transformations[m_entity_map[trans.entity]] = trans;
+	}
+	for (int i = 0; i < free_entities.size(); ++i)
+	{
+		m_entity_map[free_entities[i]] = free_values[i];
+	}
+	m_first_free_slot = first_free_slot;
+
+	if (names_changed)
+	{
+		deserializeNames(delta);
+	}
+	return true;
 }
 
 
@@ -325,8 +673,36 @@ float Universe::getScale(Entity entity)
 }
 
 
+static uint64 getComponentKey(Entity entity, uint32 component_type)
+{
+	return ((uint64)(uint32)entity << 32) | component_type;
+}
+
+
+uint32 Universe::ComponentKeyHasher::get(const uint64& key)
+{
+	return PODHashFunc<uint32>::get(uint32(key >> 32) * 31 + uint32(key));
+}
+
+
+void Universe::registerComponent(const ComponentUID& cmp)
+{
+	uint64 key = getComponentKey(cmp.entity, cmp.type);
+	auto iter = m_components.find(key);
+	if (iter.isValid())
+	{
+		iter.value() = cmp;
+	}
+	else
+	{
+		m_components.insert(key, cmp);
+	}
+}
+
+
 void Universe::destroyComponent(Entity entity, uint32 component_type, IScene* scene, int index)
 {
+	m_components.erase(getComponentKey(entity, component_type));
 	m_component_destroyed.invoke(ComponentUID(entity, component_type, scene, index));
 }
 
@@ -334,7 +710,61 @@ void Universe::destroyComponent(Entity entity, uint32 component_type, IScene* sc
 void Universe::addComponent(Entity entity, uint32 component_type, IScene* scene, int index)
 {
 	ComponentUID cmp(entity, component_type, scene, index);
-	m_component_added.invoke(cmp);
+	registerComponent(cmp);
+	if (scene != m_reloaded_scene)
+	{
+		m_component_added.invoke(cmp);
+	}
+}
+
+
+void Universe::beginComponentReload(IScene& scene)
+{
+	ASSERT(!m_reloaded_scene);
+	m_reloaded_scene = &scene;
+	m_reloaded_components.clear();
+	for (auto iter = m_components.begin(), end = m_components.end(); iter != end; ++iter)
+	{
+		if (iter.value().scene == &scene)
+		{
+			m_reloaded_components.insert(iter.key(), iter.value());
+		}
+	}
+	for (auto iter = m_reloaded_components.begin(), end = m_reloaded_components.end(); iter != end;
+		 ++iter)
+	{
+		m_components.erase(iter.key());
+	}
+}
+
+
+void Universe::endComponentReload()
+{
+	ASSERT(m_reloaded_scene);
+	IScene* scene = m_reloaded_scene;
+	m_reloaded_scene = nullptr;
+
+	// a component which got another index is reported as destroyed and added again
+	for (auto iter = m_reloaded_components.begin(), end = m_reloaded_components.end(); iter != end;
+		 ++iter)
+	{
+		auto current = m_components.find(iter.key());
+		if (!current.isValid() || current.value().index != iter.value().index)
+		{
+			m_component_destroyed.invoke(iter.value());
+		}
+	}
+	for (auto iter = m_components.begin(), end = m_components.end(); iter != end; ++iter)
+	{
+		if (iter.value().scene != scene) continue;
+
+		auto old = m_reloaded_components.find(iter.key());
+		if (!old.isValid() || old.value().index != iter.value().index)
+		{
+			m_component_added.invoke(iter.value());
+		}
+	}
+	m_reloaded_components.clear();
 }
 
 
@@ -5,9 +5,12 @@
 #include "core/array.h"
 #include "core/associative_array.h"
 #include "core/delegate_list.h"
+#include "core/pod_hash_map.h"
 #include "core/quat.h"
+#include "core/spatial_hash.h"
 #include "core/string.h"
 #include "core/vec.h"
+#include "universe/command_buffer.h"
 #include "universe/component.h"
 
 
@@ -36,6 +39,10 @@ public:
 	void destroyEntity(Entity entity);
 	void addComponent(Entity entity, uint32 component_type, IScene* scene, int index);
 	void destroyComponent(Entity entity, uint32 component_type, IScene* scene, int index);
+	// components the scene adds until endComponentReload are compared with the ones it had,
+	// only the differences are reported as component events
+	void beginComponentReload(IScene& scene);
+	void endComponentReload();
 	int getEntityCount() const { return m_transformations.size(); }
 
 	int getDenseIdx(Entity entity);
@@ -59,6 +66,9 @@ public:
 	const Vec3& getPosition(Entity entity) const;
 	const Quat& getRotation(Entity entity) const;
 
+	CommandQueue& getCommandQueue() { return m_command_queue; }
+	const SpatialHash& getSpatialHash() const { return m_spatial_hash; }
+
 	DelegateList<void(Entity)>& entityTransformed() { return m_entity_moved; }
 	DelegateList<void(Entity)>& entityCreated() { return m_entity_created; }
 	DelegateList<void(Entity)>& entityDestroyed() { return m_entity_destroyed; }
@@ -67,6 +77,13 @@ public:
 
 	void serialize(OutputBlob& serializer);
 	void deserialize(InputBlob& serializer);
+	static void serializeDelta(InputBlob& from, InputBlob& to, OutputBlob& delta);
+	// entity events are not invoked, the caller invokes them for the returned entities,
+	// returns false and leaves the universe untouched if the delta does not fit it
+	bool deserializeDelta(InputBlob& delta,
+		Array<Entity>& created_entities,
+		Array<Entity>& destroyed_entities,
+		Array<Entity>& transformed_entities);
 
 private:
 	struct Transformation
@@ -77,6 +94,22 @@ private:
 		float scale;
 	};
 
+	struct ComponentKeyHasher
+	{
+		static uint32 get(const uint64& key);
+	};
+
+	typedef PODHashMap<uint64, ComponentUID, ComponentKeyHasher> ComponentMap;
+
+private:
+	void removeEntity(Entity entity);
+	void registerComponent(const ComponentUID& cmp);
+	void deserializeNames(InputBlob& serializer);
+	void rebuildSpatialHash();
+	void onEntityCreated(Entity entity);
+	void onEntityDestroyed(Entity entity);
+	void onEntityMoved(Entity entity);
+
 private:
 	IAllocator& m_allocator;
 	Array<Transformation> m_transformations;
@@ -89,6 +122,11 @@ private:
 	DelegateList<void(const ComponentUID&)> m_component_destroyed;
 	DelegateList<void(const ComponentUID&)> m_component_added;
 	int m_first_free_slot;
+	ComponentMap m_components;
+	ComponentMap m_reloaded_components;
+	IScene* m_reloaded_scene;
+	CommandQueue m_command_queue;
+	SpatialHash m_spatial_hash;
 };
 
 
@@ -1,6 +1,7 @@
 #include "core/crc32.h"
 #include "core/input_system.h"
 #include "core/lua_wrapper.h"
+#include "core/math_utils.h"
 #include "engine.h"
 #include "engine/plugin_manager.h"
 #include "iplugin.h"
@@ -116,6 +117,79 @@ static int getEntityDirection(lua_State* L)
 }
 
 
+static void pushEntities(lua_State* L, const int* entities, int count)
+{
+	lua_createtable(L, count, 0);
+	for (int i = 0; i < count; ++i)
+	{
+		lua_pushinteger(L, entities[i]);
+		lua_rawseti(L, -2, i + 1);
+	}
+}
+
+
+static int getEntitiesInRadius(lua_State* L)
+{
+	if (!LuaWrapper::checkParameterType<void*>(L, 1) ||
+		!LuaWrapper::checkParameterType<Vec3>(L, 2) ||
+		!LuaWrapper::checkParameterType<float>(L, 3))
+	{
+		lua_pushnil(L);
+		return 1;
+	}
+
+	auto* universe = LuaWrapper::toType<Universe*>(L, 1);
+	Vec3 center = LuaWrapper::toType<Vec3>(L, 2);
+	float radius = LuaWrapper::toType<float>(L, 3);
+	Array<int> entities(universe->getAllocator());
+	universe->getSpatialHash().getInRadius(center, radius, entities);
+	pushEntities(L, entities.empty() ? nullptr : &entities[0], entities.size());
+	return 1;
+}
+
+
+static int getEntitiesInBox(lua_State* L)
+{
+	if (!LuaWrapper::checkParameterType<void*>(L, 1) ||
+		!LuaWrapper::checkParameterType<Vec3>(L, 2) ||
+		!LuaWrapper::checkParameterType<Vec3>(L, 3))
+	{
+		lua_pushnil(L);
+		return 1;
+	}
+
+	auto* universe = LuaWrapper::toType<Universe*>(L, 1);
+	Vec3 min = LuaWrapper::toType<Vec3>(L, 2);
+	Vec3 max = LuaWrapper::toType<Vec3>(L, 3);
+	Array<int> entities(universe->getAllocator());
+	universe->getSpatialHash().getInAABB(min, max, entities);
+	pushEntities(L, entities.empty() ? nullptr : &entities[0], entities.size());
+	return 1;
+}
+
+
+static int getNearestEntities(lua_State* L)
+{
+	if (!LuaWrapper::checkParameterType<void*>(L, 1) ||
+		!LuaWrapper::checkParameterType<Vec3>(L, 2) ||
+		!LuaWrapper::checkParameterType<float>(L, 3) ||
+		!LuaWrapper::checkParameterType<int>(L, 4))
+	{
+		lua_pushnil(L);
+		return 1;
+	}
+
+	auto* universe = LuaWrapper::toType<Universe*>(L, 1);
+	Vec3 point = LuaWrapper::toType<Vec3>(L, 2);
+	float max_distance = LuaWrapper::toType<float>(L, 3);
+	int entities[64];
+	int max_count = Math::clamp(LuaWrapper::toType<int>(L, 4), 1, lengthOf(entities));
+	int count = universe->getSpatialHash().getNearest(point, max_distance, max_count, entities);
+	pushEntities(L, entities, count);
+	return 1;
+}
+
+
 static int multVecQuat(lua_State* L)
 {
 	if (!LuaWrapper::checkParameterType<Vec3>(L, 1) ||
@@ -246,6 +320,9 @@ void registerEngineLuaAPI(LuaScriptScene& scene, Engine& engine, lua_State* L)
 	scene.registerFunction("Engine", "multVecQuat", &LuaAPI::multVecQuat);
 	scene.registerFunction("Engine", "getEntityPosition", &LuaAPI::getEntityPosition);
 	scene.registerFunction("Engine", "getEntityDirection", &LuaAPI::getEntityDirection);
+	scene.registerFunction("Engine", "getEntitiesInRadius", &LuaAPI::getEntitiesInRadius);
+	scene.registerFunction("Engine", "getEntitiesInBox", &LuaAPI::getEntitiesInBox);
+	scene.registerFunction("Engine", "getNearestEntities", &LuaAPI::getNearestEntities);
 
 	#undef REGISTER_FUNCTION
 }
@@ -1,5 +1,6 @@
 #include "physics/physics_scene.h"
 #include "cooking/PxCooking.h"
+#include "core/array.h"
 #include "core/blob.h"
 #include "core/crc32.h"
 #include "core/fs/file_system.h"
@@ -30,6 +31,7 @@ static const uint32 BOX_ACTOR_HASH = crc32("box_rigid_actor");
 static const uint32 MESH_ACTOR_HASH = crc32("mesh_rigid_actor");
 static const uint32 CONTROLLER_HASH = crc32("physical_controller");
 static const uint32 HEIGHTFIELD_HASH = crc32("physical_heightfield");
+static const uint32 RENDERER_HASH = crc32("renderer");
 
 
 namespace LuaAPI
@@ -101,6 +103,12 @@ static void applyForceToActor(IScene* scene, int component, Vec3 force)
 }
 
 
+static void updateHeightfieldData(IScene* scene, int component, int x, int y, int width, int height)
+{
+	static_cast<PhysicsScene*>(scene)->updateHeightfieldData(component, x, y, width, height);
+}
+
+
 } // namespace LuaAPI
 
 
@@ -192,7 +200,15 @@ static void matrix2Transform(const Matrix& mtx, physx::PxTransform& transform)
 class Terrain
 {
 public:
-	Terrain();
+	struct TileActor
+	{
+		// the render terrain's tile heightmap the actor was created from
+		Texture* heightmap;
+		physx::PxRigidActor* actor;
+	};
+
+public:
+	explicit Terrain(IAllocator& allocator);
 	~Terrain();
 	void heightmapLoaded(Resource::State, Resource::State new_state);
 
@@ -202,6 +218,8 @@ public:
 	Texture* m_heightmap;
 	float m_xz_scale;
 	float m_y_scale;
+	// if the render terrain on the entity is tiled, only its resident tiles collide
+	Array<TileActor> m_tile_actors;
 };
 
 
@@ -439,6 +457,7 @@ struct PhysicsSceneImpl : public PhysicsScene
 		if (type == HEIGHTFIELD_HASH)
 		{
 			Entity entity = m_terrains[cmp]->m_entity;
+			releaseTileActors(*m_terrains[cmp]);
 			LUMIX_DELETE(m_allocator, m_terrains[cmp]);
 			m_terrains[cmp] = nullptr;
 			m_universe.destroyComponent(entity, type, this, cmp);
@@ -466,7 +485,7 @@ struct PhysicsSceneImpl : public PhysicsScene
 
 	ComponentIndex createHeightfield(Entity entity)
 	{
-		Terrain* terrain = LUMIX_NEW(m_allocator, Terrain)();
+		Terrain* terrain = LUMIX_NEW(m_allocator, Terrain)(m_allocator);
 		m_terrains.push(terrain);
 		terrain->m_heightmap = nullptr;
 		terrain->m_scene = this;
@@ -559,6 +578,7 @@ struct PhysicsSceneImpl : public PhysicsScene
 		if (scale != m_terrains[cmp]->m_xz_scale)
 		{
 			m_terrains[cmp]->m_xz_scale = scale;
+			releaseTileActors(*m_terrains[cmp]);
 			if (m_terrains[cmp]->m_heightmap &&
 				m_terrains[cmp]->m_heightmap->isReady())
 			{
@@ -568,6 +588,48 @@ struct PhysicsSceneImpl : public PhysicsScene
 	}
 
 
+	void updateHeightfieldData(ComponentIndex cmp, int x, int y, int width, int height) override
+	{
+		PROFILE_FUNCTION();
+		Terrain* terrain = m_terrains[cmp];
+		if (!terrain || !terrain->m_actor || !terrain->m_heightmap) return;
+		const Texture& heightmap = *terrain->m_heightmap;
+		if (!heightmap.getData()) return;
+
+		int to_x = Math::minValue(x + width, heightmap.getWidth());
+		int to_y = Math::minValue(y + height, heightmap.getHeight());
+		x = Math::maxValue(x, 0);
+		y = Math::maxValue(y, 0);
+		if (x >= to_x || y >= to_y) return;
+
+		physx::PxShape* shape;
+		physx::PxHeightFieldGeometry geom;
+		if (terrain->m_actor->getShapes(&shape, 1) != 1 || !shape->getHeightFieldGeometry(geom))
+		{
+			return;
+		}
+
+		Array<physx::PxHeightFieldSample> samples(m_allocator);
+		samples.resize((to_x - x) * (to_y - y));
+		copyHeightfieldSamples(heightmap, x, y, to_x - x, to_y - y, &samples[0]);
+
+		physx::PxHeightFieldDesc desc;
+		desc.format = physx::PxHeightFieldFormat::eS16_TM;
+		desc.nbRows = to_x - x;
+		desc.nbColumns = to_y - y;
+		desc.samples.data = &samples[0];
+		desc.samples.stride = sizeof(physx::PxHeightFieldSample);
+		if (!geom.heightField->modifySamples(y, x, desc, true))
+		{
+			g_log_error.log("PhysX") << "Could not update PhysX heightfield "
+									 << heightmap.getPath().c_str();
+			return;
+		}
+		// the scene keeps the shape's bounds until its geometry is set again
+		shape->setGeometry(geom);
+	}
+
+
 	float getHeightmapYScale(ComponentIndex cmp) override
 	{
 		return m_terrains[cmp]->m_y_scale;
@@ -579,6 +641,7 @@ struct PhysicsSceneImpl : public PhysicsScene
 		if (scale != m_terrains[cmp]->m_y_scale)
 		{
 			m_terrains[cmp]->m_y_scale = scale;
+			releaseTileActors(*m_terrains[cmp]);
 			if (m_terrains[cmp]->m_heightmap && m_terrains[cmp]->m_heightmap->isReady())
 			{
 				heightmapLoaded(m_terrains[cmp]);
@@ -731,6 +794,7 @@ struct PhysicsSceneImpl : public PhysicsScene
 
 	void update(float time_delta) override
 	{
+		updateHeightfieldTiles();
 		if (!m_is_game_running) return;
 		
 		applyQueuedForces();
@@ -769,6 +833,7 @@ struct PhysicsSceneImpl : public PhysicsScene
 		REGISTER_FUNCTION(getActorComponent);
 		REGISTER_FUNCTION(putToSleep);
 		REGISTER_FUNCTION(getActorSpeed);
+		REGISTER_FUNCTION(updateHeightfieldData);
 		m_script_scene->registerFunction("Physics", "raycast", LuaAPI::raycast);
 
 #undef REGISTER_FUNCTION
@@ -893,101 +958,166 @@ struct PhysicsSceneImpl : public PhysicsScene
 	void heightmapLoaded(Terrain* terrain)
 	{
 		PROFILE_FUNCTION();
-		Array<physx::PxHeightFieldSample> heights(m_allocator);
+		releaseHeightfieldActor(terrain->m_actor);
+		terrain->m_actor = createHeightfieldActor(
+			*terrain->m_heightmap, m_universe.getMatrix(terrain->m_entity), *terrain);
+	}
 
-		int width = terrain->m_heightmap->getWidth();
-		int height = terrain->m_heightmap->getHeight();
-		heights.resize(width * height);
-		int bytes_per_pixel = terrain->m_heightmap->getBytesPerPixel();
-		if (bytes_per_pixel == 2)
+
+	void releaseHeightfieldActor(physx::PxRigidActor* actor)
+	{
+		if (!actor) return;
+		m_scene->removeActor(*actor);
+		actor->release();
+	}
+
+
+	// actors are recreated by the next updateHeightfieldTiles
+	void releaseTileActors(Terrain& terrain)
+	{
+		for (auto& tile : terrain.m_tile_actors)
 		{
-			PROFILE_BLOCK("copyData");
-			const uint16* LUMIX_RESTRICT data =
-				(const uint16*)terrain->m_heightmap->getData();
-			for (int j = 0; j < height; ++j)
+			releaseHeightfieldActor(tile.actor);
+			tile.actor = nullptr;
+			tile.heightmap = nullptr;
+		}
+	}
+
+
+	// tiles follow the streaming of the tiled render terrain on the same entity
+	void updateHeightfieldTiles()
+	{
+		auto* render_scene = static_cast<RenderScene*>(m_universe_context.getScene(RENDERER_HASH));
+		if (!render_scene) return;
+
+		for (auto* terrain : m_terrains)
+		{
+			if (!terrain) continue;
+
+			ComponentIndex cmp = render_scene->getTerrainComponent(terrain->m_entity);
+			int tile_count = cmp < 0 ? 0 : render_scene->getTerrainTileCount(cmp);
+			if (terrain->m_tile_actors.size() != tile_count * tile_count)
 			{
-				int idx = j * width;
-				for (int i = 0; i < width; ++i)
+				releaseTileActors(*terrain);
+				terrain->m_tile_actors.resize(tile_count * tile_count);
+				for (auto& tile : terrain->m_tile_actors)
 				{
-					int idx2 = j + i * height;
-					heights[idx].height = data[idx2];
-					heights[idx].materialIndex0 = heights[idx].materialIndex1 =
-						0;
-					heights[idx].setTessFlag();
-					++idx;
+					tile.heightmap = nullptr;
+					tile.actor = nullptr;
 				}
 			}
+			if (tile_count == 0) continue;
+
+			PROFILE_BLOCK("tiles");
+			float tile_size = render_scene->getTerrainTileSize(cmp) * terrain->m_xz_scale;
+			for (int i = 0; i < terrain->m_tile_actors.size(); ++i)
+			{
+				int x = i % tile_count;
+				int z = i / tile_count;
+				Terrain::TileActor& tile = terrain->m_tile_actors[i];
+				Texture* heightmap = render_scene->getTerrainTileHeightmap(cmp, x, z);
+				if (heightmap == tile.heightmap) continue;
+
+				releaseHeightfieldActor(tile.actor);
+				tile.actor = nullptr;
+				tile.heightmap = heightmap;
+				if (!heightmap) continue;
+
+				Matrix mtx = m_universe.getMatrix(terrain->m_entity);
+				mtx.setTranslation(mtx.multiplyPosition(Vec3(x * tile_size, 0, z * tile_size)));
+				tile.actor = createHeightfieldActor(*heightmap, mtx, *terrain);
+			}
 		}
-		else
+	}
+
+
+	// heightfield rows go along the x axis of the heightmap, columns along its y axis
+	static void copyHeightfieldSamples(const Texture& heightmap,
+		int x,
+		int y,
+		int width,
+		int height,
+		physx::PxHeightFieldSample* LUMIX_RESTRICT samples)
+	{
+		PROFILE_FUNCTION();
+		int bytes_per_pixel = heightmap.getBytesPerPixel();
+		int stride = heightmap.getWidth();
+		for (int i = 0; i < width; ++i)
 		{
-			PROFILE_BLOCK("copyData");
-			const uint8* data = terrain->m_heightmap->getData();
-			for (int j = 0; j < height; ++j)
+			physx::PxHeightFieldSample* row = samples + i * height;
+			if (bytes_per_pixel == 2)
+			{
+				const uint16* data = (const uint16*)heightmap.getData() + x + i + y * stride;
+				for (int j = 0; j < height; ++j)
+				{
+					row[j].height = data[j * stride];
+				}
+			}
+			else
 			{
-				for (int i = 0; i < width; ++i)
+				const uint8* data = heightmap.getData() + (x + i + y * stride) * bytes_per_pixel;
+				for (int j = 0; j < height; ++j)
 				{
-					int idx = i + j * width;
-					int idx2 = j + i * height;
-					heights[idx].height = data[idx2 * bytes_per_pixel];
-					heights[idx].materialIndex0 = heights[idx].materialIndex1 =
-						0;
-					heights[idx].setTessFlag();
+					row[j].height = data[j * stride * bytes_per_pixel];
 				}
 			}
+			for (int j = 0; j < height; ++j)
+			{
+				row[j].materialIndex0 = row[j].materialIndex1 = 0;
+				row[j].setTessFlag();
+			}
 		}
+	}
+
+
+	physx::PxRigidActor* createHeightfieldActor(const Texture& heightmap,
+		const Matrix& mtx,
+		const Terrain& terrain)
+	{
+		PROFILE_FUNCTION();
+		Array<physx::PxHeightFieldSample> heights(m_allocator);
 
+		int width = heightmap.getWidth();
+		int height = heightmap.getHeight();
+		int bytes_per_pixel = heightmap.getBytesPerPixel();
+		heights.resize(width * height);
+		copyHeightfieldSamples(heightmap, 0, 0, width, height, &heights[0]);
+
+		physx::PxRigidActor* actor;
 		{ // PROFILE_BLOCK scope
 			PROFILE_BLOCK("PhysX");
 			physx::PxHeightFieldDesc hfDesc;
 			hfDesc.format = physx::PxHeightFieldFormat::eS16_TM;
-			hfDesc.nbColumns = width;
-			hfDesc.nbRows = height;
+			hfDesc.nbColumns = height;
+			hfDesc.nbRows = width;
 			hfDesc.samples.data = &heights[0];
 			hfDesc.samples.stride = sizeof(physx::PxHeightFieldSample);
 			hfDesc.thickness = -1;
 
-			physx::PxHeightField* heightfield =
-				m_system->getPhysics()->createHeightField(hfDesc);
-			float height_scale =
-				bytes_per_pixel == 2 ? 1 / (256 * 256.0f - 1) : 1 / 255.0f;
+			physx::PxHeightField* heightfield = m_system->getPhysics()->createHeightField(hfDesc);
+			float height_scale = bytes_per_pixel == 2 ? 1 / (256 * 256.0f - 1) : 1 / 255.0f;
 			physx::PxHeightFieldGeometry hfGeom(heightfield,
-												physx::PxMeshGeometryFlags(),
-												height_scale *
-													terrain->m_y_scale,
-												terrain->m_xz_scale,
-												terrain->m_xz_scale);
-			if (terrain->m_actor)
-			{
-				physx::PxRigidActor* actor = terrain->m_actor;
-				m_scene->removeActor(*actor);
-				actor->release();
-				terrain->m_actor = nullptr;
-			}
+				physx::PxMeshGeometryFlags(),
+				height_scale * terrain.m_y_scale,
+				terrain.m_xz_scale,
+				terrain.m_xz_scale);
 
 			physx::PxTransform transform;
-			Matrix mtx = m_universe.getMatrix(terrain->m_entity);
 			matrix2Transform(mtx, transform);
 
-			physx::PxRigidActor* actor;
-			actor = PxCreateStatic(*m_system->getPhysics(),
-								   transform,
-								   hfGeom,
-								   *m_default_material);
-			if (actor)
-			{
-				actor->setActorFlag(physx::PxActorFlag::eVISUALIZATION,
-									width <= 1024);
-				actor->userData = (void*)terrain->m_entity;
-				m_scene->addActor(*actor);
-				terrain->m_actor = actor;
-			}
-			else
-			{
-				g_log_error.log("PhysX")
-					<< "Could not create PhysX heightfield "
-					<< terrain->m_heightmap->getPath().c_str();
-			}
+			actor = PxCreateStatic(*m_system->getPhysics(), transform, hfGeom, *m_default_material);
+		}
+		if (!actor)
+		{
+			g_log_error.log("PhysX") << "Could not create PhysX heightfield "
+									 << heightmap.getPath().c_str();
+			return nullptr;
 		}
+
+		actor->setActorFlag(physx::PxActorFlag::eVISUALIZATION, width <= 1024);
+		actor->userData = (void*)terrain.m_entity;
+		m_scene->addActor(*actor);
+		return actor;
 	}
 
 
@@ -1349,7 +1479,7 @@ struct PhysicsSceneImpl : public PhysicsScene
 			{
 				if (!m_terrains[i])
 				{
-					m_terrains[i] = LUMIX_NEW(m_allocator, Terrain);
+					m_terrains[i] = LUMIX_NEW(m_allocator, Terrain)(m_allocator);
 				}
 				m_terrains[i]->m_scene = this;
 				serializer.read(m_terrains[i]->m_entity);
@@ -1486,15 +1616,7 @@ PhysicsScene* PhysicsScene::create(PhysicsSystem& system,
 	impl->m_engine = &engine;
 	physx::PxSceneDesc sceneDesc(system.getPhysics()->getTolerancesScale());
 	sceneDesc.gravity = physx::PxVec3(0.0f, -9.8f, 0.0f);
-	if (!sceneDesc.cpuDispatcher)
-	{
-		physx::PxDefaultCpuDispatcher* cpu_dispatcher = physx::PxDefaultCpuDispatcherCreate(1);
-		if (!cpu_dispatcher)
-		{
-			g_log_error.log("physics") << "PxDefaultCpuDispatcherCreate failed!";
-		}
-		sceneDesc.cpuDispatcher = cpu_dispatcher;
-	}
+	sceneDesc.cpuDispatcher = system.getCpuDispatcher();
 	if (!sceneDesc.filterShader)
 	{
 		sceneDesc.filterShader = &physx::PxDefaultSimulationFilterShader;
@@ -1601,7 +1723,8 @@ void PhysicsSceneImpl::RigidActor::setResource(PhysicsGeometry* resource)
 }
 
 
-Terrain::Terrain()
+Terrain::Terrain(IAllocator& allocator)
+	: m_tile_actors(allocator)
 {
 	m_heightmap = nullptr;
 	m_xz_scale = 1.0f;
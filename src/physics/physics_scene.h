@@ -49,6 +49,8 @@ class LUMIX_PHYSICS_API PhysicsScene : public IScene
 		virtual void setHeightmapXZScale(ComponentIndex cmp, float scale) = 0;
 		virtual float getHeightmapYScale(ComponentIndex cmp) = 0;
 		virtual void setHeightmapYScale(ComponentIndex cmp, float scale) = 0;
+		// copies a changed rectangle of the heightmap, in pixels, into the existing heightfield
+		virtual void updateHeightfieldData(ComponentIndex cmp, int x, int y, int width, int height) = 0;
 		virtual ComponentIndex getActorComponent(Entity entity) = 0;
 
 		virtual void applyForceToActor(ComponentIndex cmp, const Vec3& force) = 0;
@@ -4,9 +4,17 @@
 
 #include "cooking/PxCooking.h"
 #include "core/base_proxy_allocator.h"
+#include "core/command_line_parser.h"
 #include "core/crc32.h"
 #include "core/log.h"
+#include "core/math_utils.h"
+#include "core/mt/atomic.h"
+#include "core/mtjd/generic_job.h"
+#include "core/mtjd/manager.h"
+#include "core/profiler.h"
 #include "core/resource_manager.h"
+#include "core/string.h"
+#include "core/system.h"
 #include "editor/world_editor.h"
 #include "engine.h"
 #include "physics/physics_geometry_manager.h"
@@ -26,6 +34,62 @@ static const uint32 HEIGHTFIELD_HASH = crc32("physical_heightfield");
 
 
 
+// PhysX tasks become MTJD jobs, so physics shares the engine's worker threads instead of
+// spawning its own
+struct JobDispatcher : public physx::PxCpuDispatcher
+{
+	// MTJD's ready queue is fixed size and blocks when full, PhysX tasks submitted over
+	// this limit run on the submitting thread instead
+	static const int32 MAX_QUEUED_TASKS = 128;
+
+
+	JobDispatcher(MTJD::Manager& manager, IAllocator& allocator)
+		: m_manager(manager)
+		, m_allocator(allocator)
+		, m_worker_count(manager.getCpuThreadsCount())
+		, m_queued_count(0)
+	{
+	}
+
+
+	static void runTask(physx::PxBaseTask& task)
+	{
+		PROFILE_BLOCK("PhysX task");
+		task.run();
+		task.release();
+	}
+
+
+	void submitTask(physx::PxBaseTask& task) override
+	{
+		if (MT::atomicIncrement(&m_queued_count) > MAX_QUEUED_TASKS)
+		{
+			MT::atomicDecrement(&m_queued_count);
+			runTask(task);
+			return;
+		}
+
+		MTJD::Job* job = MTJD::makeJob(m_manager,
+			[this, &task]()
+			{
+				MT::atomicDecrement(&m_queued_count);
+				runTask(task);
+			},
+			m_allocator);
+		m_manager.schedule(job);
+	}
+
+
+	physx::PxU32 getWorkerCount() const override { return m_worker_count; }
+
+
+	MTJD::Manager& m_manager;
+	IAllocator& m_allocator;
+	int m_worker_count;
+	volatile int32 m_queued_count;
+};
+
+
 struct PhysicsSystemImpl : public PhysicsSystem
 {
 	PhysicsSystemImpl(Engine& engine)
@@ -50,8 +114,28 @@ struct PhysicsSystemImpl : public PhysicsSystem
 	{
 		return m_cooking;
 	}
+
+
+	physx::PxCpuDispatcher* getCpuDispatcher() override
+	{
+		return m_cpu_dispatcher;
+	}
+
+
+	int getWorkerCount() const override
+	{
+		return m_cpu_dispatcher->m_worker_count;
+	}
+
+
+	void setWorkerCount(int count) override
+	{
+		int max_count = (int)m_engine.getMTJDManager().getCpuThreadsCount();
+		m_cpu_dispatcher->m_worker_count = Math::clamp(count, 1, max_count);
+	}
 	
 	bool connect2VisualDebugger();
+	void parseCommandLine();
 
 	physx::PxPhysics*			m_physics;
 	physx::PxFoundation*		m_foundation;
@@ -59,6 +143,7 @@ struct PhysicsSystemImpl : public PhysicsSystem
 	physx::PxAllocatorCallback*	m_physx_allocator;
 	physx::PxErrorCallback*		m_error_callback;
 	physx::PxCooking*			m_cooking;
+	JobDispatcher*				m_cpu_dispatcher;
 	PhysicsGeometryManager		m_manager;
 	class Engine&				m_engine;
 	class BaseProxyAllocator	m_allocator;
@@ -172,15 +257,44 @@ bool PhysicsSystemImpl::create()
 	
 	physx::PxTolerancesScale scale;
 	m_cooking = PxCreateCooking(PX_PHYSICS_VERSION, *m_foundation, physx::PxCookingParams(scale));
+	m_cpu_dispatcher = LUMIX_NEW(m_allocator, JobDispatcher)(m_engine.getMTJDManager(), m_allocator);
+	parseCommandLine();
 	connect2VisualDebugger();
 	return true;
 }
 
 
+void PhysicsSystemImpl::parseCommandLine()
+{
+	char cmd_line[2048];
+	getCommandLine(cmd_line, lengthOf(cmd_line));
+
+	CommandLineParser parser(cmd_line);
+	while (parser.next())
+	{
+		if (!parser.currentEquals("-physics_workers")) continue;
+		if (!parser.next()) break;
+
+		char tmp[32];
+		parser.getCurrent(tmp, lengthOf(tmp));
+		int count;
+		if (fromCString(tmp, stringLength(tmp), &count))
+		{
+			setWorkerCount(count);
+		}
+		else
+		{
+			g_log_error.log("physics") << "Invalid -physics_workers value " << tmp;
+		}
+	}
+}
+
+
 void PhysicsSystemImpl::destroy()
 {
 	m_cooking->release();
 	m_physics->release();
+	LUMIX_DELETE(m_allocator, m_cpu_dispatcher);
 	m_foundation->release();
 	LUMIX_DELETE(m_allocator, m_physx_allocator);
 	LUMIX_DELETE(m_allocator, m_error_callback);
@@ -10,6 +10,7 @@ namespace physx
 
 	class PxControllerManager;
 	class PxCooking;
+	class PxCpuDispatcher;
 	class PxPhysics;
 
 } // namespace physx
@@ -28,6 +29,12 @@ class LUMIX_PHYSICS_API PhysicsSystem : public IPlugin
 		
 		virtual physx::PxPhysics* getPhysics() = 0;
 		virtual physx::PxCooking* getCooking() = 0;
+		// runs PhysX tasks of all scenes on the engine's MTJD workers
+		virtual physx::PxCpuDispatcher* getCpuDispatcher() = 0;
+		// how many tasks PhysX splits simulation into, from 1 to the number of MTJD workers,
+		// -physics_workers N on the command line sets the initial value
+		virtual int getWorkerCount() const = 0;
+		virtual void setWorkerCount(int count) = 0;
 
 	protected:
 		PhysicsSystem() {}
@@ -20,6 +20,17 @@ typedef Array<int> SphereToRenderableMap;
 
 static const int MIN_ENTITIES_PER_THREAD = 50;
 
+
+template <typename T> static void copyArray(Array<T>& dst, const Array<T>& src)
+{
+	dst.clear();
+	dst.reserve(src.size());
+	for (const T& item : src)
+	{
+		dst.push(item);
+	}
+}
+
 static void doCulling(int start_index,
 	const Sphere* LUMIX_RESTRICT start,
 	const Sphere* LUMIX_RESTRICT end,
@@ -322,6 +333,16 @@ public:
 	}
 
 
+	void copyFrom(const CullingSystem& src) override
+	{
+		auto& impl = static_cast<const CullingSystemImpl&>(src);
+		copyArray(m_spheres, impl.m_spheres);
+		copyArray(m_layer_masks, impl.m_layer_masks);
+		copyArray(m_renderable_to_sphere_map, impl.m_renderable_to_sphere_map);
+		copyArray(m_sphere_to_renderable_map, impl.m_sphere_to_renderable_map);
+	}
+
+
 private:
 	IAllocator& m_allocator;
 	FreeList<CullingJob, 16> m_job_allocator;
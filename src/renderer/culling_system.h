@@ -41,5 +41,7 @@ namespace Lumix
 
 		virtual void insert(const InputSpheres& spheres, const Array<ComponentIndex>& renderables) = 0;
 		virtual const Sphere& getSphere(ComponentIndex renderable) = 0;
+		// replaces the spheres and layer masks with the ones in src, keeps the allocated memory
+		virtual void copyFrom(const CullingSystem& src) = 0;
 	};
 } // ~namespace Lux
\ No newline at end of file
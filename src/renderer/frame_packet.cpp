@@ -0,0 +1,42 @@
+#include "frame_packet.h"
+#include "renderer/culling_system.h"
+
+
+namespace Lumix
+{
+
+
+FramePacket::FramePacket(MTJD::Manager& mtjd_manager, IAllocator& allocator)
+	: renderable_matrices(allocator)
+	, bone_offsets(allocator)
+	, bone_counts(allocator)
+	, bone_matrices(allocator)
+	, particles(allocator)
+	, particle_instances(allocator)
+	, point_lights(allocator)
+	, time(0)
+{
+	culling_system = CullingSystem::create(mtjd_manager, allocator);
+}
+
+
+FramePacket::~FramePacket()
+{
+	CullingSystem::destroy(*culling_system);
+}
+
+
+void FramePacket::clear()
+{
+	renderable_matrices.clear();
+	bone_offsets.clear();
+	bone_counts.clear();
+	bone_matrices.clear();
+	particles.clear();
+	particle_instances.clear();
+	point_lights.clear();
+	time = 0;
+}
+
+
+} // namespace Lumix
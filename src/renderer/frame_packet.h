@@ -0,0 +1,70 @@
+#pragma once
+
+
+#include "lumix.h"
+#include "core/array.h"
+#include "core/matrix.h"
+#include "core/vec.h"
+
+
+namespace Lumix
+{
+
+
+class CullingSystem;
+class Material;
+namespace MTJD
+{
+class Manager;
+}
+
+
+// Render-relevant state copied out of RenderScene once per simulation step, rendering reads
+// this instead of live scene data, so the next update can run while a packet is rendered.
+struct LUMIX_RENDERER_API FramePacket
+{
+	struct Particles
+	{
+		ComponentIndex emitter;
+		Material* material;
+		int offset;
+		int count;
+		// bounding sphere of the particles including their size
+		Vec3 center;
+		float radius;
+	};
+
+	struct PointLight
+	{
+		ComponentIndex light;
+		Vec3 position;
+		float range;
+	};
+
+	// layout of the particle shader's instance data
+	struct ParticleInstance
+	{
+		Vec4 pos_and_size;
+		Vec4 alpha_and_rotation;
+	};
+
+	FramePacket(MTJD::Manager& mtjd_manager, IAllocator& allocator);
+	~FramePacket();
+	void clear();
+
+	// indexed by renderable component
+	Array<Matrix> renderable_matrices;
+	// index of the renderable's first skinning matrix in bone_matrices, -1 if not skinned
+	Array<int> bone_offsets;
+	Array<int> bone_counts;
+	Array<Matrix> bone_matrices;
+	Array<Particles> particles;
+	Array<ParticleInstance> particle_instances;
+	Array<PointLight> point_lights;
+	// copy of the scene's bounding spheres and layer masks, frustum culling runs on this copy
+	CullingSystem* culling_system;
+	float time;
+};
+
+
+} // namespace Lumix
@@ -0,0 +1,208 @@
+#include "light_grid.h"
+#include "core/math_utils.h"
+#include "core/profiler.h"
+#include <cmath>
+
+
+namespace Lumix
+{
+
+
+LightGrid::LightGrid(IAllocator& allocator)
+	: m_indices(allocator)
+	, m_cluster_lights(allocator)
+	, m_lights(allocator)
+	, m_lights_pos_radius(allocator)
+	, m_marks(allocator)
+	, m_mark(0)
+	, m_near(0.1f)
+	, m_far(100.0f)
+	, m_slice_scale(0)
+	, m_tan_x(1)
+	, m_tan_y(1)
+{
+	m_view = Matrix::IDENTITY;
+	clear();
+}
+
+
+void LightGrid::clear()
+{
+	for (auto& cluster : m_clusters)
+	{
+		cluster.offset = 0;
+		cluster.count = 0;
+	}
+	m_indices.clear();
+	m_lights.clear();
+	m_lights_pos_radius.clear();
+	m_marks.clear();
+}
+
+
+int LightGrid::getSlice(float depth) const
+{
+	if (depth <= m_near) return 0;
+	int slice = (int)(logf(depth / m_near) * m_slice_scale);
+	return Math::minValue(slice, SIZE_Z - 1);
+}
+
+
+float LightGrid::getSliceDepth(int slice) const
+{
+	return m_near * powf(m_far / m_near, slice / (float)SIZE_Z);
+}
+
+
+static int toTile(float ndc, int size)
+{
+	int tile = (int)((ndc * 0.5f + 0.5f) * size);
+	return Math::clamp(tile, 0, size - 1);
+}
+
+
+template <typename T>
+void LightGrid::forEachCluster(const Vec3& view_pos, float radius, T& callback) const
+{
+	float depth = -view_pos.z;
+	if (depth + radius < m_near || depth - radius > m_far) return;
+
+	int first_slice = getSlice(depth - radius);
+	int last_slice = getSlice(depth + radius);
+	for (int z = first_slice; z <= last_slice; ++z)
+	{
+		// x / depth is monotonic in depth, so the sphere's bounding box projected to the part
+		// of the slice it overlaps is bounded by its values at the slice's depth range ends
+		float d0 = Math::maxValue(getSliceDepth(z), depth - radius);
+		float d1 = Math::minValue(getSliceDepth(z + 1), depth + radius);
+		if (d0 > d1) continue;
+
+		float min_x = Math::minValue((view_pos.x - radius) / d0, (view_pos.x - radius) / d1);
+		float max_x = Math::maxValue((view_pos.x + radius) / d0, (view_pos.x + radius) / d1);
+		float min_y = Math::minValue((view_pos.y - radius) / d0, (view_pos.y - radius) / d1);
+		float max_y = Math::maxValue((view_pos.y + radius) / d0, (view_pos.y + radius) / d1);
+		min_x /= m_tan_x;
+		max_x /= m_tan_x;
+		min_y /= m_tan_y;
+		max_y /= m_tan_y;
+		if (min_x > 1 || max_x < -1 || min_y > 1 || max_y < -1) continue;
+
+		int first_x = toTile(min_x, SIZE_X);
+		int last_x = toTile(max_x, SIZE_X);
+		int first_y = toTile(min_y, SIZE_Y);
+		int last_y = toTile(max_y, SIZE_Y);
+		for (int y = first_y; y <= last_y; ++y)
+		{
+			for (int x = first_x; x <= last_x; ++x)
+			{
+				callback(x + SIZE_X * (y + SIZE_Y * z));
+			}
+		}
+	}
+}
+
+
+void LightGrid::build(const Matrix& camera_mtx,
+	float fov,
+	float ratio,
+	float near_plane,
+	float far_plane,
+	const ComponentIndex* lights,
+	const Vec4* lights_pos_radius,
+	int light_count)
+{
+	PROFILE_FUNCTION();
+
+	clear();
+	m_cluster_lights.clear();
+
+	m_view = camera_mtx;
+	m_view.fastInverse();
+	m_near = near_plane;
+	m_far = far_plane;
+	m_slice_scale = SIZE_Z / logf(far_plane / near_plane);
+	m_tan_y = tanf(fov * 0.5f);
+	m_tan_x = m_tan_y * ratio;
+
+	for (int i = 0; i < light_count; ++i)
+	{
+		Vec3 view_pos = m_view.multiplyPosition(lights_pos_radius[i].xyz());
+		float radius = lights_pos_radius[i].w;
+		int light_index = m_lights.size();
+		int pairs_count = m_cluster_lights.size();
+
+		auto add = [this, light_index](int cluster) {
+			auto& pair = m_cluster_lights.emplace();
+			pair.cluster = cluster;
+			pair.light = light_index;
+			++m_clusters[cluster].count;
+		};
+		forEachCluster(view_pos, radius, add);
+
+		if (pairs_count == m_cluster_lights.size()) continue;
+		m_lights.push(lights[i]);
+		m_lights_pos_radius.push(lights_pos_radius[i]);
+	}
+
+	int offset = 0;
+	for (auto& cluster : m_clusters)
+	{
+		cluster.offset = offset;
+		offset += cluster.count;
+		cluster.count = 0;
+	}
+
+	m_indices.resize(m_cluster_lights.size());
+	for (const auto& pair : m_cluster_lights)
+	{
+		Cluster& cluster = m_clusters[pair.cluster];
+		m_indices[cluster.offset + cluster.count] = pair.light;
+		++cluster.count;
+	}
+
+	m_marks.resize(m_lights.size());
+	for (auto& mark : m_marks) mark = 0;
+	m_mark = 0;
+}
+
+
+int LightGrid::getClusterIndex(const Vec3& world_pos) const
+{
+	Vec3 view_pos = m_view.multiplyPosition(world_pos);
+	float depth = -view_pos.z;
+	if (depth < m_near || depth > m_far) return -1;
+
+	float x = view_pos.x / (depth * m_tan_x);
+	float y = view_pos.y / (depth * m_tan_y);
+	if (x < -1 || x > 1 || y < -1 || y > 1) return -1;
+
+	return toTile(x, SIZE_X) + SIZE_X * (toTile(y, SIZE_Y) + SIZE_Y * getSlice(depth));
+}
+
+
+void LightGrid::getLights(const Vec3& center, float radius, Array<int>& light_indices)
+{
+	if (m_lights.empty()) return;
+
+	++m_mark;
+	Vec3 view_pos = m_view.multiplyPosition(center);
+	auto gather = [this, &center, radius, &light_indices](int cluster_index) {
+		const Cluster& cluster = m_clusters[cluster_index];
+		for (int i = cluster.offset, end = cluster.offset + cluster.count; i < end; ++i)
+		{
+			int light = m_indices[i];
+			if (m_marks[light] == m_mark) continue;
+			m_marks[light] = m_mark;
+
+			const Vec4& light_pos_radius = m_lights_pos_radius[light];
+			float max_dist = light_pos_radius.w + radius;
+			if ((light_pos_radius.xyz() - center).squaredLength() > max_dist * max_dist) continue;
+
+			light_indices.push(light);
+		}
+	};
+	forEachCluster(view_pos, radius, gather);
+}
+
+
+} // namespace Lumix
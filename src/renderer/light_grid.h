@@ -0,0 +1,83 @@
+#pragma once
+
+
+#include "lumix.h"
+#include "core/array.h"
+#include "core/matrix.h"
+#include "core/vec.h"
+
+
+namespace Lumix
+{
+
+
+// Camera-space cluster grid (froxels) with a light index list per cluster. X and Y are
+// uniform screen tiles, Z slices are distributed exponentially between near and far plane.
+class LUMIX_RENDERER_API LightGrid
+{
+public:
+	static const int SIZE_X = 16;
+	static const int SIZE_Y = 8;
+	static const int SIZE_Z = 24;
+	static const int CLUSTER_COUNT = SIZE_X * SIZE_Y * SIZE_Z;
+
+	struct Cluster
+	{
+		int offset;
+		int count;
+	};
+
+public:
+	explicit LightGrid(IAllocator& allocator);
+
+	void build(const Matrix& camera_mtx,
+		float fov,
+		float ratio,
+		float near_plane,
+		float far_plane,
+		const ComponentIndex* lights,
+		const Vec4* lights_pos_radius,
+		int light_count);
+	void clear();
+
+	int getClusterIndex(const Vec3& world_pos) const;
+	void getLights(const Vec3& center, float radius, Array<int>& light_indices);
+
+	int getLightCount() const { return m_lights.size(); }
+	ComponentIndex getLight(int index) const { return m_lights[index]; }
+	const Vec4& getLightPosRadius(int index) const { return m_lights_pos_radius[index]; }
+	const Cluster* getClusters() const { return m_clusters; }
+	const Array<int>& getIndices() const { return m_indices; }
+	// x = near plane, y = slice scale, z = tan(fov / 2) * ratio, w = tan(fov / 2)
+	// slice = log(depth / near) * slice scale
+	Vec4 getParams() const { return Vec4(m_near, m_slice_scale, m_tan_x, m_tan_y); }
+
+private:
+	struct ClusterLight
+	{
+		int cluster;
+		int light;
+	};
+
+	template <typename T> void forEachCluster(const Vec3& view_pos, float radius, T& callback) const;
+	int getSlice(float depth) const;
+	float getSliceDepth(int slice) const;
+
+private:
+	Cluster m_clusters[CLUSTER_COUNT];
+	Array<int> m_indices;
+	Array<ClusterLight> m_cluster_lights;
+	Array<ComponentIndex> m_lights;
+	Array<Vec4> m_lights_pos_radius;
+	Array<uint32> m_marks;
+	uint32 m_mark;
+	Matrix m_view;
+	float m_near;
+	float m_far;
+	float m_slice_scale;
+	float m_tan_x;
+	float m_tan_y;
+};
+
+
+} // namespace Lumix
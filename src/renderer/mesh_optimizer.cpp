@@ -0,0 +1,364 @@
+#include "mesh_optimizer.h"
+#include "core/array.h"
+#include "core/math_utils.h"
+#include "core/profiler.h"
+#include "core/radix_sort.h"
+#include "core/string.h"
+#include "core/vec.h"
+#include <cmath>
+
+
+namespace Lumix
+{
+
+
+namespace
+{
+
+
+// LRU cache size the triangle scores are tuned for, the order is good for smaller FIFOs too
+const int SCORING_CACHE_SIZE = 32;
+// used to find cluster boundaries for overdraw sorting
+const int OVERDRAW_CACHE_SIZE = 16;
+
+
+float getVertexScore(int cache_position, int live_triangles)
+{
+	if (live_triangles == 0) return -1;
+
+	float score = 0;
+	if (cache_position >= 0)
+	{
+		// the last triangle's vertices are scored equally, so it does not matter in which
+		// order they were added
+		if (cache_position < 3)
+		{
+			score = 0.75f;
+		}
+		else
+		{
+			float position = (cache_position - 3) / float(SCORING_CACHE_SIZE - 3);
+			score = powf(1 - position, 1.5f);
+		}
+	}
+	// vertices with few triangles left are finished first, so they leave the cache for good
+	return score + 2 / sqrtf((float)live_triangles);
+}
+
+
+// triangles around each vertex, triangles of vertex v are triangles[offsets[v]..offsets[v + 1])
+void buildAdjacency(const int* indices,
+	int index_count,
+	int vertex_count,
+	Array<int>& offsets,
+	Array<int>& triangles)
+{
+	offsets.resize(vertex_count + 1);
+	setMemory(offsets.begin(), 0, sizeof(offsets[0]) * offsets.size());
+	for (int i = 0; i < index_count; ++i)
+	{
+		++offsets[indices[i] + 1];
+	}
+	for (int i = 0; i < vertex_count; ++i)
+	{
+		offsets[i + 1] += offsets[i];
+	}
+
+	triangles.resize(index_count);
+	for (int i = 0; i < index_count; ++i)
+	{
+		int& offset = offsets[indices[i]];
+		triangles[offset] = i / 3;
+		++offset;
+	}
+	for (int i = vertex_count; i > 0; --i)
+	{
+		offsets[i] = offsets[i - 1];
+	}
+	offsets[0] = 0;
+}
+
+
+// maps float to uint32 with the same ordering, negative values included
+uint32 toSortable(float value)
+{
+	uint32 bits;
+	copyMemory(&bits, &value, sizeof(bits));
+	return (bits & 0x80000000) ? ~bits : bits | 0x80000000;
+}
+
+
+} // anonymous namespace
+
+
+float computeACMR(const int* indices,
+	int index_count,
+	int vertex_count,
+	int cache_size,
+	IAllocator& allocator)
+{
+	if (index_count == 0) return 0;
+
+	// a vertex is in the FIFO if less than cache_size misses happened since it was added
+	Array<int> timestamps(allocator);
+	timestamps.resize(vertex_count);
+	setMemory(timestamps.begin(), 0, sizeof(timestamps[0]) * vertex_count);
+	int timestamp = cache_size + 1;
+	int misses = 0;
+	for (int i = 0; i < index_count; ++i)
+	{
+		int vertex = indices[i];
+		if (timestamp - timestamps[vertex] > cache_size)
+		{
+			timestamps[vertex] = timestamp;
+			++timestamp;
+			++misses;
+		}
+	}
+	return misses / float(index_count / 3);
+}
+
+
+void optimizeVertexCache(const int* indices,
+	int index_count,
+	int vertex_count,
+	int* out_indices,
+	IAllocator& allocator)
+{
+	PROFILE_FUNCTION();
+
+	int triangle_count = index_count / 3;
+	if (triangle_count == 0) return;
+
+	Array<int> offsets(allocator);
+	Array<int> triangles(allocator);
+	buildAdjacency(indices, index_count, vertex_count, offsets, triangles);
+
+	Array<int> live_triangles(allocator);
+	Array<int> cache_positions(allocator);
+	Array<float> vertex_scores(allocator);
+	live_triangles.resize(vertex_count);
+	cache_positions.resize(vertex_count);
+	vertex_scores.resize(vertex_count);
+	for (int i = 0; i < vertex_count; ++i)
+	{
+		live_triangles[i] = offsets[i + 1] - offsets[i];
+		cache_positions[i] = -1;
+		vertex_scores[i] = getVertexScore(-1, live_triangles[i]);
+	}
+
+	Array<float> triangle_scores(allocator);
+	Array<uint8> is_emitted(allocator);
+	triangle_scores.resize(triangle_count);
+	is_emitted.resize(triangle_count);
+	setMemory(is_emitted.begin(), 0, triangle_count);
+	int best_triangle = 0;
+	for (int i = 0; i < triangle_count; ++i)
+	{
+		const int* tri = &indices[i * 3];
+		triangle_scores[i] =
+			vertex_scores[tri[0]] + vertex_scores[tri[1]] + vertex_scores[tri[2]];
+		if (triangle_scores[i] > triangle_scores[best_triangle]) best_triangle = i;
+	}
+
+	int cache[SCORING_CACHE_SIZE + 3];
+	int cache_count = 0;
+	int next_unemitted = 0;
+	for (int i = 0; i < triangle_count; ++i)
+	{
+		// nothing in the cache has triangles left, start anywhere
+		if (best_triangle < 0)
+		{
+			while (is_emitted[next_unemitted]) ++next_unemitted;
+			best_triangle = next_unemitted;
+		}
+
+		const int* tri = &indices[best_triangle * 3];
+		out_indices[i * 3] = tri[0];
+		out_indices[i * 3 + 1] = tri[1];
+		out_indices[i * 3 + 2] = tri[2];
+		is_emitted[best_triangle] = 1;
+
+		for (int j = 0; j < 3; ++j)
+		{
+			int vertex = tri[j];
+			int* vertex_triangles = &triangles[offsets[vertex]];
+			int& live = live_triangles[vertex];
+			for (int k = 0; k < live; ++k)
+			{
+				if (vertex_triangles[k] != best_triangle) continue;
+				vertex_triangles[k] = vertex_triangles[live - 1];
+				vertex_triangles[live - 1] = best_triangle;
+				--live;
+				break;
+			}
+		}
+
+		int new_cache[SCORING_CACHE_SIZE + 3];
+		int new_cache_count = 3;
+		new_cache[0] = tri[0];
+		new_cache[1] = tri[1];
+		new_cache[2] = tri[2];
+		for (int j = 0; j < cache_count; ++j)
+		{
+			int vertex = cache[j];
+			if (vertex == tri[0] || vertex == tri[1] || vertex == tri[2]) continue;
+			new_cache[new_cache_count] = vertex;
+			++new_cache_count;
+		}
+
+		for (int j = 0; j < new_cache_count; ++j)
+		{
+			int vertex = new_cache[j];
+			cache_positions[vertex] = j < SCORING_CACHE_SIZE ? j : -1;
+			vertex_scores[vertex] = getVertexScore(cache_positions[vertex], live_triangles[vertex]);
+		}
+
+		best_triangle = -1;
+		float best_score = -1;
+		for (int j = 0; j < new_cache_count; ++j)
+		{
+			int vertex = new_cache[j];
+			for (int k = offsets[vertex], end = k + live_triangles[vertex]; k < end; ++k)
+			{
+				int triangle = triangles[k];
+				const int* t = &indices[triangle * 3];
+				float score = vertex_scores[t[0]] + vertex_scores[t[1]] + vertex_scores[t[2]];
+				triangle_scores[triangle] = score;
+				if (score > best_score)
+				{
+					best_score = score;
+					best_triangle = triangle;
+				}
+			}
+		}
+
+		cache_count = Math::minValue(new_cache_count, SCORING_CACHE_SIZE);
+		copyMemory(cache, new_cache, sizeof(cache[0]) * cache_count);
+	}
+}
+
+
+void optimizeOverdraw(int* indices,
+	int index_count,
+	const Vec3* positions,
+	int vertex_count,
+	IAllocator& allocator)
+{
+	PROFILE_FUNCTION();
+
+	int triangle_count = index_count / 3;
+	if (triangle_count == 0) return;
+
+	// clusters start where all three vertices miss the cache, reordering them costs nothing
+	Array<int> cluster_starts(allocator);
+	Array<int> timestamps(allocator);
+	timestamps.resize(vertex_count);
+	setMemory(timestamps.begin(), 0, sizeof(timestamps[0]) * vertex_count);
+	int timestamp = OVERDRAW_CACHE_SIZE + 1;
+	for (int i = 0; i < triangle_count; ++i)
+	{
+		int misses = 0;
+		for (int j = 0; j < 3; ++j)
+		{
+			int vertex = indices[i * 3 + j];
+			if (timestamp - timestamps[vertex] > OVERDRAW_CACHE_SIZE)
+			{
+				timestamps[vertex] = timestamp;
+				++timestamp;
+				++misses;
+			}
+		}
+		if (misses == 3) cluster_starts.push(i);
+	}
+	cluster_starts.push(triangle_count);
+	int cluster_count = cluster_starts.size() - 1;
+	if (cluster_count < 2) return;
+
+	Vec3 mesh_center(0, 0, 0);
+	float mesh_area = 0;
+	for (int i = 0; i < index_count; i += 3)
+	{
+		const Vec3& p0 = positions[indices[i]];
+		const Vec3& p1 = positions[indices[i + 1]];
+		const Vec3& p2 = positions[indices[i + 2]];
+		float area = crossProduct(p1 - p0, p2 - p0).length();
+		mesh_center += (p0 + p1 + p2) * (area / 3);
+		mesh_area += area;
+	}
+	if (mesh_area > 0) mesh_center *= 1 / mesh_area;
+
+	Array<uint64> keys(allocator);
+	Array<uint64> tmp_keys(allocator);
+	Array<int> values(allocator);
+	Array<int> tmp_values(allocator);
+	keys.resize(cluster_count);
+	tmp_keys.resize(cluster_count);
+	values.resize(cluster_count);
+	tmp_values.resize(cluster_count);
+	for (int i = 0; i < cluster_count; ++i)
+	{
+		Vec3 center(0, 0, 0);
+		Vec3 normal(0, 0, 0);
+		float area = 0;
+		for (int j = cluster_starts[i] * 3, end = cluster_starts[i + 1] * 3; j < end; j += 3)
+		{
+			const Vec3& p0 = positions[indices[j]];
+			const Vec3& p1 = positions[indices[j + 1]];
+			const Vec3& p2 = positions[indices[j + 2]];
+			Vec3 triangle_normal = crossProduct(p1 - p0, p2 - p0);
+			float triangle_area = triangle_normal.length();
+			center += (p0 + p1 + p2) * (triangle_area / 3);
+			normal += triangle_normal;
+			area += triangle_area;
+		}
+		if (area > 0) center *= 1 / area;
+		float normal_length = normal.length();
+		float facing = normal_length > 0
+						   ? dotProduct(center - mesh_center, normal) / normal_length
+						   : 0;
+
+		// descending, the most outward facing cluster first
+		keys[i] = toSortable(-facing);
+		values[i] = i;
+	}
+	radixSort(keys.begin(), values.begin(), tmp_keys.begin(), tmp_values.begin(), cluster_count);
+
+	Array<int> sorted(allocator);
+	sorted.resize(index_count);
+	int offset = 0;
+	for (int i = 0; i < cluster_count; ++i)
+	{
+		int cluster = values[i];
+		int from = cluster_starts[cluster] * 3;
+		int count = cluster_starts[cluster + 1] * 3 - from;
+		copyMemory(&sorted[offset], &indices[from], sizeof(indices[0]) * count);
+		offset += count;
+	}
+	copyMemory(indices, sorted.begin(), sizeof(indices[0]) * index_count);
+}
+
+
+int optimizeVertexFetch(int* indices, int index_count, int vertex_count, int* remap)
+{
+	for (int i = 0; i < vertex_count; ++i)
+	{
+		remap[i] = -1;
+	}
+
+	int used_count = 0;
+	for (int i = 0; i < index_count; ++i)
+	{
+		int& vertex = indices[i];
+		if (remap[vertex] < 0)
+		{
+			remap[vertex] = used_count;
+			++used_count;
+		}
+		vertex = remap[vertex];
+	}
+	return used_count;
+}
+
+
+} // namespace Lumix
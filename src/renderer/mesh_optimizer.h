@@ -0,0 +1,50 @@
+#pragma once
+
+
+#include "lumix.h"
+
+
+namespace Lumix
+{
+
+
+class IAllocator;
+struct Vec3;
+
+
+// Average cache miss ratio, i.e. vertex shader invocations per triangle, of a FIFO
+// post-transform cache; 0.5 is the optimum for big regular meshes, 3 the worst case.
+LUMIX_RENDERER_API float computeACMR(const int* indices,
+	int index_count,
+	int vertex_count,
+	int cache_size,
+	IAllocator& allocator);
+
+// Reorders triangles for the post-transform vertex cache (Forsyth, "Linear-Speed Vertex
+// Cache Optimisation"). out_indices must hold index_count elements and must not alias indices.
+LUMIX_RENDERER_API void optimizeVertexCache(const int* indices,
+	int index_count,
+	int vertex_count,
+	int* out_indices,
+	IAllocator& allocator);
+
+// Splits the triangle order at points where the vertex cache starts from scratch anyway and
+// sorts these clusters so the ones facing away from the mesh center are drawn first, which
+// occlude the rest more often (Sander et al., "Fast Triangle Reordering for Vertex Locality
+// and Reduced Overdraw"). Keeps the vertex cache order inside clusters.
+LUMIX_RENDERER_API void optimizeOverdraw(int* indices,
+	int index_count,
+	const Vec3* positions,
+	int vertex_count,
+	IAllocator& allocator);
+
+// Renumbers vertices in the order of their first use, so vertex fetch walks the buffer
+// linearly. Fills remap[old_index] with the new index or -1 for unused vertices, rewrites
+// indices and returns the number of used vertices.
+LUMIX_RENDERER_API int optimizeVertexFetch(int* indices,
+	int index_count,
+	int vertex_count,
+	int* remap);
+
+
+} // namespace Lumix
@@ -0,0 +1,341 @@
+#include "mesh_simplifier.h"
+#include "core/array.h"
+#include "core/math_utils.h"
+#include "core/profiler.h"
+#include "core/radix_sort.h"
+#include "core/string.h"
+#include "core/vec.h"
+
+
+namespace Lumix
+{
+
+
+namespace
+{
+
+
+// symmetric 4x4 matrix of the sum of squared distances to a set of planes
+struct Quadric
+{
+	float a2, ab, ac, ad;
+	float b2, bc, bd;
+	float c2, cd;
+	float d2;
+};
+
+
+struct Collapse
+{
+	int from;
+	int to;
+};
+
+
+void addPlane(Quadric& q, const Vec3& normal, float d, float weight)
+{
+	float a = normal.x;
+	float b = normal.y;
+	float c = normal.z;
+	q.a2 += weight * a * a;
+	q.ab += weight * a * b;
+	q.ac += weight * a * c;
+	q.ad += weight * a * d;
+	q.b2 += weight * b * b;
+	q.bc += weight * b * c;
+	q.bd += weight * b * d;
+	q.c2 += weight * c * c;
+	q.cd += weight * c * d;
+	q.d2 += weight * d * d;
+}
+
+
+void addQuadric(Quadric& q, const Quadric& r)
+{
+	q.a2 += r.a2;
+	q.ab += r.ab;
+	q.ac += r.ac;
+	q.ad += r.ad;
+	q.b2 += r.b2;
+	q.bc += r.bc;
+	q.bd += r.bd;
+	q.c2 += r.c2;
+	q.cd += r.cd;
+	q.d2 += r.d2;
+}
+
+
+float evaluate(const Quadric& q, const Vec3& v)
+{
+	float error = q.a2 * v.x * v.x + q.b2 * v.y * v.y + q.c2 * v.z * v.z + q.d2 +
+				  2 * (q.ab * v.x * v.y + q.ac * v.x * v.z + q.bc * v.y * v.z) +
+				  2 * (q.ad * v.x + q.bd * v.y + q.cd * v.z);
+	// rounding can push the error of a point on all planes slightly below zero
+	return Math::maxValue(error, 0.0f);
+}
+
+
+void computeQuadrics(const Vec3* positions,
+	const int* indices,
+	int index_count,
+	Quadric* quadrics,
+	int vertex_count)
+{
+	setMemory(quadrics, 0, sizeof(quadrics[0]) * vertex_count);
+	for (int i = 0; i < index_count; i += 3)
+	{
+		const Vec3& p0 = positions[indices[i]];
+		Vec3 normal = crossProduct(positions[indices[i + 1]] - p0, positions[indices[i + 2]] - p0);
+		float length = normal.length();
+		if (length == 0) continue;
+
+		normal *= 1 / length;
+		float d = -dotProduct(normal, p0);
+		// weighted by area, so big triangles keep their shape
+		float area = length * 0.5f;
+		for (int j = 0; j < 3; ++j)
+		{
+			addPlane(quadrics[indices[i + j]], normal, d, area);
+		}
+	}
+}
+
+
+// an edge used by exactly one triangle is open, used by more than two it is non-manifold;
+// moving a vertex of such edge would tear or fold the mesh
+void lockOpenEdges(const int* indices, int index_count, uint8* locked, IAllocator& allocator)
+{
+	Array<uint64> keys(allocator);
+	Array<uint64> tmp_keys(allocator);
+	Array<int> values(allocator);
+	Array<int> tmp_values(allocator);
+	keys.resize(index_count);
+	tmp_keys.resize(index_count);
+	values.resize(index_count);
+	tmp_values.resize(index_count);
+	for (int i = 0; i < index_count; ++i)
+	{
+		uint64 a = (uint32)indices[i];
+		uint64 b = (uint32)indices[i % 3 == 2 ? i - 2 : i + 1];
+		keys[i] = a < b ? (a << 32) | b : (b << 32) | a;
+		values[i] = i;
+	}
+	radixSort(keys.begin(), values.begin(), tmp_keys.begin(), tmp_values.begin(), index_count);
+
+	for (int i = 0; i < index_count;)
+	{
+		int end = i + 1;
+		while (end < index_count && keys[end] == keys[i]) ++end;
+		if (end - i != 2)
+		{
+			locked[keys[i] >> 32] = 1;
+			locked[keys[i] & 0xffffFFFF] = 1;
+		}
+		i = end;
+	}
+}
+
+
+// triangles around each vertex, triangles of vertex v are triangles[offsets[v]..offsets[v + 1])
+void buildAdjacency(const int* indices,
+	int index_count,
+	int vertex_count,
+	Array<int>& offsets,
+	Array<int>& triangles)
+{
+	offsets.resize(vertex_count + 1);
+	setMemory(offsets.begin(), 0, sizeof(offsets[0]) * offsets.size());
+	for (int i = 0; i < index_count; ++i)
+	{
+		++offsets[indices[i] + 1];
+	}
+	for (int i = 0; i < vertex_count; ++i)
+	{
+		offsets[i + 1] += offsets[i];
+	}
+
+	triangles.resize(index_count);
+	for (int i = 0; i < index_count; ++i)
+	{
+		int& offset = offsets[indices[i]];
+		triangles[offset] = i / 3;
+		++offset;
+	}
+	for (int i = vertex_count; i > 0; --i)
+	{
+		offsets[i] = offsets[i - 1];
+	}
+	offsets[0] = 0;
+}
+
+
+bool isFlipping(int from,
+	int to,
+	const Vec3* positions,
+	const int* indices,
+	const Array<int>& offsets,
+	const Array<int>& triangles)
+{
+	for (int i = offsets[from]; i < offsets[from + 1]; ++i)
+	{
+		const int* tri = &indices[triangles[i] * 3];
+		if (tri[0] == to || tri[1] == to || tri[2] == to) continue;
+
+		Vec3 p[3];
+		Vec3 q[3];
+		for (int j = 0; j < 3; ++j)
+		{
+			p[j] = positions[tri[j]];
+			q[j] = tri[j] == from ? positions[to] : p[j];
+		}
+		Vec3 n0 = crossProduct(p[1] - p[0], p[2] - p[0]);
+		Vec3 n1 = crossProduct(q[1] - q[0], q[2] - q[0]);
+		if (dotProduct(n0, n1) <= 0) return true;
+	}
+	return false;
+}
+
+
+int removeDegenerateTriangles(int* indices, int index_count, const int* remap)
+{
+	int count = 0;
+	for (int i = 0; i < index_count; i += 3)
+	{
+		int a = remap[indices[i]];
+		int b = remap[indices[i + 1]];
+		int c = remap[indices[i + 2]];
+		if (a == b || b == c || c == a) continue;
+
+		indices[count] = a;
+		indices[count + 1] = b;
+		indices[count + 2] = c;
+		count += 3;
+	}
+	return count;
+}
+
+
+} // anonymous namespace
+
+
+int simplifyMesh(const Vec3* positions,
+	int vertex_count,
+	const int* indices,
+	int index_count,
+	int target_index_count,
+	int* out_indices,
+	IAllocator& allocator)
+{
+	PROFILE_FUNCTION();
+
+	copyMemory(out_indices, indices, sizeof(indices[0]) * index_count);
+	int count = index_count;
+	if (count <= target_index_count) return count;
+
+	Array<Quadric> quadrics(allocator);
+	quadrics.resize(vertex_count);
+	computeQuadrics(positions, out_indices, count, quadrics.begin(), vertex_count);
+
+	Array<uint8> locked(allocator);
+	locked.resize(vertex_count);
+	setMemory(locked.begin(), 0, vertex_count);
+	lockOpenEdges(out_indices, count, locked.begin(), allocator);
+
+	Array<int> offsets(allocator);
+	Array<int> triangles(allocator);
+	Array<Collapse> collapses(allocator);
+	Array<uint64> keys(allocator);
+	Array<uint64> tmp_keys(allocator);
+	Array<int> values(allocator);
+	Array<int> tmp_values(allocator);
+	Array<int> remap(allocator);
+	Array<uint8> touched(allocator);
+	remap.resize(vertex_count);
+	touched.resize(vertex_count);
+
+	// every pass collapses an independent set of the cheapest edges, i.e. no two collapses
+	// in a pass share a triangle, so adjacency and costs stay valid within the pass
+	while (count > target_index_count)
+	{
+		buildAdjacency(out_indices, count, vertex_count, offsets, triangles);
+
+		collapses.clear();
+		for (int i = 0; i < count; ++i)
+		{
+			int a = out_indices[i];
+			int b = out_indices[i % 3 == 2 ? i - 2 : i + 1];
+			if (!locked[a])
+			{
+				Collapse& collapse = collapses.emplace();
+				collapse.from = a;
+				collapse.to = b;
+			}
+			if (!locked[b])
+			{
+				Collapse& collapse = collapses.emplace();
+				collapse.from = b;
+				collapse.to = a;
+			}
+		}
+		if (collapses.empty()) break;
+
+		int collapse_count = collapses.size();
+		keys.resize(collapse_count);
+		tmp_keys.resize(collapse_count);
+		values.resize(collapse_count);
+		tmp_values.resize(collapse_count);
+		for (int i = 0; i < collapse_count; ++i)
+		{
+			const Collapse& collapse = collapses[i];
+			Quadric q = quadrics[collapse.from];
+			addQuadric(q, quadrics[collapse.to]);
+			// bits of a non-negative float sort the same way as the float
+			float cost = evaluate(q, positions[collapse.to]);
+			uint32 cost_bits;
+			copyMemory(&cost_bits, &cost, sizeof(cost_bits));
+			keys[i] = cost_bits;
+			values[i] = i;
+		}
+		radixSort(keys.begin(), values.begin(), tmp_keys.begin(), tmp_values.begin(), collapse_count);
+
+		for (int i = 0; i < vertex_count; ++i)
+		{
+			remap[i] = i;
+		}
+		setMemory(touched.begin(), 0, vertex_count);
+
+		// the cheaper half first, more expensive edges wait for a pass with updated quadrics
+		int pass_limit = Math::maxValue(1, collapse_count / 2);
+		int triangles_to_remove = (count - target_index_count + 2) / 3;
+		int removed = 0;
+		for (int i = 0; i < collapse_count && removed < triangles_to_remove; ++i)
+		{
+			if (i >= pass_limit && removed > 0) break;
+
+			const Collapse& collapse = collapses[values[i]];
+			int from = collapse.from;
+			int to = collapse.to;
+			if (touched[from] || touched[to]) continue;
+			if (isFlipping(from, to, positions, out_indices, offsets, triangles)) continue;
+
+			remap[from] = to;
+			addQuadric(quadrics[to], quadrics[from]);
+			for (int j = offsets[from]; j < offsets[from + 1]; ++j)
+			{
+				const int* tri = &out_indices[triangles[j] * 3];
+				if (tri[0] == to || tri[1] == to || tri[2] == to) ++removed;
+				touched[tri[0]] = 1;
+				touched[tri[1]] = 1;
+				touched[tri[2]] = 1;
+			}
+		}
+		if (removed == 0) break;
+
+		count = removeDegenerateTriangles(out_indices, count, remap.begin());
+	}
+
+	return count;
+}
+
+
+} // namespace Lumix
@@ -0,0 +1,30 @@
+#pragma once
+
+
+#include "lumix.h"
+
+
+namespace Lumix
+{
+
+
+class IAllocator;
+struct Vec3;
+
+
+// Quadric error metric simplification (Garland & Heckbert) by half-edge collapses, i.e. a
+// vertex is always moved onto one of its neighbours, so the result indexes the source
+// vertices and no new vertex data is needed. Vertices on open edges (mesh borders and
+// attribute seams) are never moved. Returns the number of indices written to out_indices,
+// which must hold index_count elements; stops above target_index_count if no collapse
+// that keeps triangle orientation is left.
+LUMIX_RENDERER_API int simplifyMesh(const Vec3* positions,
+	int vertex_count,
+	const int* indices,
+	int index_count,
+	int target_index_count,
+	int* out_indices,
+	IAllocator& allocator);
+
+
+} // namespace Lumix
@@ -6,6 +6,7 @@
 #include "core/fs/file_system.h"
 #include "core/fs/ifile.h"
 #include "core/log.h"
+#include "core/math_utils.h"
 #include "core/path_utils.h"
 #include "core/profiler.h"
 #include "core/resource_manager.h"
@@ -41,7 +42,6 @@ Mesh::Mesh(const bgfx::VertexDecl& def,
 	m_index_count = index_count;
 	m_name_hash = crc32(name);
 	m_name = name;
-	m_instance_idx = -1;
 }
 
 
@@ -149,12 +149,26 @@ RayCastModelHit Model::castRay(const Vec3& origin,
 
 LODMeshIndices Model::getLODMeshIndices(float squared_distance) const
 {
+	return getLODMeshIndicesByIndex(getLODIndex(squared_distance));
+}
+
+
+int Model::getLODIndex(float squared_distance) const
+{
+	// the last LOD's distance is FLT_MAX, but an infinite or NaN distance would run past it
 	int i = 0;
-	while (squared_distance >= m_lods[i].m_distance)
+	int last = m_lods.size() - 1;
+	while (i < last && !(squared_distance < m_lods[i].m_distance))
 	{
 		++i;
 	}
-	return LODMeshIndices(m_lods[i].m_from_mesh, m_lods[i].m_to_mesh);
+	return i;
+}
+
+
+LODMeshIndices Model::getLODMeshIndicesByIndex(int lod_index) const
+{
+	return LODMeshIndices(m_lods[lod_index].m_from_mesh, m_lods[lod_index].m_to_mesh);
 }
 
 
@@ -52,8 +52,6 @@ public:
 	const char* getName() const { return m_name.c_str(); }
 	void setVertexDefinition(const bgfx::VertexDecl& def) { m_vertex_def = def; }
 	const bgfx::VertexDecl& getVertexDefinition() const { return m_vertex_def; }
-	int getInstanceIdx() const { return m_instance_idx; }
-	void setInstanceIdx(int value) { m_instance_idx = value; }
 
 private:
 	Mesh(const Mesh&);
@@ -61,7 +59,6 @@ private:
 
 private:
 	bgfx::VertexDecl m_vertex_def;
-	int32 m_instance_idx;
 	int32 m_attribute_array_offset;
 	int32 m_attribute_array_size;
 	int32 m_indices_offset;
@@ -117,6 +114,7 @@ public:
 		int m_from_mesh;
 		int m_to_mesh;
 
+		// squared distance where the next LOD takes over
 		float m_distance;
 	};
 
@@ -148,6 +146,9 @@ public:
 		int attributes_size);
 
 	LODMeshIndices getLODMeshIndices(float squared_distance) const;
+	int getLODIndex(float squared_distance) const;
+	LODMeshIndices getLODMeshIndicesByIndex(int lod_index) const;
+	int getLODCount() const { return m_lods.size(); }
 	Mesh& getMesh(int index) { return m_meshes[index]; }
 	bgfx::VertexBufferHandle getVerticesHandle() const { return m_vertices_handle; }
 	bgfx::IndexBufferHandle getIndicesHandle() const { return m_indices_handle; }
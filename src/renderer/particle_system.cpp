@@ -5,6 +5,7 @@
 #include "core/profiler.h"
 #include "core/resource_manager.h"
 #include "core/resource_manager_base.h"
+#include "core/simd.h"
 #include "renderer/material.h"
 #include "renderer/render_scene.h"
 #include "universe/universe.h"
@@ -87,10 +88,24 @@ void ParticleEmitter::ForceModule::update(float time_delta)
 {
 	if (m_emitter.m_velocity.empty()) return;
 
-	Vec3* LUMIX_RESTRICT particle_velocity = &m_emitter.m_velocity[0];
-	for (int i = 0, c = m_emitter.m_velocity.size(); i < c; ++i)
+	// xyz triplets do not fit 4 lanes, 4 particles are 3 registers with rotated acceleration
+	Vec3 a = m_acceleration * time_delta;
+	float4 a0 = f4Set(a.x, a.y, a.z, a.x);
+	float4 a1 = f4Set(a.y, a.z, a.x, a.y);
+	float4 a2 = f4Set(a.z, a.x, a.y, a.z);
+	float* LUMIX_RESTRICT particle_velocity = &m_emitter.m_velocity[0].x;
+	int count = m_emitter.m_velocity.size();
+	int simd_count = count & ~3;
+	for (int i = 0; i < simd_count * 3; i += 12)
 	{
-		particle_velocity[i] += m_acceleration * time_delta;
+		float* v = particle_velocity + i;
+		f4StoreUnaligned(v, f4Add(f4LoadUnaligned(v), a0));
+		f4StoreUnaligned(v + 4, f4Add(f4LoadUnaligned(v + 4), a1));
+		f4StoreUnaligned(v + 8, f4Add(f4LoadUnaligned(v + 8), a2));
+	}
+	for (int i = simd_count; i < count; ++i)
+	{
+		m_emitter.m_velocity[i] += a;
 	}
 }
 
@@ -123,8 +138,11 @@ void ParticleEmitter::AttractorModule::update(float time_delta)
 {
 	if(m_emitter.m_alpha.empty()) return;
 
-	Vec3* LUMIX_RESTRICT particle_pos = &m_emitter.m_position[0];
-	Vec3* LUMIX_RESTRICT particle_vel = &m_emitter.m_velocity[0];
+	float* LUMIX_RESTRICT particle_pos = &m_emitter.m_position[0].x;
+	float* LUMIX_RESTRICT particle_vel = &m_emitter.m_velocity[0].x;
+	int count = m_emitter.m_position.size();
+	int simd_count = count & ~3;
+	float force = m_force * time_delta;
 
 	for(int i = 0; i < m_count; ++i)
 	{
@@ -133,12 +151,33 @@ void ParticleEmitter::AttractorModule::update(float time_delta)
 		if (!m_emitter.m_universe.hasEntity(entity)) continue;
 		Vec3 pos = m_emitter.m_universe.getPosition(entity);
 
-		for(int i = m_emitter.m_position.size() - 1; i >= 0; --i)
+		float4 center_x = f4Splat(pos.x);
+		float4 center_y = f4Splat(pos.y);
+		float4 center_z = f4Splat(pos.z);
+		float4 force4 = f4Splat(force);
+		for (int j = 0; j < simd_count * 3; j += 12)
+		{
+			float4 x, y, z;
+			float4 vx, vy, vz;
+			f4LoadXYZ(particle_pos + j, x, y, z);
+			f4LoadXYZ(particle_vel + j, vx, vy, vz);
+			x = f4Sub(center_x, x);
+			y = f4Sub(center_y, y);
+			z = f4Sub(center_z, z);
+			float4 dist2 = f4Add(f4Add(f4Mul(x, x), f4Mul(y, y)), f4Mul(z, z));
+			float4 k = f4Div(force4, f4Mul(dist2, f4Sqrt(dist2)));
+			vx = f4Add(vx, f4Mul(x, k));
+			vy = f4Add(vy, f4Mul(y, k));
+			vz = f4Add(vz, f4Mul(z, k));
+			f4StoreXYZ(particle_vel + j, vx, vy, vz);
+		}
+
+		for (int j = simd_count; j < count; ++j)
 		{
-			Vec3 to_center = pos - particle_pos[i];
+			Vec3 to_center = pos - m_emitter.m_position[j];
 			float dist2 = to_center.squaredLength();
 			to_center *= 1 / sqrt(dist2);
-			particle_vel[i] = particle_vel[i] + to_center * (m_force / dist2) * time_delta;
+			m_emitter.m_velocity[j] += to_center * (force / dist2);
 		}
 	}
 }
@@ -211,8 +250,10 @@ void ParticleEmitter::PlaneModule::update(float time_delta)
 {
 	if (m_emitter.m_alpha.empty()) return;
 
-	Vec3* LUMIX_RESTRICT particle_pos = &m_emitter.m_position[0];
-	Vec3* LUMIX_RESTRICT particle_vel = &m_emitter.m_velocity[0];
+	float* LUMIX_RESTRICT particle_pos = &m_emitter.m_position[0].x;
+	float* LUMIX_RESTRICT particle_vel = &m_emitter.m_velocity[0].x;
+	int count = m_emitter.m_position.size();
+	int simd_count = count & ~3;
 
 	for (int i = 0; i < m_count; ++i)
 	{
@@ -222,13 +263,40 @@ void ParticleEmitter::PlaneModule::update(float time_delta)
 		Vec3 normal = m_emitter.m_universe.getRotation(entity) * Vec3(0, 1, 0);
 		float D = -dotProduct(normal, m_emitter.m_universe.getPosition(entity));
 
-		for (int i = m_emitter.m_position.size() - 1; i >= 0; --i)
+		float4 normal_x = f4Splat(normal.x);
+		float4 normal_y = f4Splat(normal.y);
+		float4 normal_z = f4Splat(normal.z);
+		float4 d4 = f4Splat(D);
+		float4 zero = f4Splat(0);
+		float4 two = f4Splat(2);
+		float4 bounce = f4Splat(m_bounce);
+		for (int j = 0; j < simd_count * 3; j += 12)
+		{
+			float4 x, y, z;
+			f4LoadXYZ(particle_pos + j, x, y, z);
+			float4 dist = f4Add(
+				f4Add(f4Add(f4Mul(normal_x, x), f4Mul(normal_y, y)), f4Mul(normal_z, z)), d4);
+			float4 below = f4CmpLT(dist, zero);
+			if (f4MoveMask(below) == 0) continue;
+
+			float4 vx, vy, vz;
+			f4LoadXYZ(particle_vel + j, vx, vy, vz);
+			float4 NdotV2 = f4Mul(
+				two, f4Add(f4Add(f4Mul(normal_x, vx), f4Mul(normal_y, vy)), f4Mul(normal_z, vz)));
+			vx = f4Select(below, f4Mul(f4Sub(vx, f4Mul(normal_x, NdotV2)), bounce), vx);
+			vy = f4Select(below, f4Mul(f4Sub(vy, f4Mul(normal_y, NdotV2)), bounce), vy);
+			vz = f4Select(below, f4Mul(f4Sub(vz, f4Mul(normal_z, NdotV2)), bounce), vz);
+			f4StoreXYZ(particle_vel + j, vx, vy, vz);
+		}
+
+		for (int j = simd_count; j < count; ++j)
 		{
-			const auto& pos = particle_pos[i];
+			const auto& pos = m_emitter.m_position[j];
 			if (dotProduct(normal, pos) + D < 0)
 			{
-				float NdotV = dotProduct(normal, particle_vel[i]);
-				particle_vel[i] = (particle_vel[i] - normal * (2 * NdotV)) * m_bounce;
+				Vec3& vel = m_emitter.m_velocity[j];
+				float NdotV = dotProduct(normal, vel);
+				vel = (vel - normal * (2 * NdotV)) * m_bounce;
 			}
 		}
 	}
@@ -373,6 +441,43 @@ static void sampleBezier(float max_life, const Array<Vec2>& values, Array<float>
 }
 
 
+// value[i] = sampled curve at rel_life[i], linearly interpolated
+static void sampleCurve(const Array<float>& sampled,
+	const float* LUMIX_RESTRICT rel_life,
+	float* LUMIX_RESTRICT value,
+	int count)
+{
+	int size = sampled.size() - 1;
+	float float_size = (float)size;
+	const float* LUMIX_RESTRICT samples = &sampled[0];
+	float4 size4 = f4Splat(float_size);
+	int simd_count = count & ~3;
+	for (int i = 0; i < simd_count; i += 4)
+	{
+		// the lookups are scalar, only index and weight are computed in lanes
+		float4 float_idx = f4Mul(size4, f4LoadUnaligned(rel_life + i));
+		int4 idx4 = f4ToInt4(float_idx);
+		int idx[4];
+		float w[4];
+		i4StoreUnaligned(idx, idx4);
+		f4StoreUnaligned(w, f4Sub(float_idx, i4ToFloat4(idx4)));
+		for (int j = 0; j < 4; ++j)
+		{
+			int next_idx = Math::minValue(idx[j] + 1, size);
+			value[i + j] = samples[idx[j]] * (1 - w[j]) + samples[next_idx] * w[j];
+		}
+	}
+	for (int i = simd_count; i < count; ++i)
+	{
+		float float_idx = float_size * rel_life[i];
+		int idx = (int)float_idx;
+		int next_idx = Math::minValue(idx + 1, size);
+		float w = float_idx - idx;
+		value[i] = samples[idx] * (1 - w) + samples[next_idx] * w;
+	}
+}
+
+
 ParticleEmitter::AlphaModule::AlphaModule(ParticleEmitter& emitter)
 	: ModuleBase(emitter)
 	, m_values(emitter.getAllocator())
@@ -421,18 +526,7 @@ void ParticleEmitter::AlphaModule::update(float)
 {
 	if(m_emitter.m_alpha.empty()) return;
 
-	float* LUMIX_RESTRICT particle_alpha = &m_emitter.m_alpha[0];
-	float* LUMIX_RESTRICT rel_life = &m_emitter.m_rel_life[0];
-	int size = m_sampled.size() - 1;
-	float float_size = (float)size;
-	for(int i = 0, c = m_emitter.m_size.size(); i < c; ++i)
-	{
-		float float_idx = float_size * rel_life[i];
-		int idx = (int)float_idx;
-		int next_idx = Math::minValue(idx + 1, size);
-		float w = float_idx - idx;
-		particle_alpha[i] = m_sampled[idx] * (1 - w) + m_sampled[next_idx] * w;
-	}
+	sampleCurve(m_sampled, &m_emitter.m_rel_life[0], &m_emitter.m_alpha[0], m_emitter.m_alpha.size());
 }
 
 
@@ -487,19 +581,7 @@ void ParticleEmitter::SizeModule::update(float)
 {
 	if (m_emitter.m_size.empty()) return;
 
-	float* LUMIX_RESTRICT particle_size = &m_emitter.m_size[0];
-	float* LUMIX_RESTRICT rel_life = &m_emitter.m_rel_life[0];
-	int size = m_sampled.size() - 1;
-	float float_size = (float)size;
-	for (int i = 0, c = m_emitter.m_size.size(); i < c; ++i)
-	{
-		float float_idx = float_size * rel_life[i];
-		int idx = (int)float_idx;
-		int next_idx = Math::minValue(idx + 1, size);
-		float w = float_idx - idx;
-		particle_size[i] = m_sampled[idx] * (1 - w) + m_sampled[next_idx] * w;
-		PROFILE_INT("Test", int(particle_size[i] * 1000));
-	}
+	sampleCurve(m_sampled, &m_emitter.m_rel_life[0], &m_emitter.m_size[0], m_emitter.m_size.size());
 }
 
 
@@ -638,37 +720,82 @@ void ParticleEmitter::addModule(ModuleBase* module)
 }
 
 
-void ParticleEmitter::destroyParticle(int index)
+void ParticleEmitter::destroyDeadParticles()
 {
-	for (auto* module : m_modules)
+	// one pass, the last alive particle is moved to each dead slot
+	int count = m_rel_life.size();
+	for (int i = 0; i < count;)
 	{
-		module->destoryParticle(index);
+		if (m_rel_life[i] <= 1)
+		{
+			++i;
+			continue;
+		}
+
+		for (auto* module : m_modules)
+		{
+			module->destoryParticle(i);
+		}
+		--count;
+		m_life[i] = m_life[count];
+		m_rel_life[i] = m_rel_life[count];
+		m_position[i] = m_position[count];
+		m_velocity[i] = m_velocity[count];
+		m_rotation[i] = m_rotation[count];
+		m_rotational_speed[i] = m_rotational_speed[count];
+		m_alpha[i] = m_alpha[count];
+		m_size[i] = m_size[count];
 	}
-	m_life.eraseFast(index);
-	m_rel_life.eraseFast(index);
-	m_position.eraseFast(index);
-	m_velocity.eraseFast(index);
-	m_rotation.eraseFast(index);
-	m_rotational_speed.eraseFast(index);
-	m_alpha.eraseFast(index);
-	m_size.eraseFast(index);
+
+	if (count == m_rel_life.size()) return;
+	m_life.resize(count);
+	m_rel_life.resize(count);
+	m_position.resize(count);
+	m_velocity.resize(count);
+	m_rotation.resize(count);
+	m_rotational_speed.resize(count);
+	m_alpha.resize(count);
+	m_size.resize(count);
 }
 
 
 void ParticleEmitter::updateLives(float time_delta)
 {
-	for (int i = 0, c = m_rel_life.size(); i < c; ++i)
+	if (m_rel_life.empty()) return;
+
+	float* LUMIX_RESTRICT rel_life = &m_rel_life[0];
+	const float* LUMIX_RESTRICT life = &m_life[0];
+	int count = m_rel_life.size();
+	int simd_count = count & ~3;
+	float4 time_delta4 = f4Splat(time_delta);
+	for (int i = 0; i < simd_count; i += 4)
+	{
+		float4 rel_life4 = f4LoadUnaligned(rel_life + i);
+		rel_life4 = f4Add(rel_life4, f4Div(time_delta4, f4LoadUnaligned(life + i)));
+		f4StoreUnaligned(rel_life + i, rel_life4);
+	}
+	for (int i = simd_count; i < count; ++i)
 	{
-		float rel_life = m_rel_life[i];
-		rel_life += time_delta / m_life[i];
-		m_rel_life[i] = rel_life;
+		rel_life[i] += time_delta / life[i];
+	}
 
-		if (rel_life > 1)
-		{
-			destroyParticle(i);
-			--i;
-			--c;
-		}
+	destroyDeadParticles();
+}
+
+
+// dst += src * time_delta over count floats
+static void integrate(float* LUMIX_RESTRICT dst, const float* LUMIX_RESTRICT src, int count, float time_delta)
+{
+	int simd_count = count & ~3;
+	float4 time_delta4 = f4Splat(time_delta);
+	for (int i = 0; i < simd_count; i += 4)
+	{
+		float4 value = f4Add(f4LoadUnaligned(dst + i), f4Mul(f4LoadUnaligned(src + i), time_delta4));
+		f4StoreUnaligned(dst + i, value);
+	}
+	for (int i = simd_count; i < count; ++i)
+	{
+		dst[i] += src[i] * time_delta;
 	}
 }
 
@@ -729,19 +856,18 @@ void ParticleEmitter::deserialize(InputBlob& blob, ResourceManager& manager, boo
 
 void ParticleEmitter::updatePositions(float time_delta)
 {
-	for (int i = 0, c = m_position.size(); i < c; ++i)
-	{
-		m_position[i] += m_velocity[i] * time_delta;
-	}
+	if (m_position.empty()) return;
+
+	// positions and velocities are packed xyz, so both are plain float arrays
+	integrate(&m_position[0].x, &m_velocity[0].x, m_position.size() * 3, time_delta);
 }
 
 
 void ParticleEmitter::updateRotations(float time_delta)
 {
-	for (int i = 0, c = m_rotation.size(); i < c; ++i)
-	{
-		m_rotation[i] += m_rotational_speed[i] * time_delta;
-	}
+	if (m_rotation.empty()) return;
+
+	integrate(&m_rotation[0], &m_rotational_speed[0], m_rotation.size(), time_delta);
 }
 
 
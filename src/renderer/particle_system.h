@@ -231,7 +231,7 @@ public:
 
 private:
 	void spawnParticle();
-	void destroyParticle(int index);
+	void destroyDeadParticles();
 	void spawnParticles(float time_delta);
 	void updateLives(float time_delta);
 	void updatePositions(float time_delta);
@@ -11,7 +11,11 @@
 #include "core/lifo_allocator.h"
 #include "core/log.h"
 #include "core/lua_wrapper.h"
+#include "core/mtjd/generic_job.h"
+#include "core/mtjd/group.h"
+#include "core/mtjd/manager.h"
 #include "core/profiler.h"
+#include "core/radix_sort.h"
 #include "core/resource_manager.h"
 #include "core/resource_manager_base.h"
 #include "core/static_array.h"
@@ -19,6 +23,8 @@
 #include "engine.h"
 #include "plugin_manager.h"
 #include "renderer/frame_buffer.h"
+#include "renderer/frame_packet.h"
+#include "renderer/light_grid.h"
 #include "renderer/material.h"
 #include "renderer/model.h"
 #include "renderer/particle_system.h"
@@ -39,19 +45,98 @@ namespace Lumix
 
 static const float SHADOW_CAM_NEAR = 50.0f;
 static const float SHADOW_CAM_FAR = 5000.0f;
+static const int MAX_BATCH_INSTANCE_COUNT = 1024;
+static const int MIN_INSTANCES_PER_JOB = 256;
+static const int MAX_BONE_COUNT = 64;
 
 
-struct InstanceData
+
+struct TerrainInstance
 {
-	static const int MAX_INSTANCE_COUNT = 64;
+	int m_count;
+	const TerrainInfo* m_infos[64];
+};
 
-	const bgfx::InstanceDataBuffer* buffer;
-	int instance_count;
-	Mesh* mesh;
-	Model* model;
+
+struct TerrainInstanceData
+{
+	Vec4 m_quad_min_and_size;
+	Vec4 m_morph_const;
 };
 
 
+struct TerrainBatch
+{
+	TerrainInstance instances;
+	const bgfx::InstanceDataBuffer* instance_buffer;
+};
+
+
+struct PointLightShadowmap
+{
+	ComponentIndex m_light;
+	FrameBuffer* m_framebuffer;
+	Matrix m_matrices[4];
+};
+
+
+struct CachedShadowmap
+{
+	FrameBuffer* framebuffer;
+	ComponentIndex light;
+	uint32 signature;
+	bool is_valid;
+};
+
+
+struct MeshBatch
+{
+	int first;
+	int count;
+	const bgfx::InstanceDataBuffer* instance_buffer;
+	// points into the frame packet, null for instanced batches
+	const Matrix* bone_matrices;
+};
+
+
+// draw call recorded on a MTJD worker and replayed on the main thread, everything except
+// the bgfx calls and the bind cache in setMaterial is resolved while recording
+struct DrawCommand
+{
+	enum Type : uint8
+	{
+		INSTANCED_MESH,
+		SKINNED_MESH,
+		TERRAIN,
+		GRASS
+	};
+
+	Type type;
+	Material* material;
+	uint64 render_states;
+	bgfx::ProgramHandle program;
+	bgfx::VertexBufferHandle vertex_buffer;
+	uint32 first_vertex;
+	uint32 vertex_count;
+	bgfx::IndexBufferHandle index_buffer;
+	uint32 first_index;
+	uint32 index_count;
+	int instance_count;
+	// INSTANCED_MESH and TERRAIN
+	const bgfx::InstanceDataBuffer* instance_buffer;
+	// GRASS
+	bgfx::VertexBufferHandle instance_vertex_buffer;
+	// SKINNED_MESH, point into the frame packet
+	const Matrix* transform;
+	const Matrix* bone_matrices;
+	int bone_count;
+	// TERRAIN
+	const Matrix* terrain_matrix;
+	Vec4 terrain_params;
+	Vec4 rel_camera_pos;
+	Vec4 terrain_scale;
+};
+
 
 struct PipelineImpl : public Pipeline
 {
@@ -222,6 +307,27 @@ struct PipelineInstanceImpl : public PipelineInstance
 		, m_tmp_terrains(allocator)
 		, m_tmp_grasses(allocator)
 		, m_tmp_meshes(allocator)
+		, m_tmp_lights(allocator)
+		, m_tmp_lights_pos_radius(allocator)
+		, m_tmp_light_indices(allocator)
+		, m_tmp_light_items(allocator)
+		, m_tmp_spheres(allocator)
+		, m_light_meshes(allocator)
+		, m_light_mesh_offsets(allocator)
+		, m_light_terrains(allocator)
+		, m_light_terrain_offsets(allocator)
+		, m_light_grasses(allocator)
+		, m_light_grass_offsets(allocator)
+		, m_sort_keys(allocator)
+		, m_tmp_sort_keys(allocator)
+		, m_sort_values(allocator)
+		, m_tmp_sort_values(allocator)
+		, m_mesh_batches(allocator)
+		, m_terrain_batches(allocator)
+		, m_draw_commands(allocator)
+		, m_jobs(allocator)
+		, m_sync_point(true, allocator)
+		, m_light_grid(allocator)
 		, m_framebuffers(allocator)
 		, m_uniforms(allocator)
 		, m_renderer(static_cast<PipelineImpl&>(pipeline).getRenderer())
@@ -229,8 +335,12 @@ struct PipelineInstanceImpl : public PipelineInstance
 		, m_debug_line_material(nullptr)
 		, m_debug_flags(BGFX_DEBUG_TEXT)
 		, m_point_light_shadowmaps(allocator)
+		, m_cached_shadowmaps(allocator)
 		, m_materials(allocator)
 		, m_is_rendering_in_shadowmap(false)
+		, m_bound_material(nullptr)
+		, m_bound_light(INVALID_COMPONENT)
+		, m_is_bound_light_global(false)
 	{
 		m_base_vertex_decl.begin()
 			.add(bgfx::Attrib::Position, 3, bgfx::AttribType::Float)
@@ -240,6 +350,7 @@ struct PipelineInstanceImpl : public PipelineInstance
 
 		m_is_wireframe = false;
 		m_view_x = m_view_y = 0;
+		m_lod_multiplier = 1;
 		m_has_shadowmap_define_idx = m_renderer.getShaderDefineIdx("HAS_SHADOWMAP");
 
 		createUniforms();
@@ -408,50 +519,79 @@ struct PipelineInstanceImpl : public PipelineInstance
 	}
 
 
-	void renderParticles(const ParticleEmitter& emitter)
+	// back to front along the view direction, the result is in m_sort_values
+	void sortParticles(const FramePacket::ParticleInstance* instances, int count)
 	{
-		static const int PARTICLE_BATCH_SIZE = 256;
+		PROFILE_FUNCTION();
+
+		m_sort_keys.resize(count);
+		m_sort_values.resize(count);
+		m_tmp_sort_keys.resize(count);
+		m_tmp_sort_values.resize(count);
+
+		Vec3 camera_pos = m_camera_frustum.getPosition();
+		Vec3 camera_dir = m_camera_frustum.getDirection();
+		for (int i = 0; i < count; ++i)
+		{
+			float depth = dotProduct(instances[i].pos_and_size.xyz() - camera_pos, camera_dir);
+			// flipped float bits sort like the float, the farthest particle goes first
+			float key = -depth;
+			uint32 key_bits;
+			copyMemory(&key_bits, &key, sizeof(key_bits));
+			m_sort_keys[i] = (key_bits & 0x80000000) ? ~key_bits : key_bits | 0x80000000;
+			m_sort_values[i] = i;
+		}
+
+		radixSort(m_sort_keys.begin(),
+			m_sort_values.begin(),
+			m_tmp_sort_keys.begin(),
+			m_tmp_sort_values.begin(),
+			count);
+	}
 
-		if (emitter.m_life.empty()) return;
-		if (!emitter.getMaterial()) return;
-		if (!emitter.getMaterial()->isReady()) return;
 
-		Material* material = emitter.getMaterial();
+	void renderParticles(const FramePacket::Particles& particles)
+	{
+		Material* material = particles.material;
+		if (!material->isReady()) return;
+		if (!m_camera_frustum.isSphereInside(particles.center, particles.radius)) return;
 
-		const bgfx::InstanceDataBuffer* instance_buffer = nullptr;
-		struct Instance
+		const FramePacket::ParticleInstance* instances =
+			&m_scene->getFramePacket().particle_instances[particles.offset];
+		bool is_sorted = (material->getRenderStates() & BGFX_STATE_BLEND_MASK) != 0;
+		if (is_sorted) sortParticles(instances, particles.count);
+
+		// the whole emitter is one draw call, unless it does not fit in the transient memory
+		static const uint16 STRIDE = sizeof(FramePacket::ParticleInstance);
+		int batch_size = particles.count;
+		while (batch_size > 0 && !bgfx::checkAvailInstanceDataBuffer(batch_size, STRIDE))
 		{
-			Vec4 pos;
-			Vec4 alpha_and_rotation;
-		};
-		Instance* instance = nullptr;
+			batch_size /= 2;
+		}
+		if (batch_size == 0) return;
 
-		for (int i = 0, c = emitter.m_life.size(); i < c; ++i)
+		PROFILE_INT("particle count", particles.count);
+		for (int i = 0; i < particles.count; i += batch_size)
 		{
-			if (i % PARTICLE_BATCH_SIZE == 0)
+			int count = Math::minValue(batch_size, particles.count - i);
+			const bgfx::InstanceDataBuffer* instance_buffer =
+				bgfx::allocInstanceDataBuffer(count, STRIDE);
+			auto* dest = (FramePacket::ParticleInstance*)instance_buffer->data;
+			if (is_sorted)
 			{
-				if (instance_buffer)
+				const int* order = &m_sort_values[i];
+				for (int j = 0; j < count; ++j)
 				{
-					setMaterial(material);
-					bgfx::setInstanceDataBuffer(instance_buffer, PARTICLE_BATCH_SIZE);
-					bgfx::setVertexBuffer(m_particle_vertex_buffer);
-					bgfx::setIndexBuffer(m_particle_index_buffer);
-					bgfx::submit(m_view_idx, material->getShaderInstance().m_program_handles[m_pass_idx]);
+					dest[j] = instances[order[j]];
 				}
-
-				instance_buffer = bgfx::allocInstanceDataBuffer(PARTICLE_BATCH_SIZE, sizeof(Instance));
-				instance = (Instance*)instance_buffer->data;
+			}
+			else
+			{
+				copyMemory(dest, instances + i, count * sizeof(instances[0]));
 			}
 
-			instance->pos = Vec4(emitter.m_position[i], emitter.m_size[i]);
-			instance->alpha_and_rotation = Vec4(emitter.m_alpha[i], emitter.m_rotation[i], 0, 0);
-			++instance;
-		}
-
-		if (emitter.m_life.size() % PARTICLE_BATCH_SIZE)
-		{
 			setMaterial(material);
-			bgfx::setInstanceDataBuffer(instance_buffer, emitter.m_life.size() % PARTICLE_BATCH_SIZE);
+			bgfx::setInstanceDataBuffer(instance_buffer, count);
 			bgfx::setVertexBuffer(m_particle_vertex_buffer);
 			bgfx::setIndexBuffer(m_particle_index_buffer);
 			bgfx::setState(m_render_state | material->getRenderStates());
@@ -462,12 +602,10 @@ struct PipelineInstanceImpl : public PipelineInstance
 
 	void renderParticles()
 	{
-		const auto& emitters = m_scene->getParticleEmitters();
-		for (const auto* emitter : emitters)
+		PROFILE_FUNCTION();
+		for (const auto& particles : m_scene->getFramePacket().particles)
 		{
-			if (!emitter) continue;
-
-			renderParticles(*emitter);
+			renderParticles(particles);
 		}
 	}
 
@@ -494,32 +632,66 @@ struct PipelineInstanceImpl : public PipelineInstance
 	}
 
 
-	void finishInstances(int idx)
+	void recordMesh(const Mesh& mesh, const Model& model, DrawCommand& cmd) const
 	{
-		InstanceData& data = m_instances_data[idx];
-		if (!data.buffer) return;
-
-		Mesh& mesh = *data.mesh;
-		const Model& model = *data.model;
 		Material* material = mesh.getMaterial();
 		const uint16 stride = mesh.getVertexDefinition().getStride();
 
-		setMaterial(material);
-		bgfx::setVertexBuffer(model.getVerticesHandle(),
-							  mesh.getAttributeArrayOffset() / stride,
-							  mesh.getAttributeArraySize() / stride);
-		bgfx::setIndexBuffer(model.getIndicesHandle(),
-							 mesh.getIndicesOffset(),
-							 mesh.getIndexCount());
-		bgfx::setState(m_render_state | material->getRenderStates());
-		bgfx::setInstanceDataBuffer(data.buffer, data.instance_count);
-		ShaderInstance& shader_instance =
-			mesh.getMaterial()->getShaderInstance();
-		bgfx::submit(m_view_idx, shader_instance.m_program_handles[m_pass_idx]);
+		cmd.material = material;
+		cmd.render_states = m_render_state | material->getRenderStates();
+		cmd.program = material->getShaderInstance().m_program_handles[m_pass_idx];
+		cmd.vertex_buffer = model.getVerticesHandle();
+		cmd.first_vertex = mesh.getAttributeArrayOffset() / stride;
+		cmd.vertex_count = mesh.getAttributeArraySize() / stride;
+		cmd.index_buffer = model.getIndicesHandle();
+		cmd.first_index = mesh.getIndicesOffset();
+		cmd.index_count = mesh.getIndexCount();
+	}
+
+
+	void replayDrawCommand(const DrawCommand& cmd)
+	{
+		switch (cmd.type)
+		{
+			case DrawCommand::SKINNED_MESH:
+				bgfx::setUniform(m_bone_matrices_uniform, cmd.bone_matrices, cmd.bone_count);
+				break;
+			case DrawCommand::TERRAIN:
+				bgfx::setUniform(m_terrain_params_uniform, &cmd.terrain_params);
+				bgfx::setUniform(m_rel_camera_pos_uniform, &cmd.rel_camera_pos);
+				bgfx::setUniform(m_terrain_scale_uniform, &cmd.terrain_scale);
+				bgfx::setUniform(m_terrain_matrix_uniform, &cmd.terrain_matrix->m11);
+				break;
+			default: break;
+		}
+
+		setMaterial(cmd.material);
+		if (cmd.type == DrawCommand::SKINNED_MESH) bgfx::setTransform(cmd.transform);
+		bgfx::setVertexBuffer(cmd.vertex_buffer, cmd.first_vertex, cmd.vertex_count);
+		bgfx::setIndexBuffer(cmd.index_buffer, cmd.first_index, cmd.index_count);
+		bgfx::setState(cmd.render_states);
+		switch (cmd.type)
+		{
+			case DrawCommand::INSTANCED_MESH:
+			case DrawCommand::TERRAIN:
+				bgfx::setInstanceDataBuffer(cmd.instance_buffer, cmd.instance_count);
+				break;
+			case DrawCommand::GRASS:
+				bgfx::setInstanceDataBuffer(cmd.instance_vertex_buffer, 0, cmd.instance_count);
+				break;
+			default: break;
+		}
+		bgfx::submit(m_view_idx, cmd.program);
+	}
+
 
-		data.buffer = nullptr;
-		data.instance_count = 0;
-		mesh.setInstanceIdx(-1);
+	void replayDrawCommands()
+	{
+		PROFILE_FUNCTION();
+		for (const auto& cmd : m_draw_commands)
+		{
+			replayDrawCommand(cmd);
+		}
 	}
 
 
@@ -534,6 +706,7 @@ struct PipelineInstanceImpl : public PipelineInstance
 
 		Matrix projection_matrix;
 		float fov = getScene()->getCameraFOV(cmp);
+		m_lod_multiplier = getLODMultiplier(Math::degreesToRadians(fov), m_height);
 		float near_plane = getScene()->getCameraNearPlane(cmp);
 		float far_plane = getScene()->getCameraFarPlane(cmp);
 		float ratio = float(m_width) / m_height;
@@ -547,19 +720,52 @@ struct PipelineInstanceImpl : public PipelineInstance
 
 		bgfx::setViewRect(
 			m_view_idx, (uint16_t)m_view_x, (uint16_t)m_view_y, (uint16)m_width, (uint16)m_height);
+
+		buildLightGrid(cmp);
+	}
+
+
+	// screen size of an object is proportional to 1 / (distance * tan(fov / 2)) * viewport height,
+	// LOD distances are authored for 60 degrees vertical fov and 1080 pixels high viewport
+	static float getLODMultiplier(float fov, int viewport_height)
+	{
+		static const float REFERENCE_HEIGHT = 1080;
+		static const float REFERENCE_TAN_HALF_FOV = 0.57735027f; // tan(30 degrees)
+		if (viewport_height <= 0) return 1;
+		return tanf(fov * 0.5f) / REFERENCE_TAN_HALF_FOV * REFERENCE_HEIGHT / viewport_height;
 	}
 
 
-	void finishInstances()
+	void buildLightGrid(ComponentIndex camera)
 	{
-		for (int i = 0; i < lengthOf(m_instances_data); ++i)
+		PROFILE_FUNCTION();
+
+		Universe& universe = m_scene->getUniverse();
+		m_tmp_lights.clear();
+		m_tmp_lights_pos_radius.clear();
+		for (const auto& light : m_scene->getFramePacket().point_lights)
 		{
-			finishInstances(i);
+			if (!m_camera_frustum.isSphereInside(light.position, light.range)) continue;
+
+			m_tmp_lights.push(light.light);
+			m_tmp_lights_pos_radius.push(Vec4(light.position, light.range));
 		}
-		m_instance_data_idx = 0;
+
+		m_light_grid.build(universe.getMatrix(m_scene->getCameraEntity(camera)),
+			Math::degreesToRadians(m_scene->getCameraFOV(camera)),
+			float(m_width) / m_height,
+			m_scene->getCameraNearPlane(camera),
+			m_scene->getCameraFarPlane(camera),
+			m_tmp_lights.begin(),
+			m_tmp_lights_pos_radius.begin(),
+			m_tmp_lights.size());
+		PROFILE_INT("lights in grid", m_light_grid.getLightCount());
 	}
 
 
+	const LightGrid& getLightGrid() const override { return m_light_grid; }
+
+
 	void setPass(const char* name)
 	{
 		m_pass_idx = m_renderer.getPassIdx(name);
@@ -567,6 +773,7 @@ struct PipelineInstanceImpl : public PipelineInstance
 		{
 			if (m_view2pass_map[i] == m_pass_idx)
 			{
+				if (m_view_idx != i) invalidateBindCache();
 				m_view_idx = (uint8)i;
 				return;
 			}
@@ -576,6 +783,16 @@ struct PipelineInstanceImpl : public PipelineInstance
 	}
 
 
+	// Views are sequential, so uniforms set by a draw are still set for the next draw in the
+	// same view; textures are part of bgfx's per-draw state and have to be set every time.
+	void invalidateBindCache()
+	{
+		m_bound_material = nullptr;
+		m_bound_light = INVALID_COMPONENT;
+		m_is_bound_light_global = false;
+	}
+
+
 	CustomCommandHandler& addCustomCommandHandler(const char* name) override
 	{
 		return m_custom_commands_handlers[crc32(name)];
@@ -677,7 +894,7 @@ struct PipelineInstanceImpl : public PipelineInstance
 		{
 			handler.invoke();
 		}
-		finishInstances();
+		invalidateBindCache();
 	}
 
 
@@ -698,6 +915,8 @@ struct PipelineInstanceImpl : public PipelineInstance
 		}
 		bgfx::setViewClear(m_view_idx, 0);
 		bgfx::setViewName(m_view_idx, debug_name);
+		bgfx::setViewSeq(m_view_idx, true);
+		invalidateBindCache();
 	}
 
 
@@ -706,30 +925,23 @@ struct PipelineInstanceImpl : public PipelineInstance
 								  int64 layer_mask)
 	{
 		ASSERT(fb);
-		beginNewView(fb, "point_light");
 
 		Entity light_entity = m_scene->getPointLightEntity(light);
 		Matrix mtx = m_scene->getUniverse().getMatrix(light_entity);
 		float fov = m_scene->getLightFOV(light);
 		float range = m_scene->getLightRange(light);
-		uint16 shadowmap_height = (uint16)m_current_framebuffer->getHeight();
-		uint16 shadowmap_width = (uint16)m_current_framebuffer->getWidth();
+		uint16 shadowmap_height = (uint16)fb->getHeight();
+		uint16 shadowmap_width = (uint16)fb->getWidth();
 		Vec3 pos = mtx.getTranslation();
-		
-		bgfx::setViewClear(m_view_idx, BGFX_CLEAR_DEPTH, 0, 1.0f, 0);
-		bgfx::touch(m_view_idx);
-		bgfx::setViewRect(m_view_idx, 0, 0, shadowmap_width, shadowmap_height);
 
 		Matrix projection_matrix;
 		projection_matrix.setPerspective(
 			Math::degreesToRadians(fov), 1, 0.01f, range);
 		Matrix view_matrix;
 		view_matrix.lookAt(pos, pos + mtx.getZVector(), mtx.getYVector());
-		bgfx::setViewTransform(
-			m_view_idx, &view_matrix.m11, &projection_matrix.m11);
 
 		PointLightShadowmap& s = m_point_light_shadowmaps.pushEmpty();
-		s.m_framebuffer = m_current_framebuffer;
+		s.m_framebuffer = fb;
 		s.m_light = light;
 		static const Matrix biasMatrix(
 			0.5,  0.0, 0.0, 0.0,
@@ -738,7 +950,17 @@ struct PipelineInstanceImpl : public PipelineInstance
 			0.5,  0.5, 0.5, 1.0);
 		s.m_matrices[0] = biasMatrix * (projection_matrix * view_matrix);
 
-		renderPointLightInfluencedGeometry(light, layer_mask);
+		if (isShadowmapCached(fb, light, layer_mask)) return;
+
+		beginNewView(fb, "point_light");
+		bgfx::setViewClear(m_view_idx, BGFX_CLEAR_DEPTH, 0, 1.0f, 0);
+		bgfx::touch(m_view_idx);
+		bgfx::setViewRect(m_view_idx, 0, 0, shadowmap_width, shadowmap_height);
+		bgfx::setViewTransform(
+			m_view_idx, &view_matrix.m11, &projection_matrix.m11);
+
+		// isShadowmapCached left the light's casters in m_tmp_meshes
+		renderMeshes(m_tmp_meshes);
 	}
 
 
@@ -773,21 +995,13 @@ struct PipelineInstanceImpl : public PipelineInstance
 			m_point_light_shadowmaps.pushEmpty();
 		shadowmap_info.m_framebuffer = fb;
 		shadowmap_info.m_light = light;
+		bool is_cached = isShadowmapCached(fb, light, layer_mask);
 
 		for (int i = 0; i < 4; ++i)
 		{
 			ASSERT(fb);
-			beginNewView(fb, "omnilight");
-
-			bgfx::setViewClear(m_view_idx, BGFX_CLEAR_DEPTH, 0, 1.0f, 0);
-			bgfx::touch(m_view_idx);
 			uint16 view_x = uint16(shadowmap_width * viewports[i * 2]);
 			uint16 view_y = uint16(shadowmap_height * viewports[i * 2 + 1]);
-			bgfx::setViewRect(m_view_idx,
-							  view_x,
-							  view_y,
-							  shadowmap_width >> 1,
-							  shadowmap_height >> 1);
 
 			float fovx = Math::degreesToRadians(143.98570868f + 3.51f);
 			float fovy = Math::degreesToRadians(125.26438968f + 9.85f);
@@ -810,21 +1024,97 @@ struct PipelineInstanceImpl : public PipelineInstance
 			
 			view_matrix.fastInverse();
 
-			bgfx::setViewTransform(
-				m_view_idx, &view_matrix.m11, &projection_matrix.m11);
-
 			static const Matrix biasMatrix(
 			0.5, 0.0, 0.0, 0.0,
 			0.0, -0.5, 0.0, 0.0,
 			0.0, 0.0, 0.5, 0.0,
 			0.5, 0.5, 0.5, 1.0);
 			shadowmap_info.m_matrices[i] = biasMatrix * (projection_matrix * view_matrix);
+			if (is_cached) continue;
+
+			beginNewView(fb, "omnilight");
+			bgfx::setViewClear(m_view_idx, BGFX_CLEAR_DEPTH, 0, 1.0f, 0);
+			bgfx::touch(m_view_idx);
+			bgfx::setViewRect(m_view_idx,
+							  view_x,
+							  view_y,
+							  shadowmap_width >> 1,
+							  shadowmap_height >> 1);
+			bgfx::setViewTransform(
+				m_view_idx, &view_matrix.m11, &projection_matrix.m11);
 
 			renderModels(light, frustum, layer_mask);
 		}
 	}
 
 
+	static uint32 hashCombine(uint32 hash, const void* data, int size)
+	{
+		const uint8* bytes = (const uint8*)data;
+		for (int i = 0; i < size; ++i)
+		{
+			hash = (hash ^ bytes[i]) * 16777619;
+		}
+		return hash;
+	}
+
+
+	// a local light's shadowmap is kept from the previous frame as long as the light, its
+	// framebuffer and all casters in its range are unchanged, animated casters disable this;
+	// leaves the casters in m_tmp_meshes
+	bool isShadowmapCached(FrameBuffer* fb, ComponentIndex light, int64 layer_mask)
+	{
+		PROFILE_FUNCTION();
+
+		m_tmp_meshes.clear();
+		m_scene->getPointLightInfluencedGeometry(light, m_tmp_meshes, layer_mask);
+
+		Matrix light_mtx = m_scene->getUniverse().getMatrix(m_scene->getPointLightEntity(light));
+		float params[] = {m_scene->getLightFOV(light),
+			m_scene->getLightRange(light),
+			(float)fb->getWidth(),
+			(float)fb->getHeight()};
+		uint32 signature = 2166136261;
+		signature = hashCombine(signature, &light_mtx, sizeof(light_mtx));
+		signature = hashCombine(signature, params, sizeof(params));
+		signature = hashCombine(signature, &layer_mask, sizeof(layer_mask));
+
+		const FramePacket& packet = m_scene->getFramePacket();
+		bool is_cacheable = true;
+		for (const RenderableMesh& info : m_tmp_meshes)
+		{
+			if (packet.bone_offsets[info.renderable] >= 0) is_cacheable = false;
+			const Material* material = info.mesh->getMaterial();
+			// hashed per field, the struct's padding bytes are not initialized
+			signature = hashCombine(signature, &info.renderable, sizeof(info.renderable));
+			signature = hashCombine(signature, &info.mesh, sizeof(info.mesh));
+			signature = hashCombine(signature, &material, sizeof(material));
+			signature = hashCombine(signature,
+				&packet.renderable_matrices[info.renderable],
+				sizeof(packet.renderable_matrices[info.renderable]));
+		}
+
+		CachedShadowmap* cached = nullptr;
+		for (auto& i : m_cached_shadowmaps)
+		{
+			if (i.framebuffer == fb) cached = &i;
+		}
+		if (!cached)
+		{
+			cached = &m_cached_shadowmaps.emplace();
+			cached->framebuffer = fb;
+			cached->is_valid = false;
+		}
+
+		bool is_hit = cached->is_valid && cached->light == light && cached->signature == signature;
+		cached->light = light;
+		cached->signature = signature;
+		cached->is_valid = is_cacheable;
+		PROFILE_INT("cached", is_hit ? 1 : 0);
+		return is_hit;
+	}
+
+
 	void renderModels(ComponentIndex light,
 					  const Frustum& frustum,
 					  int64 layer_mask)
@@ -956,6 +1246,10 @@ struct PipelineInstanceImpl : public PipelineInstance
 				0.5, 0.0, 0.0, 0.0, 0.0, -0.5, 0.0, 0.0, 0.0, 0.0, 0.5, 0.0, 0.5, 0.5, 0.5, 1.0);
 			m_shadow_viewprojection[split_index] = biasMatrix * (projection_matrix * view_matrix);
 
+			// casters behind the cascade's bounding sphere can not shadow it, so the culling
+			// volume is the sphere extruded towards the light
+			float caster_far = dotProduct(frustum.getCenter() - shadow_cam_pos, light_forward);
+			caster_far = Math::clamp(caster_far + bb_size, SHADOW_CAM_NEAR, SHADOW_CAM_FAR);
 			Frustum shadow_camera_frustum;
 			shadow_camera_frustum.computeOrtho(shadow_cam_pos,
 				-light_forward,
@@ -963,8 +1257,9 @@ struct PipelineInstanceImpl : public PipelineInstance
 				bb_size * 2,
 				bb_size * 2,
 				SHADOW_CAM_NEAR,
-				SHADOW_CAM_FAR);
-			renderAll(shadow_camera_frustum, layer_mask, false);
+				caster_far);
+			float texel_size = 2 * bb_size / (0.5f * shadowmap_width - 2);
+			renderShadowCasters(shadow_camera_frustum, layer_mask, texel_size);
 		}
 		m_is_rendering_in_shadowmap = false;
 	}
@@ -1057,7 +1352,7 @@ struct PipelineInstanceImpl : public PipelineInstance
 	}
 
 
-	void setPointLightUniforms(Material* material, ComponentIndex light_cmp)
+	void setPointLightUniforms(ComponentIndex light_cmp)
 	{
 		if (light_cmp < 0) return;
 
@@ -1082,37 +1377,42 @@ struct PipelineInstanceImpl : public PipelineInstance
 		bgfx::setUniform(m_light_dir_fov_uniform, &light_dir_fov);
 		bgfx::setUniform(m_light_specular_uniform, &light_specular);
 
-		if (m_scene->getLightCastShadows(light_cmp))
-		{
-			setPointLightShadowmapUniforms(material, light_cmp);
-		}
-		else
+		const PointLightShadowmap* shadowmap = getPointLightShadowmap(light_cmp);
+		if (shadowmap)
 		{
-			material->unsetUserDefine(m_has_shadowmap_define_idx);
+			bgfx::setUniform(m_shadowmap_matrices_uniform,
+				&shadowmap->m_matrices[0].m11,
+				m_scene->getLightFOV(light_cmp) > 180 ? 4 : 1);
 		}
 	}
 
 
-	void setPointLightShadowmapUniforms(Material* material, ComponentIndex light)
+	const PointLightShadowmap* getPointLightShadowmap(ComponentIndex light) const
 	{
+		if (!m_scene->getLightCastShadows(light)) return nullptr;
+
 		for (auto& info : m_point_light_shadowmaps)
 		{
-			if (info.m_light == light)
-			{
-				material->setUserDefine(m_has_shadowmap_define_idx);
+			if (info.m_light == light) return &info;
+		}
+		return nullptr;
+	}
 
-				bgfx::setUniform(m_shadowmap_matrices_uniform,
-					&info.m_matrices[0].m11,
-					m_scene->getLightFOV(light) > 180 ? 4 : 1);
 
-				int texture_offset = material->getShader()->getTextureSlotCount();
-				bgfx::setTexture(texture_offset,
-					m_tex_shadowmap_uniform,
-					info.m_framebuffer->getRenderbufferHandle(0));
-				return;
-			}
+	void setPointLightShadowmap(Material* material, ComponentIndex light)
+	{
+		const PointLightShadowmap* shadowmap = getPointLightShadowmap(light);
+		if (!shadowmap)
+		{
+			material->unsetUserDefine(m_has_shadowmap_define_idx);
+			return;
 		}
-		material->unsetUserDefine(m_has_shadowmap_define_idx);
+
+		material->setUserDefine(m_has_shadowmap_define_idx);
+		int texture_offset = material->getShader()->getTextureSlotCount();
+		bgfx::setTexture(texture_offset,
+			m_tex_shadowmap_uniform,
+			shadowmap->m_framebuffer->getRenderbufferHandle(0));
 	}
 
 
@@ -1158,47 +1458,156 @@ struct PipelineInstanceImpl : public PipelineInstance
 	void disableRGBWrite() { m_render_state &= ~BGFX_STATE_RGB_WRITE; }
 
 
-	void renderPointLightInfluencedGeometry(ComponentIndex light, int64 layer_mask)
+	void renderPointLightInfluencedGeometry(const Frustum& frustum,
+											int64 layer_mask)
 	{
 		PROFILE_FUNCTION();
 
+		int light_count = m_light_grid.getLightCount();
+		if (light_count == 0) return;
+
+		m_tmp_grasses.clear();
 		m_tmp_meshes.clear();
+		m_tmp_terrains.clear();
 
-		m_scene->getPointLightInfluencedGeometry(light, m_tmp_meshes, layer_mask);
+		m_scene->getRenderableInfos(
+			frustum, m_tmp_meshes, layer_mask, m_camera_frustum.getPosition(), m_lod_multiplier);
+		m_scene->getTerrainInfos(frustum, m_tmp_terrains, layer_mask, m_applied_camera);
+		m_scene->getGrassInfos(frustum, m_tmp_grasses, layer_mask, m_applied_camera);
 
-		renderMeshes(m_tmp_meshes);
+		bucketMeshesByLight();
+		bucketTerrainsByLight();
+		bucketGrassesByLight();
+
+		for (int i = 0; i < light_count; ++i)
+		{
+			m_current_light = m_light_grid.getLight(i);
+			m_is_current_light_global = false;
+
+			int from = m_light_mesh_offsets[i];
+			renderMeshes(m_light_meshes.begin() + from, m_light_mesh_offsets[i + 1] - from);
+			from = m_light_terrain_offsets[i];
+			renderTerrains(m_light_terrains.begin() + from, m_light_terrain_offsets[i + 1] - from);
+			from = m_light_grass_offsets[i];
+			renderGrasses(m_light_grasses.begin() + from, m_light_grass_offsets[i + 1] - from);
+		}
+		m_current_light = -1;
 	}
 
 
-	void renderPointLightInfluencedGeometry(const Frustum& frustum,
-											int64 layer_mask)
+	// bounding spheres of m_tmp_meshes, meshes of one renderable share the sphere
+	void bucketMeshesByLight()
 	{
 		PROFILE_FUNCTION();
 
-		Array<ComponentIndex> lights(m_allocator);
-		m_scene->getPointLights(frustum, lights);
-		for (int i = 0; i < lights.size(); ++i)
+		const Matrix* matrices = m_scene->getFramePacket().renderable_matrices.begin();
+		Renderable* renderables = m_scene->getRenderables();
+		m_tmp_spheres.resize(m_tmp_meshes.size());
+		for (int i = 0, c = m_tmp_meshes.size(); i < c; ++i)
 		{
-			m_tmp_grasses.clear();
-			m_tmp_meshes.clear();
-			m_tmp_terrains.clear();
+			const RenderableMesh& mesh = m_tmp_meshes[i];
+			if (i > 0 && mesh.renderable == m_tmp_meshes[i - 1].renderable)
+			{
+				m_tmp_spheres[i] = m_tmp_spheres[i - 1];
+				continue;
+			}
+			const Matrix& mtx = matrices[mesh.renderable];
+			float radius =
+				renderables[mesh.renderable].model->getBoundingRadius() * mtx.getXVector().length();
+			m_tmp_spheres[i] = Vec4(mtx.getTranslation(), radius);
+		}
 
-			ComponentIndex light = lights[i];
-			m_current_light = light;
-			m_is_current_light_global = false;
-			m_scene->getPointLightInfluencedGeometry(light, frustum, m_tmp_meshes, layer_mask);
+		bucketByLight(m_light_mesh_offsets);
+		m_light_meshes.resize(m_tmp_light_items.size());
+		for (const auto& light_item : m_tmp_light_items)
+		{
+			m_light_meshes[light_item.offset] = m_tmp_meshes[light_item.item];
+		}
+	}
 
-			m_scene->getTerrainInfos(m_tmp_terrains,
-				layer_mask,
-				m_scene->getUniverse().getPosition(m_scene->getCameraEntity(m_applied_camera)),
-				m_renderer.getFrameAllocator());
 
-			m_scene->getGrassInfos(frustum, m_tmp_grasses, layer_mask, m_applied_camera);
-			renderMeshes(m_tmp_meshes);
-			renderTerrains(m_tmp_terrains);
-			renderGrasses(m_tmp_grasses);
+	void bucketTerrainsByLight()
+	{
+		PROFILE_FUNCTION();
+
+		m_tmp_spheres.clear();
+		for (auto* info : m_tmp_terrains)
+		{
+			m_tmp_spheres.push(Vec4(info->m_center, info->m_radius));
+		}
+
+		bucketByLight(m_light_terrain_offsets);
+		m_light_terrains.resize(m_tmp_light_items.size());
+		for (const auto& light_item : m_tmp_light_items)
+		{
+			m_light_terrains[light_item.offset] = m_tmp_terrains[light_item.item];
+		}
+	}
+
+
+	void bucketGrassesByLight()
+	{
+		PROFILE_FUNCTION();
+
+		m_tmp_spheres.clear();
+		for (const auto& info : m_tmp_grasses)
+		{
+			m_tmp_spheres.push(Vec4(info.m_center, info.m_radius));
+		}
+
+		bucketByLight(m_light_grass_offsets);
+		m_light_grasses.resize(m_tmp_light_items.size());
+		for (const auto& light_item : m_tmp_light_items)
+		{
+			m_light_grasses[light_item.offset] = m_tmp_grasses[light_item.item];
 		}
-		m_current_light = -1;
+	}
+
+
+	// counting sort of m_tmp_spheres into per light ranges, an item is added to every light
+	// found in the clusters its sphere overlaps; fills offsets[light]...offsets[light + 1] and
+	// m_tmp_light_items with the destination offset of each (light, item) pair
+	void bucketByLight(Array<int>& offsets)
+	{
+		int light_count = m_light_grid.getLightCount();
+		offsets.resize(light_count + 1);
+		for (int& offset : offsets) offset = 0;
+		m_tmp_light_items.clear();
+
+		for (int i = 0, c = m_tmp_spheres.size(); i < c; ++i)
+		{
+			const Vec4& sphere = m_tmp_spheres[i];
+			if (i == 0 || compareMemory(&sphere, &m_tmp_spheres[i - 1], sizeof(sphere)) != 0)
+			{
+				m_tmp_light_indices.clear();
+				m_light_grid.getLights(
+					Vec3(sphere.x, sphere.y, sphere.z), sphere.w, m_tmp_light_indices);
+			}
+			for (int light : m_tmp_light_indices)
+			{
+				LightItem& light_item = m_tmp_light_items.emplace();
+				light_item.light = light;
+				light_item.item = i;
+				++offsets[light + 1];
+			}
+		}
+
+		for (int i = 0; i < light_count; ++i)
+		{
+			offsets[i + 1] += offsets[i];
+		}
+
+		for (auto& light_item : m_tmp_light_items)
+		{
+			int& offset = offsets[light_item.light];
+			light_item.offset = offset;
+			++offset;
+		}
+		for (int i = light_count; i > 0; --i)
+		{
+			offsets[i] = offsets[i - 1];
+		}
+		offsets[0] = 0;
 	}
 
 
@@ -1328,6 +1737,7 @@ struct PipelineInstanceImpl : public PipelineInstance
 			bgfx::setUniform(m_cam_view_uniform, &mtx.m11);
 		}
 
+		m_bound_material = nullptr;
 		bgfx::setState(m_render_state | material->getRenderStates());
 		bgfx::setVertexBuffer(&vb);
 		bgfx::submit(m_view_idx, material->getShaderInstance().m_program_handles[m_pass_idx]);
@@ -1344,11 +1754,9 @@ struct PipelineInstanceImpl : public PipelineInstance
 		m_tmp_meshes.clear();
 		m_tmp_terrains.clear();
 
-		m_scene->getRenderableInfos(frustum, m_tmp_meshes, layer_mask);
-		Entity camera_entity = m_scene->getCameraEntity(m_applied_camera);
-		Vec3 camera_pos = m_scene->getUniverse().getPosition(camera_entity);
-		LIFOAllocator& frame_allocator = m_renderer.getFrameAllocator();
-		m_scene->getTerrainInfos(m_tmp_terrains, layer_mask, camera_pos, frame_allocator);
+		m_scene->getRenderableInfos(
+			frustum, m_tmp_meshes, layer_mask, m_camera_frustum.getPosition(), m_lod_multiplier);
+		m_scene->getTerrainInfos(frustum, m_tmp_terrains, layer_mask, m_applied_camera);
 
 		m_is_current_light_global = true;
 		m_current_light = m_scene->getActiveGlobalLight();
@@ -1365,95 +1773,91 @@ struct PipelineInstanceImpl : public PipelineInstance
 	}
 
 
-	void toggleStats() override
+	// renderAll for shadowmaps, without meshes too small to cover a shadowmap texel
+	void renderShadowCasters(const Frustum& frustum, int64 layer_mask, float texel_size)
 	{
-		m_debug_flags ^= BGFX_DEBUG_STATS;
-		bgfx::setDebug(m_debug_flags);
-	}
+		PROFILE_FUNCTION();
 
+		if (m_applied_camera < 0) return;
 
-	void setWindowHandle(void* data) override
-	{
-		m_default_framebuffer =
-			LUMIX_NEW(m_allocator, FrameBuffer)("default", m_width, m_height, data);
+		m_tmp_grasses.clear();
+		m_tmp_meshes.clear();
+		m_tmp_terrains.clear();
+
+		m_scene->getRenderableInfos(
+			frustum, m_tmp_meshes, layer_mask, m_camera_frustum.getPosition(), m_lod_multiplier);
+		removeSmallCasters(texel_size);
+		m_scene->getTerrainInfos(frustum, m_tmp_terrains, layer_mask, m_applied_camera);
+
+		m_is_current_light_global = true;
+		m_current_light = m_scene->getActiveGlobalLight();
+
+		renderMeshes(m_tmp_meshes);
+		renderTerrains(m_tmp_terrains);
+		m_scene->getGrassInfos(frustum, m_tmp_grasses, layer_mask, m_applied_camera);
+		renderGrasses(m_tmp_grasses);
+
+		m_current_light = -1;
 	}
 
 
-	void renderModel(Model& model, const Matrix& mtx) override
+	void removeSmallCasters(float texel_size)
 	{
-		for (int i = 0; i < model.getMeshCount(); ++i)
-		{
-			auto& mesh = model.getMesh(i);
-			int instance_idx = mesh.getInstanceIdx();
-			if (instance_idx == -1)
-			{
-				instance_idx = m_instance_data_idx;
-				m_instance_data_idx = (m_instance_data_idx + 1) % lengthOf(m_instances_data);
-				if (m_instances_data[instance_idx].buffer)
-				{
-					finishInstances(instance_idx);
-				}
-				mesh.setInstanceIdx(instance_idx);
-			}
-			InstanceData& data = m_instances_data[instance_idx];
-			if (!data.buffer)
-			{
-				data.buffer =
-					bgfx::allocInstanceDataBuffer(InstanceData::MAX_INSTANCE_COUNT, sizeof(Matrix));
-				data.instance_count = 0;
-				data.mesh = &mesh;
-				data.model = &model;
-			}
-			Matrix* mtcs = (Matrix*)data.buffer->data;
-			mtcs[data.instance_count] = mtx;
-			++data.instance_count;
-
-			if (data.instance_count == InstanceData::MAX_INSTANCE_COUNT)
+		Universe& universe = m_scene->getUniverse();
+		const Renderable* renderables = m_scene->getRenderables();
+		float min_radius = texel_size * 0.5f;
+		ComponentIndex last_renderable = INVALID_COMPONENT;
+		bool is_small = false;
+		int count = 0;
+		for (int i = 0, c = m_tmp_meshes.size(); i < c; ++i)
+		{
+			const RenderableMesh& info = m_tmp_meshes[i];
+			if (info.renderable != last_renderable)
 			{
-				finishInstances(instance_idx);
+				last_renderable = info.renderable;
+				const Renderable& renderable = renderables[info.renderable];
+				float radius =
+					renderable.model->getBoundingRadius() * universe.getScale(renderable.entity);
+				is_small = radius < min_radius;
 			}
+			if (is_small) continue;
+			m_tmp_meshes[count] = info;
+			++count;
 		}
+		PROFILE_INT("skipped small casters", m_tmp_meshes.size() - count);
+		m_tmp_meshes.resize(count);
 	}
 
 
-	void setPoseUniform(const RenderableMesh& renderable_mesh) const
+	void toggleStats() override
 	{
-		Matrix bone_mtx[64];
-		
-		Renderable* renderable = m_scene->getRenderable(renderable_mesh.renderable);
-		const Pose& pose = *renderable->pose;
-		const Model& model = *renderable->model;
-		Vec3* poss = pose.getPositions();
-		Quat* rots = pose.getRotations();
-
-		ASSERT(pose.getCount() <= lengthOf(bone_mtx));
-		for (int bone_index = 0, bone_count = pose.getCount(); bone_index < bone_count;
-			 ++bone_index)
-		{
-			rots[bone_index].toMatrix(bone_mtx[bone_index]);
-			bone_mtx[bone_index].translate(poss[bone_index]);
-			bone_mtx[bone_index] = bone_mtx[bone_index] * model.getBone(bone_index).inv_bind_matrix;
-		}
-		bgfx::setUniform(m_bone_matrices_uniform, bone_mtx, pose.getCount());
+		m_debug_flags ^= BGFX_DEBUG_STATS;
+		bgfx::setDebug(m_debug_flags);
 	}
 
 
-	void renderSkinnedMesh(const Renderable& renderable, const RenderableMesh& info)
+	void setWindowHandle(void* data) override
 	{
-		const Mesh& mesh = *info.mesh;
-		Material* material = mesh.getMaterial();
+		m_default_framebuffer =
+			LUMIX_NEW(m_allocator, FrameBuffer)("default", m_width, m_height, data);
+	}
 
-		setPoseUniform(info);
-		setMaterial(material);
-		bgfx::setTransform(&renderable.matrix);
-		bgfx::setVertexBuffer(renderable.model->getVerticesHandle(),
-			mesh.getAttributeArrayOffset() / mesh.getVertexDefinition().getStride(),
-			mesh.getAttributeArraySize() / mesh.getVertexDefinition().getStride());
-		bgfx::setIndexBuffer(
-			renderable.model->getIndicesHandle(), mesh.getIndicesOffset(), mesh.getIndexCount());
-		bgfx::setState(m_render_state | material->getRenderStates());
-		bgfx::submit(m_view_idx,
-			mesh.getMaterial()->getShaderInstance().m_program_handles[m_pass_idx]);
+
+	// used by the editor for a handful of icons, so there is nothing worth batching
+	void renderModel(Model& model, const Matrix& mtx) override
+	{
+		for (int i = 0; i < model.getMeshCount(); ++i)
+		{
+			if (!bgfx::checkAvailInstanceDataBuffer(1, sizeof(Matrix))) return;
+			const bgfx::InstanceDataBuffer* buffer = bgfx::allocInstanceDataBuffer(1, sizeof(Matrix));
+			copyMemory(buffer->data, &mtx, sizeof(mtx));
+			DrawCommand cmd;
+			cmd.type = DrawCommand::INSTANCED_MESH;
+			recordMesh(model.getMesh(i), model, cmd);
+			cmd.instance_buffer = buffer;
+			cmd.instance_count = 1;
+			replayDrawCommand(cmd);
+		}
 	}
 
 
@@ -1481,73 +1885,70 @@ struct PipelineInstanceImpl : public PipelineInstance
 		bgfx::setVertexBuffer(&geom.getVertexBuffer());
 		bgfx::setIndexBuffer(&geom.getIndexBuffer(), first_index, num_indices);
 		bgfx::submit(m_view_idx, program_handle);
+		invalidateBindCache();
 	}
 
 
-	void renderRigidMesh(const Renderable& renderable, const RenderableMesh& info)
+	void setMaterialUniforms(Material* material)
 	{
-		int instance_idx = info.mesh->getInstanceIdx();
-		if (instance_idx == -1)
+		Vec4 time(m_scene->getTime(), 0, 0, 0);
+		for (int i = 0; i < material->getUniformCount(); ++i)
 		{
-			instance_idx = m_instance_data_idx;
-			m_instance_data_idx = (m_instance_data_idx + 1) % lengthOf(m_instances_data);
-			if (m_instances_data[instance_idx].buffer)
+			const Material::Uniform& uniform = material->getUniform(i);
+
+			switch (uniform.m_type)
 			{
-				finishInstances(instance_idx);
+				case Material::Uniform::FLOAT:
+				{
+					Vec4 v(uniform.m_float, 0, 0, 0);
+					bgfx::setUniform(uniform.m_handle, &v);
+				}
+				break;
+				case Material::Uniform::TIME: bgfx::setUniform(uniform.m_handle, &time); break;
+				default: ASSERT(false); break;
 			}
-			info.mesh->setInstanceIdx(instance_idx);
-		}
-		InstanceData& data = m_instances_data[instance_idx];
-		if (!data.buffer)
-		{
-			data.buffer =
-				bgfx::allocInstanceDataBuffer(InstanceData::MAX_INSTANCE_COUNT, sizeof(Matrix));
-			data.instance_count = 0;
-			data.mesh = info.mesh;
-			data.model = renderable.model;
 		}
-		Matrix* mtcs = (Matrix*)data.buffer->data;
-		mtcs[data.instance_count] = renderable.matrix;
-		++data.instance_count;
 
-		if (data.instance_count == InstanceData::MAX_INSTANCE_COUNT)
-		{
-			finishInstances(instance_idx);
-		}
+		Vec4 specular_shininess(material->getSpecular(), material->getShininess());
+		bgfx::setUniform(m_specular_shininess_uniform, &specular_shininess);
 	}
 
 
 	void setMaterial(Material* material)
 	{
-		if (m_is_current_light_global)
+		if (m_bound_light != m_current_light || m_is_bound_light_global != m_is_current_light_global)
 		{
-			setDirectionalLightUniforms(m_current_light);
+			if (m_is_current_light_global)
+			{
+				setDirectionalLightUniforms(m_current_light);
+			}
+			else
+			{
+				setPointLightUniforms(m_current_light);
+			}
+			m_bound_light = m_current_light;
+			m_is_bound_light_global = m_is_current_light_global;
+			++m_bind_stats.light_binds;
 		}
 		else
 		{
-			setPointLightUniforms(material, m_current_light);
+			++m_bind_stats.skipped_light_binds;
 		}
 
-		for (int i = 0; i < material->getUniformCount(); ++i)
+		if (!m_is_current_light_global && m_current_light >= 0)
 		{
-			const Material::Uniform& uniform = material->getUniform(i);
+			setPointLightShadowmap(material, m_current_light);
+		}
 
-			switch (uniform.m_type)
-			{
-				case Material::Uniform::FLOAT:
-				{
-					Vec4 v(uniform.m_float, 0, 0, 0);
-					bgfx::setUniform(uniform.m_handle, &v);
-				}
-				break;
-				case Material::Uniform::TIME:
-				{
-					Vec4 v(m_scene->getTime(), 0, 0, 0);
-					bgfx::setUniform(uniform.m_handle, &v);
-				}
-				break;
-				default: ASSERT(false); break;
-			}
+		if (m_bound_material != material)
+		{
+			setMaterialUniforms(material);
+			m_bound_material = material;
+			++m_bind_stats.material_binds;
+		}
+		else
+		{
+			++m_bind_stats.skipped_material_binds;
 		}
 
 		Shader* shader = material->getShader();
@@ -1560,9 +1961,6 @@ struct PipelineInstanceImpl : public PipelineInstance
 				i, shader->getTextureSlot(i).m_uniform_handle, texture->getTextureHandle());
 		}
 
-		Vec4 specular_shininess(material->getSpecular(), material->getShininess());
-		bgfx::setUniform(m_specular_shininess_uniform, &specular_shininess);
-
 		if (m_is_current_light_global && !m_is_rendering_in_shadowmap && m_global_light_shadowmap)
 		{
 			auto handle = m_global_light_shadowmap->getRenderbufferHandle(0);
@@ -1571,151 +1969,345 @@ struct PipelineInstanceImpl : public PipelineInstance
 	}
 
 
-	void renderTerrain(const TerrainInfo& info)
+	// Draw commands and instance data are recorded by MTJD workers, each job owns the
+	// disjoint range [from, to) of m_draw_commands, so the commands are replayed in order
+	// on the main thread afterwards. function(from, to) covers [0, count).
+	template <typename T> void runParallel(int count, int work_per_item, T function)
+	{
+		MTJD::Manager& manager = m_renderer.getEngine().getMTJDManager();
+		int job_count = Math::minValue(
+			(int)manager.getCpuThreadsCount(), count * work_per_item / MIN_INSTANCES_PER_JOB);
+		if (job_count <= 1)
+		{
+			function(0, count);
+			return;
+		}
+
+		m_jobs.clear();
+		int step = (count + job_count - 1) / job_count;
+		for (int from = 0; from < count; from += step)
+		{
+			int to = Math::minValue(count, from + step);
+			MTJD::Job* job = MTJD::makeJob(manager,
+				[function, from, to]()
+				{
+					PROFILE_BLOCK("record draw commands");
+					function(from, to);
+				},
+				m_allocator);
+			job->addDependency(&m_sync_point);
+			m_jobs.push(job);
+		}
+		for (auto* job : m_jobs)
+		{
+			manager.schedule(job);
+		}
+		m_sync_point.sync();
+	}
+
+
+	void addTerrainToBatch(const TerrainInfo& info)
 	{
 		auto& inst = m_terrain_instances[info.m_index];
 		if ((inst.m_count > 0 && inst.m_infos[0]->m_terrain != info.m_terrain) ||
 			inst.m_count == lengthOf(inst.m_infos))
 		{
-			finishTerrainInstances(info.m_index);
+			closeTerrainBatch(info.m_index);
 		}
 		inst.m_infos[inst.m_count] = &info;
 		++inst.m_count;
 	}
 
 
-	void finishTerrainInstances(int index)
+	void closeTerrainBatch(int index)
 	{
-		if (m_terrain_instances[index].m_count == 0) return;
+		TerrainInstance& inst = m_terrain_instances[index];
+		if (inst.m_count == 0) return;
+
+		Terrain* terrain = inst.m_infos[0]->m_terrain;
+		if (terrain->getMaterial()->isReady() && terrain->getDetailTexture() &&
+			terrain->getSplatmap())
+		{
+			TerrainBatch& batch = m_terrain_batches.emplace();
+			batch.instances = inst;
+			batch.instance_buffer =
+				bgfx::allocInstanceDataBuffer(inst.m_count, sizeof(TerrainInstanceData));
+		}
+		inst.m_count = 0;
+	}
 
-		const TerrainInfo& info = *m_terrain_instances[index].m_infos[0];
-		Material* material = info.m_terrain->getMaterial();
-		if (!material->isReady()) return;
 
+	void recordTerrainBatch(const TerrainBatch& batch,
+		const Vec3& camera_pos,
+		DrawCommand& cmd) const
+	{
+		auto* instance_data = (TerrainInstanceData*)batch.instance_buffer->data;
+		for (int i = 0; i < batch.instances.m_count; ++i)
+		{
+			const TerrainInfo& info = *batch.instances.m_infos[i];
+			instance_data[i].m_quad_min_and_size.set(
+				info.m_min.x, info.m_min.y, info.m_min.z, info.m_size);
+			instance_data[i].m_morph_const.set(
+				info.m_morph_const.x, info.m_morph_const.y, info.m_morph_const.z, 0);
+		}
+
+		const TerrainInfo& info = *batch.instances.m_infos[0];
+		Material* material = info.m_terrain->getMaterial();
 		Texture* detail_texture = info.m_terrain->getDetailTexture();
-		if (!detail_texture) return;
 		Texture* splat_texture = info.m_terrain->getSplatmap();
-		if (!splat_texture) return;
 
 		Matrix inv_world_matrix;
 		inv_world_matrix = info.m_world_matrix;
 		inv_world_matrix.fastInverse();
-		Vec3 camera_pos =
-			m_scene->getUniverse().getPosition(m_scene->getCameraEntity(m_applied_camera));
-
-		Vec4 rel_cam_pos(
-			inv_world_matrix.multiplyPosition(camera_pos) / info.m_terrain->getXZScale(), 1);
-		Vec4 terrain_scale(info.m_terrain->getScale(), 0);
 		const Mesh& mesh = *info.m_terrain->getMesh();
 
-		Vec4 terrain_params(info.m_terrain->getRootSize(),
+		cmd.type = DrawCommand::TERRAIN;
+		cmd.rel_camera_pos =
+			Vec4(inv_world_matrix.multiplyPosition(camera_pos) / info.m_terrain->getXZScale(), 1);
+		cmd.terrain_scale = Vec4(info.m_terrain->getScale(), 0);
+		cmd.terrain_params.set(info.m_terrain->getRootSize(),
 			(float)detail_texture->getWidth(),
 			(float)detail_texture->getAtlasSize(),
 			(float)splat_texture->getWidth());
-		bgfx::setUniform(m_terrain_params_uniform, &terrain_params);
-		bgfx::setUniform(m_rel_camera_pos_uniform, &rel_cam_pos);
-		bgfx::setUniform(m_terrain_scale_uniform, &terrain_scale);
-		bgfx::setUniform(m_terrain_matrix_uniform, &info.m_world_matrix.m11);
-
-		setMaterial(material);
-
-		struct TerrainInstanceData
-		{
-			Vec4 m_quad_min_and_size;
-			Vec4 m_morph_const;
-		};
-		const bgfx::InstanceDataBuffer* instance_buffer = bgfx::allocInstanceDataBuffer(
-			m_terrain_instances[index].m_count, sizeof(TerrainInstanceData));
-		TerrainInstanceData* instance_data = (TerrainInstanceData*)instance_buffer->data;
-
-		for (int i = 0; i < m_terrain_instances[index].m_count; ++i)
-		{
-			const TerrainInfo& info = *m_terrain_instances[index].m_infos[i];
-			instance_data[i].m_quad_min_and_size.set(
-				info.m_min.x, info.m_min.y, info.m_min.z, info.m_size);
-			instance_data[i].m_morph_const.set(
-				info.m_morph_const.x, info.m_morph_const.y, info.m_morph_const.z, 0);
-		}
-
-		bgfx::setVertexBuffer(info.m_terrain->getVerticesHandle());
+		cmd.terrain_matrix = &info.m_world_matrix;
+		cmd.material = material;
+		cmd.render_states = m_render_state | mesh.getMaterial()->getRenderStates();
+		cmd.program = material->getShaderInstance().m_program_handles[m_pass_idx];
+		cmd.vertex_buffer = info.m_terrain->getVerticesHandle();
+		cmd.first_vertex = 0;
+		cmd.vertex_count = UINT32_MAX;
 		int mesh_part_indices_count = mesh.getIndexCount() / 4;
-		bgfx::setIndexBuffer(info.m_terrain->getIndicesHandle(),
-			info.m_index * mesh_part_indices_count,
-			mesh_part_indices_count);
-		bgfx::setState(m_render_state | mesh.getMaterial()->getRenderStates());
-		bgfx::setInstanceDataBuffer(instance_buffer, m_terrain_instances[index].m_count);
-		auto shader_instance = material->getShaderInstance().m_program_handles[m_pass_idx];
-		bgfx::submit(m_view_idx, shader_instance);
-
-		m_terrain_instances[index].m_count = 0;
+		cmd.index_buffer = info.m_terrain->getIndicesHandle();
+		cmd.first_index = info.m_index * mesh_part_indices_count;
+		cmd.index_count = mesh_part_indices_count;
+		cmd.instance_buffer = batch.instance_buffer;
+		cmd.instance_count = batch.instances.m_count;
 	}
 
 
-	void renderGrass(const GrassInfo& grass)
+	void recordGrass(const GrassInfo& grass, DrawCommand& cmd) const
 	{
-		const bgfx::InstanceDataBuffer* idb =
-			bgfx::allocInstanceDataBuffer(grass.m_matrix_count, sizeof(Matrix));
-		copyMemory(idb->data, &grass.m_matrices[0], grass.m_matrix_count * sizeof(Matrix));
 		const Mesh& mesh = grass.m_model->getMesh(0);
-		Material* material = mesh.getMaterial();
+		cmd.type = DrawCommand::GRASS;
+		recordMesh(mesh, *grass.m_model, cmd);
+		cmd.instance_vertex_buffer.idx = grass.m_instance_buffer_idx;
+		cmd.instance_count = grass.m_matrix_count;
+	}
 
-		setMaterial(material);
-		bgfx::setVertexBuffer(grass.m_model->getVerticesHandle(),
-			mesh.getAttributeArrayOffset() / mesh.getVertexDefinition().getStride(),
-			mesh.getAttributeArraySize() / mesh.getVertexDefinition().getStride());
-		bgfx::setIndexBuffer(
-			grass.m_model->getIndicesHandle(), mesh.getIndicesOffset(), mesh.getIndexCount());
-		bgfx::setState(m_render_state | material->getRenderStates());
-		bgfx::setInstanceDataBuffer(idb, grass.m_matrix_count);
-		bgfx::submit(m_view_idx, material->getShaderInstance().m_program_handles[m_pass_idx]);
+
+	// instance data lives in buffers owned by the terrain, nothing is uploaded here
+	void renderGrasses(const GrassInfo* grasses, int count)
+	{
+		PROFILE_FUNCTION();
+
+		m_draw_commands.resize(count);
+		runParallel(count,
+			1,
+			[this, grasses](int from, int to)
+			{
+				for (int i = from; i < to; ++i)
+				{
+					recordGrass(grasses[i], m_draw_commands[i]);
+				}
+			});
+		replayDrawCommands();
 	}
 
 
 	void renderGrasses(const Array<GrassInfo>& grasses)
 	{
-		PROFILE_FUNCTION();
-		for (const auto& grass : grasses)
-		{
-			renderGrass(grass);
-		}
+		renderGrasses(grasses.begin(), grasses.size());
 	}
 
 
 	void renderTerrains(const Array<const TerrainInfo*>& terrains)
+	{
+		renderTerrains(terrains.begin(), terrains.size());
+	}
+
+
+	void renderTerrains(const TerrainInfo* const* terrains, int count)
 	{
 		PROFILE_FUNCTION();
-		PROFILE_INT("terrain patches", terrains.size());
-		for (auto* info : terrains)
+		PROFILE_INT("terrain patches", count);
+
+		m_terrain_batches.clear();
+		for (int i = 0; i < count; ++i)
 		{
-			renderTerrain(*info);
+			addTerrainToBatch(*terrains[i]);
 		}
 		for (int i = 0; i < lengthOf(m_terrain_instances); ++i)
 		{
-			finishTerrainInstances(i);
+			closeTerrainBatch(i);
 		}
+
+		if (m_terrain_batches.empty()) return;
+
+		Vec3 camera_pos =
+			m_scene->getUniverse().getPosition(m_scene->getCameraEntity(m_applied_camera));
+		m_draw_commands.resize(m_terrain_batches.size());
+		runParallel(m_terrain_batches.size(),
+			lengthOf(m_terrain_instances[0].m_infos),
+			[this, camera_pos](int from, int to)
+			{
+				for (int i = from; i < to; ++i)
+				{
+					recordTerrainBatch(m_terrain_batches[i], camera_pos, m_draw_commands[i]);
+				}
+			});
+		replayDrawCommands();
 	}
 
 
 	void renderMeshes(const Array<RenderableMesh>& meshes)
+	{
+		renderMeshes(meshes.begin(), meshes.size());
+	}
+
+
+	// program | material | mesh | depth, so equal meshes end up next to each other and
+	// are drawn front to back; material and mesh bits are hashes, collisions only cost batching
+	static uint64 getSortKey(uint16 program, const Material* material, const Mesh* mesh, float depth)
+	{
+		uint32 depth_bits;
+		copyMemory(&depth_bits, &depth, sizeof(depth_bits));
+		uint64 mesh_hash = (uint64)(size_t)mesh;
+		mesh_hash = (mesh_hash >> 4) ^ (mesh_hash >> 20);
+		return ((uint64)program << 48) | ((uint64)(material->getPath().getHash() & 0xffff) << 32) |
+			   ((mesh_hash & 0xffff) << 16) | (depth_bits >> 16);
+	}
+
+
+	void sortMeshes(const RenderableMesh* meshes, int count)
 	{
 		PROFILE_FUNCTION();
-		if (meshes.empty()) return;
 
-		Renderable* renderables = m_scene->getRenderables();
-		PROFILE_INT("mesh count", meshes.size());
-		for (auto& mesh : meshes)
-		{
-			Renderable& renderable = renderables[mesh.renderable];
-			if (renderable.pose && renderable.pose->getCount() > 0)
+		m_sort_keys.resize(count);
+		m_sort_values.resize(count);
+		m_tmp_sort_keys.resize(count);
+		m_tmp_sort_values.resize(count);
+
+		Vec3 camera_pos = m_camera_frustum.getPosition();
+		const Matrix* matrices = m_scene->getFramePacket().renderable_matrices.begin();
+		for (int i = 0; i < count; ++i)
+		{
+			const RenderableMesh& info = meshes[i];
+			const Material* material = info.mesh->getMaterial();
+			uint16 program = material->getShaderInstance().m_program_handles[m_pass_idx].idx;
+			Vec3 pos = matrices[info.renderable].getTranslation();
+			float depth = (pos - camera_pos).squaredLength();
+			m_sort_keys[i] = getSortKey(program, material, info.mesh, depth);
+			m_sort_values[i] = i;
+		}
+
+		radixSort(m_sort_keys.begin(),
+			m_sort_values.begin(),
+			m_tmp_sort_keys.begin(),
+			m_tmp_sort_values.begin(),
+			count);
+	}
+
+
+	void renderMeshes(const RenderableMesh* meshes, int count)
+	{
+		PROFILE_FUNCTION();
+		if (count == 0) return;
+
+		PROFILE_INT("mesh count", count);
+		sortMeshes(meshes, count);
+		buildMeshBatches(meshes, count);
+		recordMeshBatches(meshes);
+		replayDrawCommands();
+	}
+
+
+	// splits sorted meshes into runs of the same rigid mesh, skinned meshes get a batch each
+	void buildMeshBatches(const RenderableMesh* meshes, int count)
+	{
+		PROFILE_FUNCTION();
+
+		m_mesh_batches.clear();
+		const FramePacket& packet = m_scene->getFramePacket();
+		for (int i = 0; i < count;)
+		{
+			const RenderableMesh& info = meshes[m_sort_values[i]];
+			MeshBatch& batch = m_mesh_batches.emplace();
+			batch.first = i;
+			batch.instance_buffer = nullptr;
+			batch.bone_matrices = nullptr;
+			int bone_offset = packet.bone_offsets[info.renderable];
+			if (bone_offset >= 0)
 			{
-				renderSkinnedMesh(renderable, mesh);
+				batch.count = 1;
+				batch.bone_matrices = &packet.bone_matrices[bone_offset];
+				++i;
+				continue;
 			}
-			else
+
+			int end = i + 1;
+			int max_end = Math::minValue(count, i + MAX_BATCH_INSTANCE_COUNT);
+			while (end < max_end)
 			{
-				renderRigidMesh(renderable, mesh);
+				const RenderableMesh& next = meshes[m_sort_values[end]];
+				if (next.mesh != info.mesh) break;
+				if (packet.bone_offsets[next.renderable] >= 0) break;
+				++end;
 			}
+
+			batch.count = end - i;
+			batch.instance_buffer = bgfx::allocInstanceDataBuffer(batch.count, sizeof(Matrix));
+			i = end;
 		}
-		finishInstances();
+		PROFILE_INT("draw calls", m_mesh_batches.size());
+	}
+
+
+	void recordMeshBatch(const MeshBatch& batch,
+		const RenderableMesh* meshes,
+		DrawCommand& cmd) const
+	{
+		const FramePacket& packet = m_scene->getFramePacket();
+		const RenderableMesh& info = meshes[m_sort_values[batch.first]];
+		const Renderable& renderable = m_scene->getRenderables()[info.renderable];
+		recordMesh(*info.mesh, *renderable.model, cmd);
+		cmd.instance_count = batch.count;
+		if (batch.bone_matrices)
+		{
+			ASSERT(packet.bone_counts[info.renderable] <= MAX_BONE_COUNT);
+			cmd.type = DrawCommand::SKINNED_MESH;
+			cmd.transform = &packet.renderable_matrices[info.renderable];
+			cmd.bone_matrices = batch.bone_matrices;
+			cmd.bone_count = packet.bone_counts[info.renderable];
+			return;
+		}
+
+		cmd.type = DrawCommand::INSTANCED_MESH;
+		cmd.instance_buffer = batch.instance_buffer;
+		const Matrix* matrices = packet.renderable_matrices.begin();
+		Matrix* mtcs = (Matrix*)batch.instance_buffer->data;
+		for (int i = 0; i < batch.count; ++i)
+		{
+			mtcs[i] = matrices[meshes[m_sort_values[batch.first + i]].renderable];
+		}
+	}
+
+
+	void recordMeshBatches(const RenderableMesh* meshes)
+	{
+		PROFILE_FUNCTION();
+
+		int batch_count = m_mesh_batches.size();
+		int instance_count = m_sort_values.size();
+		m_draw_commands.resize(batch_count);
+		runParallel(batch_count,
+			Math::maxValue(1, instance_count / batch_count),
+			[this, meshes](int from, int to)
+			{
+				for (int i = from; i < to; ++i)
+				{
+					recordMeshBatch(m_mesh_batches[i], meshes, m_draw_commands[i]);
+				}
+			});
 	}
 
 
@@ -1750,17 +2342,14 @@ struct PipelineInstanceImpl : public PipelineInstance
 		m_current_framebuffer = m_default_framebuffer;
 		m_current_light = -1;
 		m_view2pass_map.assign(0xFF);
-		m_instance_data_idx = 0;
 		m_point_light_shadowmaps.clear();
+		invalidateBindCache();
+		setMemory(&m_bind_stats, 0, sizeof(m_bind_stats));
 		for (int i = 0; i < lengthOf(m_terrain_instances); ++i)
 		{
 			m_terrain_instances[i].m_count = 0;
 		}
-		for (int i = 0; i < lengthOf(m_instances_data); ++i)
-		{
-			m_instances_data[i].buffer = nullptr;
-			m_instances_data[i].instance_count = 0;
-		}
+		m_terrain_batches.clear();
 
 		if (lua_getglobal(m_source.m_lua_state, "render") == LUA_TFUNCTION)
 		{
@@ -1775,7 +2364,11 @@ struct PipelineInstanceImpl : public PipelineInstance
 		{
 			lua_pop(m_source.m_lua_state, 1);
 		}
-		finishInstances();
+
+		PROFILE_INT("light binds", m_bind_stats.light_binds);
+		PROFILE_INT("light binds skipped", m_bind_stats.skipped_light_binds);
+		PROFILE_INT("material binds", m_bind_stats.material_binds);
+		PROFILE_INT("material binds skipped", m_bind_stats.skipped_material_binds);
 
 		m_renderer.getFrameAllocator().clear();
 	}
@@ -1786,27 +2379,30 @@ struct PipelineInstanceImpl : public PipelineInstance
 	void setWireframe(bool wireframe) override { m_is_wireframe = wireframe; }
 
 
-	struct TerrainInstance
+	struct BaseVertex
 	{
-		int m_count;
-		const TerrainInfo* m_infos[64];
+		float m_x, m_y, m_z;
+		uint32 m_rgba;
+		float m_u;
+		float m_v;
 	};
 
 
-	struct PointLightShadowmap
+	struct LightItem
 	{
-		ComponentIndex m_light;
-		FrameBuffer* m_framebuffer;
-		Matrix m_matrices[4];
+		int light;
+		int item;
+		// index of the item in the bucketed array
+		int offset;
 	};
 
 
-	struct BaseVertex
+	struct BindStats
 	{
-		float m_x, m_y, m_z;
-		uint32 m_rgba;
-		float m_u;
-		float m_v;
+		int light_binds;
+		int skipped_light_binds;
+		int material_binds;
+		int skipped_material_binds;
 	};
 
 
@@ -1827,15 +2423,19 @@ struct PipelineInstanceImpl : public PipelineInstance
 	Array<bgfx::UniformHandle> m_uniforms;
 	Array<Material*> m_materials;
 	Array<PointLightShadowmap> m_point_light_shadowmaps;
+	Array<CachedShadowmap> m_cached_shadowmaps;
 	FrameBuffer* m_global_light_shadowmap;
-	InstanceData m_instances_data[128];
-	int m_instance_data_idx;
 	ComponentIndex m_applied_camera;
 	ComponentIndex m_current_light;
 	bool m_is_current_light_global;
+	Material* m_bound_material;
+	ComponentIndex m_bound_light;
+	bool m_is_bound_light_global;
+	BindStats m_bind_stats;
 	bool m_is_wireframe;
 	bool m_is_rendering_in_shadowmap;
 	Frustum m_camera_frustum;
+	float m_lod_multiplier;
 
 	Matrix m_shadow_viewprojection[4];
 	int m_view_x;
@@ -1848,6 +2448,27 @@ struct PipelineInstanceImpl : public PipelineInstance
 	Array<RenderableMesh> m_tmp_meshes;
 	Array<const TerrainInfo*> m_tmp_terrains;
 	Array<GrassInfo> m_tmp_grasses;
+	Array<ComponentIndex> m_tmp_lights;
+	Array<Vec4> m_tmp_lights_pos_radius;
+	Array<int> m_tmp_light_indices;
+	Array<LightItem> m_tmp_light_items;
+	Array<Vec4> m_tmp_spheres;
+	Array<RenderableMesh> m_light_meshes;
+	Array<int> m_light_mesh_offsets;
+	Array<const TerrainInfo*> m_light_terrains;
+	Array<int> m_light_terrain_offsets;
+	Array<GrassInfo> m_light_grasses;
+	Array<int> m_light_grass_offsets;
+	Array<uint64> m_sort_keys;
+	Array<uint64> m_tmp_sort_keys;
+	Array<int> m_sort_values;
+	Array<int> m_tmp_sort_values;
+	Array<MeshBatch> m_mesh_batches;
+	Array<TerrainBatch> m_terrain_batches;
+	Array<DrawCommand> m_draw_commands;
+	Array<MTJD::Job*> m_jobs;
+	MTJD::Group m_sync_point;
+	LightGrid m_light_grid;
 
 	bgfx::UniformHandle m_specular_shininess_uniform;
 	bgfx::UniformHandle m_bone_matrices_uniform;
@@ -2145,6 +2766,13 @@ void print(int x, int y, const char* text)
 }
 
 
+void setGlobalLODMultiplier(PipelineInstanceImpl* pipeline, float multiplier)
+{
+	if (!pipeline->getScene()) return;
+	pipeline->getScene()->setGlobalLODMultiplier(multiplier);
+}
+
+
 } // namespace LuaAPI
 
 
@@ -2181,6 +2809,7 @@ void PipelineImpl::registerCFunctions()
 	REGISTER_FUNCTION(hasScene);
 	REGISTER_FUNCTION(bindFramebufferTexture);
 	REGISTER_FUNCTION(renderParticles);
+	REGISTER_FUNCTION(setGlobalLODMultiplier);
 
 	#undef REGISTER_FUNCTION
 }
@@ -12,6 +12,7 @@ namespace Lumix
 	
 class FrameBuffer;
 class JsonSerializer;
+class LightGrid;
 class Material;
 struct Matrix;
 class Model;
@@ -100,5 +101,6 @@ class LUMIX_RENDERER_API PipelineInstance
 		virtual const char* getParameterName(int index) const = 0;
 		virtual void setParameter(int index, bool value) = 0;
 		virtual bool getParameter(int index) = 0;
+		virtual const LightGrid& getLightGrid() const = 0;
 };
 }
\ No newline at end of file
@@ -16,12 +16,14 @@
 #include "core/resource_manager.h"
 #include "core/resource_manager_base.h"
 #include "core/timer.h"
+#include "core/spatial_hash.h"
 #include "core/sphere.h"
 #include "core/frustum.h"
 
 #include "engine.h"
 
 #include "renderer/culling_system.h"
+#include "renderer/frame_packet.h"
 #include "renderer/material.h"
 #include "renderer/model.h"
 #include "renderer/particle_system.h"
@@ -33,6 +35,7 @@
 #include "renderer/texture.h"
 
 #include "universe/universe.h"
+#include <cfloat>
 #include <cmath>
 
 
@@ -58,6 +61,7 @@ static const uint32 PARTICLE_EMITTER_SIZE_HASH = crc32("particle_emitter_size");
 static const uint32 GLOBAL_LIGHT_HASH = crc32("global_light");
 static const uint32 CAMERA_HASH = crc32("camera");
 static const uint32 TERRAIN_HASH = crc32("terrain");
+static const float POINT_LIGHT_HASH_CELL_SIZE = 16.0f;
 
 
 enum class RenderSceneVersion : int32
@@ -67,6 +71,7 @@ enum class RenderSceneVersion : int32
 	PARTICLE_EMITTERS_SPAWN_COUNT,
 	PARTICLES_FORCE_MODULE,
 	PARTICLES_SAVE_SIZE_ALPHA,
+	TERRAIN_TILES,
 
 	LATEST,
 	INVALID = -1,
@@ -169,7 +174,7 @@ public:
 		, m_cameras(m_allocator)
 		, m_terrains(m_allocator)
 		, m_point_lights(m_allocator)
-		, m_light_influenced_geometry(m_allocator)
+		, m_point_light_hash(POINT_LIGHT_HASH_CELL_SIZE, m_allocator)
 		, m_global_lights(m_allocator)
 		, m_debug_lines(m_allocator)
 		, m_debug_points(m_allocator)
@@ -183,8 +188,10 @@ public:
 		, m_renderable_created(m_allocator)
 		, m_renderable_destroyed(m_allocator)
 		, m_is_grass_enabled(true)
+		, m_global_lod_multiplier(1)
 		, m_is_game_running(false)
 		, m_particle_emitters(m_allocator)
+		, m_frame_packet_index(0)
 	{
 		m_universe.entityTransformed()
 			.bind<RenderSceneImpl, &RenderSceneImpl::onEntityMoved>(this);
@@ -192,6 +199,11 @@ public:
 			CullingSystem::create(m_engine.getMTJDManager(), m_allocator);
 		m_time = 0;
 		m_renderables.reserve(5000);
+		for (int i = 0; i < lengthOf(m_frame_packets); ++i)
+		{
+			m_frame_packets[i] =
+				LUMIX_NEW(m_allocator, FramePacket)(m_engine.getMTJDManager(), m_allocator);
+		}
 	}
 
 
@@ -225,6 +237,11 @@ public:
 			}
 		}
 
+		for (int i = 0; i < lengthOf(m_frame_packets); ++i)
+		{
+			LUMIX_DELETE(m_allocator, m_frame_packets[i]);
+		}
+
 		CullingSystem::destroy(*m_culling_system);
 	}
 
@@ -421,15 +438,36 @@ public:
 			}
 		}
 
-		if (m_is_game_running)
+		for (auto* terrain : m_terrains)
 		{
-			for (auto* emitter : m_particle_emitters)
-			{
-				if (!emitter) continue;
+			if (terrain) terrain->update();
+		}
 
-				emitter->update(dt);
-			}
+		if (m_is_game_running) updateParticleEmitters(dt);
+	}
+
+
+	// emitters do not share any data, each one is updated by its own job
+	void updateParticleEmitters(float dt)
+	{
+		PROFILE_FUNCTION();
+		m_jobs.clear();
+		for (auto* emitter : m_particle_emitters)
+		{
+			if (!emitter) continue;
+
+			MTJD::Job* job = MTJD::makeJob(m_engine.getMTJDManager(),
+				[emitter, dt]()
+				{
+					PROFILE_BLOCK("Particle emitter job");
+					PROFILE_INT("Particle count", emitter->m_life.size());
+					emitter->update(dt);
+				},
+				m_allocator);
+			job->addDependency(&m_sync_point);
+			m_jobs.push(job);
 		}
+		runJobs(m_jobs, m_sync_point);
 	}
 
 	void serializeCameras(OutputBlob& serializer)
@@ -664,10 +702,9 @@ public:
 		int32 size = 0;
 		serializer.read(size);
 		m_point_lights.resize(size);
-		m_light_influenced_geometry.clear();
+		m_point_light_hash.clear();
 		for (int i = 0; i < size; ++i)
 		{
-			m_light_influenced_geometry.push(Array<int>(m_allocator));
 			PointLight& light = m_point_lights[i];
 			if (version > RenderSceneVersion::WHOLE_LIGHTS)
 			{
@@ -685,6 +722,7 @@ public:
 				serializer.read(light.m_cast_shadows);
 				light.m_range = 10;
 			}
+			m_point_light_hash.add(light.m_uid, m_universe.getPosition(light.m_entity));
 
 			m_universe.addComponent(light.m_entity, POINT_LIGHT_HASH, this, light.m_uid);
 		}
@@ -719,7 +757,7 @@ public:
 		serializer.read(m_active_global_light_uid);
 	}
 
-	void deserializeTerrains(InputBlob& serializer)
+	void deserializeTerrains(InputBlob& serializer, int version)
 	{
 		int32 size = 0;
 		serializer.read(size);
@@ -746,7 +784,11 @@ public:
 						m_renderer, INVALID_ENTITY, *this, m_allocator);
 				}
 				Terrain* terrain = m_terrains[i];
-				terrain->deserialize(serializer, m_universe, *this, i);
+				terrain->deserialize(serializer,
+					m_universe,
+					*this,
+					i,
+					version > (int)RenderSceneVersion::TERRAIN_TILES);
 			}
 			else
 			{
@@ -767,7 +809,7 @@ public:
 		deserializeCameras(serializer);
 		deserializeRenderables(serializer);
 		deserializeLights(serializer, (RenderSceneVersion)version);
-		deserializeTerrains(serializer);
+		deserializeTerrains(serializer, version);
 		if (version >= 0) deserializeParticleEmitters(serializer, version);
 	}
 
@@ -775,22 +817,6 @@ public:
 	void destroyRenderable(ComponentIndex component)
 	{
 		m_renderable_destroyed.invoke(component);
-		for (int i = 0; i < m_light_influenced_geometry.size(); ++i)
-		{
-			Array<int>& influenced_geometry = m_light_influenced_geometry[i];
-			for (int j = 0; j < influenced_geometry.size(); ++j)
-			{
-				if (influenced_geometry[j] == component)
-				{
-					influenced_geometry.erase(j);
-					--j;
-				}
-				else if (influenced_geometry[j] > component)
-				{
-					--influenced_geometry[j];
-				}
-			}
-		}
 
 		setModel(component, nullptr);
 		Entity entity = m_renderables[component].entity;
@@ -819,13 +845,17 @@ public:
 		int index = getPointLightIndex(component);
 		Entity entity = m_point_lights[getPointLightIndex(component)].m_entity;
 		m_point_lights.eraseFast(index);
-		m_light_influenced_geometry.eraseFast(index);
+		m_point_light_hash.remove(component);
 		m_universe.destroyComponent(entity, POINT_LIGHT_HASH, this, component);
 	}
 
 
 	void destroyCamera(ComponentIndex component)
 	{
+		for (auto* terrain : m_terrains)
+		{
+			if (terrain) terrain->destroyInfoCache(component);
+		}
 		Entity entity = m_cameras[component].m_entity;
 		m_cameras[component].m_is_free = true;
 		m_universe.destroyComponent(entity, CAMERA_HASH, this, component);
@@ -1459,36 +1489,13 @@ public:
 			Renderable& r = m_renderables[cmp];
 			r.matrix = m_universe.getMatrix(entity);
 			m_culling_system->updateBoundingPosition(m_universe.getPosition(entity), cmp);
-
-			if(m_is_forward_rendered)
-			{
-				float bounding_radius = r.model ? r.model->getBoundingRadius() : 1;
-				for (int light_idx = 0, c = m_point_lights.size(); light_idx < c; ++light_idx)
-				{
-					for (int j = 0, c2 = m_light_influenced_geometry[light_idx].size(); j < c2; ++j)
-					{
-						if(m_light_influenced_geometry[light_idx][j] == cmp)
-						{
-							m_light_influenced_geometry[light_idx].eraseFast(j);
-							break;
-						}
-					}
-
-					Vec3 pos = m_universe.getPosition(r.entity);
-					Frustum frustum = getPointLightFrustum(light_idx);
-					if(frustum.isSphereInside(pos, bounding_radius))
-					{
-						m_light_influenced_geometry[light_idx].push(cmp);
-					}
-				}
-			}
 		}
 
 		for (int i = 0, c = m_point_lights.size(); i < c; ++i)
 		{
 			if (m_point_lights[i].m_entity == entity)
 			{
-				detectLightInfluencedGeometry(i);
+				m_point_light_hash.move(m_point_lights[i].m_uid, m_universe.getPosition(entity));
 				break;
 			}
 		}
@@ -1623,18 +1630,29 @@ public:
 	void forceGrassUpdate(ComponentIndex cmp) override { m_terrains[cmp]->forceGrassUpdate(); }
 
 
-	void getTerrainInfos(Array<const TerrainInfo*>& infos,
-								 int64 layer_mask,
-								 const Vec3& camera_pos,
-								 LIFOAllocator& frame_allocator) override
+	void updateTerrainHeightBounds(ComponentIndex cmp,
+		int x,
+		int z,
+		int width,
+		int height) override
+	{
+		m_terrains[cmp]->updateHeightBounds(x, z, width, height);
+	}
+
+
+	void getTerrainInfos(const Frustum& frustum,
+		Array<const TerrainInfo*>& infos,
+		int64 layer_mask,
+		ComponentIndex camera) override
 	{
 		PROFILE_FUNCTION();
 		infos.reserve(m_terrains.size());
+		Vec3 camera_pos = m_universe.getPosition(getCameraEntity(camera));
 		for (int i = 0; i < m_terrains.size(); ++i)
 		{
 			if (m_terrains[i] && (m_terrains[i]->getLayerMask() & layer_mask) != 0)
 			{
-				m_terrains[i]->getInfos(infos, camera_pos, frame_allocator);
+				m_terrains[i]->getInfos(frustum, infos, camera, camera_pos);
 			}
 		}
 	}
@@ -1676,6 +1694,50 @@ public:
 		m_terrains[cmp]->setGrassDistance(value);
 	}
 
+
+	int getTerrainTileCount(ComponentIndex cmp) override
+	{
+		return m_terrains[cmp]->getTileCount();
+	}
+
+
+	void setTerrainTileCount(ComponentIndex cmp, int count) override
+	{
+		m_terrains[cmp]->setTileCount(count);
+	}
+
+
+	int getTerrainTileSize(ComponentIndex cmp) override
+	{
+		return m_terrains[cmp]->getTileSize();
+	}
+
+
+	void setTerrainTileSize(ComponentIndex cmp, int size) override
+	{
+		m_terrains[cmp]->setTileSize(size);
+	}
+
+
+	float getTerrainTileDistance(ComponentIndex cmp) override
+	{
+		return m_terrains[cmp]->getTileDistance();
+	}
+
+
+	void setTerrainTileDistance(ComponentIndex cmp, float distance) override
+	{
+		m_terrains[cmp]->setTileDistance(distance);
+	}
+
+
+	Texture* getTerrainTileHeightmap(ComponentIndex cmp, int x, int z) override
+	{
+		Terrain* tile = m_terrains[cmp]->getTile(x, z);
+		if (!tile || !tile->getHeightmap() || !tile->getHeightmap()->getData()) return nullptr;
+		return tile->getHeightmap();
+	}
+
 	
 	void enableGrass(bool enabled) override
 	{
@@ -1683,6 +1745,18 @@ public:
 	}
 
 
+	void setGlobalLODMultiplier(float multiplier) override
+	{
+		m_global_lod_multiplier = multiplier;
+	}
+
+
+	float getGlobalLODMultiplier() const override
+	{
+		return m_global_lod_multiplier;
+	}
+
+
 	void
 	setGrassDensity(ComponentIndex cmp, int index, int density) override
 	{
@@ -1762,8 +1836,9 @@ public:
 		PROFILE_FUNCTION();
 		if (m_renderables.empty()) return nullptr;
 
-		m_culling_system->cullToFrustumAsync(frustum, layer_mask);
-		return &m_culling_system->getResult();
+		CullingSystem* culling_system = getFramePacket().culling_system;
+		culling_system->cullToFrustumAsync(frustum, layer_mask);
+		return &culling_system->getResult();
 	}
 
 
@@ -1802,7 +1877,24 @@ public:
 	}
 
 
-	void fillTemporaryInfos(const CullingSystem::Results& results, const Frustum& frustum)
+	static void pushLODMeshes(Array<RenderableMesh>& infos,
+		ComponentIndex renderable,
+		Model& model,
+		int lod_index)
+	{
+		LODMeshIndices lod = model.getLODMeshIndicesByIndex(lod_index);
+		for (int j = lod.getFrom(), c = lod.getTo(); j <= c; ++j)
+		{
+			auto& info = infos.pushEmpty();
+			info.renderable = renderable;
+			info.mesh = &model.getMesh(j);
+		}
+	}
+
+
+	void fillTemporaryInfos(const CullingSystem::Results& results,
+		const Vec3& lod_ref_point,
+		float lod_multiplier)
 	{
 		PROFILE_FUNCTION();
 		m_jobs.clear();
@@ -1821,29 +1913,30 @@ public:
 			subinfos.clear();
 			if (results[subresult_index].empty()) continue;
 
+			float squared_lod_multiplier = lod_multiplier * m_global_lod_multiplier;
+			squared_lod_multiplier *= squared_lod_multiplier;
 			MTJD::Job* job = MTJD::makeJob(m_engine.getMTJDManager(),
-				[&subinfos, this, &results, subresult_index, &frustum]()
+				[&subinfos, this, &results, subresult_index, lod_ref_point, squared_lod_multiplier]()
 				{
 					PROFILE_BLOCK("Temporary Info Job");
 					PROFILE_INT("Renderable count", results[subresult_index].size());
-					Vec3 frustum_position = frustum.getPosition();
 					const int* LUMIX_RESTRICT raw_subresults = &results[subresult_index][0];
 					Renderable* LUMIX_RESTRICT renderables = &m_renderables[0];
+					const Matrix* LUMIX_RESTRICT matrices =
+						getFramePacket().renderable_matrices.begin();
 					for (int i = 0, c = results[subresult_index].size(); i < c; ++i)
 					{
-						Renderable* LUMIX_RESTRICT renderable = &renderables[raw_subresults[i]];
-						Model* LUMIX_RESTRICT model = renderable->model;
+						const Matrix& matrix = matrices[raw_subresults[i]];
+						Model* LUMIX_RESTRICT model = renderables[raw_subresults[i]].model;
+						// the matrix is scaled uniformly, so the squared scale is the squared
+						// length of any of its axes
+						float squared_scale = matrix.getXVector().squaredLength();
 						float squared_distance =
-							(renderable->matrix.getTranslation() - frustum_position)
-								.squaredLength();
-
-						LODMeshIndices lod = model->getLODMeshIndices(squared_distance);
-						for (int j = lod.getFrom(), c = lod.getTo(); j <= c; ++j)
-						{
-							auto& info = subinfos.pushEmpty();
-							info.renderable = raw_subresults[i];
-							info.mesh = &model->getMesh(j);
-						}
+							(matrix.getTranslation() - lod_ref_point).squaredLength() *
+							squared_lod_multiplier / squared_scale;
+
+						int lod_index = model->getLODIndex(squared_distance);
+						pushLODMeshes(subinfos, raw_subresults[i], *model, lod_index);
 					}
 				},
 				m_allocator);
@@ -1858,78 +1951,21 @@ public:
 									   ComponentIndex* lights,
 									   int max_lights) override
 	{
-
-		float dists[16];
-		ASSERT(max_lights <= lengthOf(dists));
 		ASSERT(max_lights > 0);
 		if (m_point_lights.empty()) return 0;
 
-		int light_count = 0;
-		for (auto light : m_point_lights)
-		{
-			Vec3 light_pos = m_universe.getPosition(light.m_entity);
-			float dist_squared = (reference_pos - light_pos).squaredLength();
-
-			dists[light_count] = dist_squared;
-			lights[light_count] = light.m_uid;
-
-			for (int i = light_count; i > 0 && dists[i - 1] > dists[i]; --i)
-			{
-				float tmp = dists[i];
-				dists[i] = dists[i - 1];
-				dists[i - 1] = tmp;
-
-				ComponentIndex tmp2 = lights[i];
-				lights[i] = lights[i - 1];
-				lights[i - 1] = tmp2;
-			}
-			++light_count;
-			if (light_count == max_lights)
-			{
-				break;
-			}
-		}
-
-		for (int i = max_lights; i < m_point_lights.size(); ++i)
-		{
-			PointLight& light = m_point_lights[i];
-			Vec3 light_pos = m_universe.getPosition(light.m_entity);
-			float dist_squared = (reference_pos - light_pos).squaredLength();
-
-			if (dist_squared < dists[max_lights - 1])
-			{
-				dists[max_lights - 1] = dist_squared;
-				lights[max_lights - 1] = light.m_uid;
-
-				for (int i = max_lights - 1; i > 0 && dists[i - 1] > dists[i];
-					 --i)
-				{
-					float tmp = dists[i];
-					dists[i] = dists[i - 1];
-					dists[i - 1] = tmp;
-
-					ComponentIndex tmp2 = lights[i];
-					lights[i] = lights[i - 1];
-					lights[i - 1] = tmp2;
-				}
-			}
-		}
-
-		return light_count;
+		return m_point_light_hash.getNearest(reference_pos, FLT_MAX, max_lights, lights);
 	}
 
 
 	void getPointLights(const Frustum& frustum,
 								Array<ComponentIndex>& lights) override
 	{
-		for (int i = 0, ci = m_point_lights.size(); i < ci; ++i)
+		for (const auto& light : getFramePacket().point_lights)
 		{
-			PointLight& light = m_point_lights[i];
-
-			if (frustum.isSphereInside(m_universe.getPosition(light.m_entity),
-									   light.m_range))
+			if (frustum.isSphereInside(light.position, light.range))
 			{
-				lights.push(light.m_uid);
+				lights.push(light.light);
 			}
 		}
 	}
@@ -1961,15 +1997,29 @@ public:
 	{
 		PROFILE_FUNCTION();
 
-		int light_index = getPointLightIndex(light_cmp);
-		for (int j = 0, cj = m_light_influenced_geometry[light_index].size(); j < cj; ++j)
+		const FramePacket& packet = getFramePacket();
+		const FramePacket::PointLight* light = nullptr;
+		for (const auto& packet_light : packet.point_lights)
+		{
+			if (packet_light.light == light_cmp) light = &packet_light;
+		}
+		if (!light) return;
+
+		const CullingSystem::Results* results = cull(frustum, layer_mask);
+		if (!results) return;
+
+		for (const auto& subresults : *results)
 		{
-			ComponentIndex renderable_cmp = m_light_influenced_geometry[light_index][j];
-			Renderable& renderable = m_renderables[renderable_cmp];
-			bool is_layer = (layer_mask & m_culling_system->getLayerMask(renderable_cmp)) != 0;
-			const Sphere& sphere = m_culling_system->getSphere(renderable_cmp);
-			if (is_layer && frustum.isSphereInside(sphere.m_position, sphere.m_radius))
+			for (ComponentIndex renderable_cmp : subresults)
 			{
+				const Sphere& sphere = packet.culling_system->getSphere(renderable_cmp);
+				float max_dist = sphere.m_radius + light->range;
+				if ((sphere.m_position - light->position).squaredLength() > max_dist * max_dist)
+				{
+					continue;
+				}
+
+				const Renderable& renderable = m_renderables[renderable_cmp];
 				for (int k = 0, kc = renderable.model->getMeshCount(); k < kc; ++k)
 				{
 					auto& info = infos.pushEmpty();
@@ -1983,22 +2033,10 @@ public:
 
 	void getPointLightInfluencedGeometry(ComponentIndex light_cmp,
 		Array<RenderableMesh>& infos,
-		int64) override
+		int64 layer_mask) override
 	{
-		PROFILE_FUNCTION();
-
-		int light_index = getPointLightIndex(light_cmp);
-		auto& geoms = m_light_influenced_geometry[light_index];
-		for (int j = 0, cj = geoms.size(); j < cj; ++j)
-		{
-			const Renderable& renderable = m_renderables[geoms[j]];
-			for (int k = 0, kc = renderable.model->getMeshCount(); k < kc; ++k)
-			{
-				auto& info = infos.pushEmpty();
-				info.mesh = &renderable.model->getMesh(k);
-				info.renderable = geoms[j];
-			}
-		}
+		Frustum frustum = getPointLightFrustum(getPointLightIndex(light_cmp));
+		getPointLightInfluencedGeometry(light_cmp, frustum, infos, layer_mask);
 	}
 
 
@@ -2022,15 +2060,17 @@ public:
 
 
 	void getRenderableInfos(const Frustum& frustum,
-									Array<RenderableMesh>& meshes,
-									int64 layer_mask) override
+		Array<RenderableMesh>& meshes,
+		int64 layer_mask,
+		const Vec3& lod_ref_point,
+		float lod_multiplier) override
 	{
 		PROFILE_FUNCTION();
 
 		const CullingSystem::Results* results = cull(frustum, layer_mask);
 		if (!results) return;
 
-		fillTemporaryInfos(*results, frustum);
+		fillTemporaryInfos(*results, lod_ref_point, lod_multiplier);
 		mergeTemporaryInfos(meshes);
 	}
 
@@ -2791,18 +2831,6 @@ public:
 		{
 			r.pose = nullptr;
 		}
-
-		for (int i = 0; i < m_point_lights.size(); ++i)
-		{
-			PointLight& light = m_point_lights[i];
-			Vec3 t = r.matrix.getTranslation();
-			float radius = r.model->getBoundingRadius();
-			if ((t - m_universe.getPosition(light.m_entity)).squaredLength() <
-				(radius + light.m_range) * (radius + light.m_range))
-			{
-				m_light_influenced_geometry[i].push(component);
-			}
-		}
 	}
 
 	void modelLoaded(Model* model)
@@ -2870,30 +2898,6 @@ public:
 	IAllocator& getAllocator() override { return m_allocator; }
 
 
-	void detectLightInfluencedGeometry(int light_index)
-	{
-		if (!m_is_forward_rendered) return;
-		
-		Frustum frustum = getPointLightFrustum(light_index);
-		m_culling_system->cullToFrustum(frustum, 0xffffFFFF);
-		const CullingSystem::Results& results =
-			m_culling_system->getResult();
-		Array<int>& influenced_geometry =
-			m_light_influenced_geometry[light_index];
-		influenced_geometry.clear();
-		for (int i = 0; i < results.size(); ++i)
-		{
-			const CullingSystem::Subresults& subresult = results[i];
-			influenced_geometry.reserve(influenced_geometry.size() +
-										subresult.size());
-			for (int j = 0, c = subresult.size(); j < c; ++j)
-			{
-				influenced_geometry.push(subresult[j]);
-			}
-		}
-	}
-
-
 	int getParticleEmitterAttractorCount(ComponentIndex cmp) override
 	{
 		auto* module = getEmitterModule<ParticleEmitter::AttractorModule>(cmp);
@@ -3076,7 +3080,6 @@ public:
 	ComponentIndex createPointLight(Entity entity)
 	{
 		PointLight& light = m_point_lights.pushEmpty();
-		m_light_influenced_geometry.push(Array<int>(m_allocator));
 		light.m_entity = entity;
 		light.m_diffuse_color.set(1, 1, 1);
 		light.m_intensity = 1;
@@ -3086,11 +3089,10 @@ public:
 		light.m_cast_shadows = false;
 		light.m_attenuation_param = 2;
 		light.m_range = 10;
+		m_point_light_hash.add(light.m_uid, m_universe.getPosition(entity));
 
 		m_universe.addComponent(entity, POINT_LIGHT_HASH, this, light.m_uid);
 
-		detectLightInfluencedGeometry(m_point_lights.size() - 1);
-
 		return light.m_uid;
 	}
 
@@ -3141,6 +3143,131 @@ public:
 	}
 
 
+	void extractFramePacket() override
+	{
+		PROFILE_FUNCTION();
+
+		// the previous packet stays untouched, it can still be in use by whoever renders it
+		m_frame_packet_index = (m_frame_packet_index + 1) % lengthOf(m_frame_packets);
+		FramePacket& packet = *m_frame_packets[m_frame_packet_index];
+		packet.clear();
+		packet.time = m_time;
+		packet.culling_system->copyFrom(*m_culling_system);
+		extractRenderables(packet);
+		extractParticles(packet);
+		extractPointLights(packet);
+	}
+
+
+	void extractPointLights(FramePacket& packet) const
+	{
+		packet.point_lights.resize(m_point_lights.size());
+		for (int i = 0; i < m_point_lights.size(); ++i)
+		{
+			const PointLight& light = m_point_lights[i];
+			auto& packet_light = packet.point_lights[i];
+			packet_light.light = light.m_uid;
+			packet_light.position = m_universe.getPosition(light.m_entity);
+			packet_light.range = light.m_range;
+		}
+	}
+
+
+	const FramePacket& getFramePacket() const override
+	{
+		return *m_frame_packets[m_frame_packet_index];
+	}
+
+
+	void extractRenderables(FramePacket& packet) const
+	{
+		PROFILE_FUNCTION();
+
+		int count = m_renderables.size();
+		packet.renderable_matrices.resize(count);
+		packet.bone_offsets.resize(count);
+		packet.bone_counts.resize(count);
+		int bone_count = 0;
+		for (int i = 0; i < count; ++i)
+		{
+			const Renderable& renderable = m_renderables[i];
+			packet.renderable_matrices[i] = renderable.matrix;
+			packet.bone_offsets[i] = -1;
+			packet.bone_counts[i] = 0;
+			if (renderable.entity == INVALID_ENTITY || !renderable.pose) continue;
+			if (!renderable.model || !renderable.model->isReady()) continue;
+			if (renderable.pose->getCount() == 0) continue;
+
+			packet.bone_offsets[i] = bone_count;
+			packet.bone_counts[i] = renderable.pose->getCount();
+			bone_count += renderable.pose->getCount();
+		}
+
+		packet.bone_matrices.resize(bone_count);
+		for (int i = 0; i < count; ++i)
+		{
+			if (packet.bone_offsets[i] < 0) continue;
+
+			const Renderable& renderable = m_renderables[i];
+			const Pose& pose = *renderable.pose;
+			const Model& model = *renderable.model;
+			const Vec3* poss = pose.getPositions();
+			const Quat* rots = pose.getRotations();
+			Matrix* bone_mtx = &packet.bone_matrices[packet.bone_offsets[i]];
+			for (int bone_index = 0, c = pose.getCount(); bone_index < c; ++bone_index)
+			{
+				rots[bone_index].toMatrix(bone_mtx[bone_index]);
+				bone_mtx[bone_index].translate(poss[bone_index]);
+				bone_mtx[bone_index] =
+					bone_mtx[bone_index] * model.getBone(bone_index).inv_bind_matrix;
+			}
+		}
+	}
+
+
+	void extractParticles(FramePacket& packet) const
+	{
+		PROFILE_FUNCTION();
+
+		for (int i = 0; i < m_particle_emitters.size(); ++i)
+		{
+			const ParticleEmitter* emitter = m_particle_emitters[i];
+			if (!emitter || emitter->m_life.empty() || !emitter->getMaterial()) continue;
+
+			int count = emitter->m_life.size();
+			auto& particles = packet.particles.emplace();
+			particles.emitter = i;
+			particles.material = emitter->getMaterial();
+			particles.offset = packet.particle_instances.size();
+			particles.count = count;
+
+			packet.particle_instances.resize(particles.offset + count);
+			FramePacket::ParticleInstance* instances = &packet.particle_instances[particles.offset];
+			Vec3 min = emitter->m_position[0];
+			Vec3 max = min;
+			float max_size = 0;
+			for (int j = 0; j < count; ++j)
+			{
+				const Vec3& pos = emitter->m_position[j];
+				float size = emitter->m_size[j];
+				instances[j].pos_and_size = Vec4(pos, size);
+				instances[j].alpha_and_rotation =
+					Vec4(emitter->m_alpha[j], emitter->m_rotation[j], 0, 0);
+				min.x = Math::minValue(min.x, pos.x);
+				min.y = Math::minValue(min.y, pos.y);
+				min.z = Math::minValue(min.z, pos.z);
+				max.x = Math::maxValue(max.x, pos.x);
+				max.y = Math::maxValue(max.y, pos.y);
+				max.z = Math::maxValue(max.z, pos.z);
+				max_size = Math::maxValue(max_size, size);
+			}
+			particles.center = (min + max) * 0.5f;
+			// quads are rotated, the corner of a quad is size * sqrt(2) far
+			particles.radius = (max - min).length() * 0.5f + max_size * 1.4143f;
+		}
+	}
+
+
 private:
 	IAllocator& m_allocator;
 	Array<ModelLoadedCallback*> m_model_loaded_callbacks;
@@ -3149,7 +3276,7 @@ private:
 
 	int m_point_light_last_uid;
 	Array<PointLight> m_point_lights;
-	Array<Array<ComponentIndex>> m_light_influenced_geometry;
+	SpatialHash m_point_light_hash;
 	int m_active_global_light_uid;
 	int m_global_light_last_uid;
 	Array<GlobalLight> m_global_lights;
@@ -3170,9 +3297,12 @@ private:
 	float m_time;
 	bool m_is_forward_rendered;
 	bool m_is_grass_enabled;
+	float m_global_lod_multiplier;
 	bool m_is_game_running;
 	DelegateList<void(ComponentIndex)> m_renderable_created;
 	DelegateList<void(ComponentIndex)> m_renderable_destroyed;
+	FramePacket* m_frame_packets[2];
+	int m_frame_packet_index;
 };
 
 
@@ -3261,4 +3391,4 @@ void RenderScene::destroyInstance(RenderScene* scene)
 {
 	LUMIX_DELETE(scene->getAllocator(), static_cast<RenderSceneImpl*>(scene));
 }
-}
\ No newline at end of file
+}
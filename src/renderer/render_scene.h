@@ -14,7 +14,7 @@ namespace Lumix
 
 class Engine;
 class Frustum;
-class LIFOAllocator;
+struct FramePacket;
 class Material;
 class Mesh;
 class Model;
@@ -24,6 +24,7 @@ class Pose;
 class Renderer;
 class Shader;
 class Terrain;
+class Texture;
 class Timer;
 class Universe;
 
@@ -37,6 +38,9 @@ struct TerrainInfo
 	float m_size;
 	Vec3 m_min;
 	int m_index;
+	// world space bounding sphere of the patch
+	Vec3 m_center;
+	float m_radius;
 };
 
 
@@ -60,8 +64,13 @@ struct RenderableMesh
 struct GrassInfo
 {
 	Model* m_model;
-	const Matrix* m_matrices;
+	// idx of the bgfx vertex buffer owned by the terrain, the first m_matrix_count instances
+	// are drawn
+	uint16 m_instance_buffer_idx;
 	int m_matrix_count;
+	// world space bounding sphere of the grass quad
+	Vec3 m_center;
+	float m_radius;
 };
 
 
@@ -113,6 +122,10 @@ public:
 
 	virtual Frustum getCameraFrustum(ComponentIndex camera) const = 0;
 	virtual void update(float dt) = 0;
+	// copies render-relevant state into a frame packet, called by the renderer at the end
+	// of each engine update
+	virtual void extractFramePacket() = 0;
+	virtual const FramePacket& getFramePacket() const = 0;
 	virtual float getTime() const = 0;
 	virtual Engine& getEngine() const = 0;
 	virtual IAllocator& getAllocator() = 0;
@@ -240,9 +253,13 @@ public:
 	virtual void setRenderableLayer(ComponentIndex cmp,
 									const int32& layer) = 0;
 	virtual void setRenderablePath(ComponentIndex cmp, const char* path) = 0;
+	// LODs are picked by distance from lod_ref_point multiplied by lod_multiplier and the
+	// global LOD multiplier and divided by the renderable's scale
 	virtual void getRenderableInfos(const Frustum& frustum,
 		Array<RenderableMesh>& meshes,
-		int64 layer_mask) = 0;
+		int64 layer_mask,
+		const Vec3& lod_ref_point,
+		float lod_multiplier) = 0;
 	virtual void getRenderableEntities(const Frustum& frustum,
 		Array<Entity>& entities,
 		int64 layer_mask) = 0;
@@ -256,10 +273,15 @@ public:
 							   int64 layer_mask,
 							   ComponentIndex camera) = 0;
 	virtual void forceGrassUpdate(ComponentIndex cmp) = 0;
-	virtual void getTerrainInfos(Array<const TerrainInfo*>& infos,
+	virtual void updateTerrainHeightBounds(ComponentIndex cmp,
+		int x,
+		int z,
+		int width,
+		int height) = 0;
+	virtual void getTerrainInfos(const Frustum& frustum,
+		Array<const TerrainInfo*>& infos,
 		int64 layer_mask,
-		const Vec3& camera_pos,
-		LIFOAllocator& allocator) = 0;
+		ComponentIndex camera) = 0;
 	virtual float getTerrainHeightAt(ComponentIndex cmp, float x, float z) = 0;
 	virtual Vec3 getTerrainNormalAt(ComponentIndex cmp, float x, float z) = 0;
 	virtual void setTerrainMaterialPath(ComponentIndex cmp, const char* path) = 0;
@@ -272,9 +294,24 @@ public:
 	virtual void getTerrainSize(ComponentIndex cmp, float* width, float* height) = 0;
 	virtual ComponentIndex getTerrainComponent(Entity entity) = 0;
 
+	// > 1 switches to lower LODs sooner
+	virtual void setGlobalLODMultiplier(float multiplier) = 0;
+	virtual float getGlobalLODMultiplier() const = 0;
+
 	virtual bool isGrassEnabled() const = 0;
 	virtual int getGrassDistance(ComponentIndex cmp) = 0;
 	virtual void setGrassDistance(ComponentIndex cmp, int value) = 0;
+	// tiles per side, 0 if the terrain has a single heightmap
+	virtual int getTerrainTileCount(ComponentIndex cmp) = 0;
+	virtual void setTerrainTileCount(ComponentIndex cmp, int count) = 0;
+	// heightmap pixels per tile side
+	virtual int getTerrainTileSize(ComponentIndex cmp) = 0;
+	virtual void setTerrainTileSize(ComponentIndex cmp, int size) = 0;
+	// tiles closer to the camera than this are streamed in
+	virtual float getTerrainTileDistance(ComponentIndex cmp) = 0;
+	virtual void setTerrainTileDistance(ComponentIndex cmp, float distance) = 0;
+	// null if the tile is not streamed in or its heightmap is not loaded yet
+	virtual Texture* getTerrainTileHeightmap(ComponentIndex cmp, int x, int z) = 0;
 	virtual void enableGrass(bool enabled) = 0;
 	virtual void setGrassPath(ComponentIndex cmp, int index, const char* path) = 0;
 	virtual const char* getGrassPath(ComponentIndex cmp, int index) = 0;
@@ -192,6 +192,7 @@ struct RendererImpl : public Renderer
 		, m_pipeline_manager(*this, m_allocator)
 		, m_passes(m_allocator)
 		, m_shader_defines(m_allocator)
+		, m_scenes(m_allocator)
 		, m_bgfx_allocator(m_allocator)
 		, m_frame_allocator(m_allocator, 10 * 1024 * 1024)
 	{
@@ -258,17 +259,31 @@ struct RendererImpl : public Renderer
 
 	IScene* createScene(UniverseContext& ctx) override
 	{
-		return RenderScene::createInstance(
-			*this, m_engine, *ctx.m_universe, true, m_allocator);
+		RenderScene* scene =
+			RenderScene::createInstance(*this, m_engine, *ctx.m_universe, true, m_allocator);
+		m_scenes.push(scene);
+		return scene;
 	}
 
 
 	void destroyScene(IScene* scene) override
 	{
+		m_scenes.eraseItemFast(static_cast<RenderScene*>(scene));
 		RenderScene::destroyInstance(static_cast<RenderScene*>(scene));
 	}
 
 
+	// plugins are updated after all scenes and the command queue, so the packet sees the final
+	// state of the frame
+	void update(float) override
+	{
+		for (auto* scene : m_scenes)
+		{
+			scene->extractFramePacket();
+		}
+	}
+
+
 	bool create() override { return true; }
 
 
@@ -374,6 +389,7 @@ struct RendererImpl : public Renderer
 	PipelineManager m_pipeline_manager;
 	uint32 m_current_pass_hash;
 	int m_view_counter;
+	Array<RenderScene*> m_scenes;
 	BGFXAllocator m_bgfx_allocator;
 	bgfx::VertexDecl m_basic_vertex_decl;
 	bgfx::VertexDecl m_basic_2d_vertex_decl;
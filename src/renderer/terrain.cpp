@@ -4,11 +4,15 @@
 #include "core/crc32.h"
 #include "core/frustum.h"
 #include "core/json_serializer.h"
-#include "core/lifo_allocator.h"
 #include "core/log.h"
 #include "core/math_utils.h"
+#include "core/mt/atomic.h"
+#include "core/mtjd/generic_job.h"
+#include "core/mtjd/manager.h"
+#include "core/path_utils.h"
 #include "core/profiler.h"
 #include "core/resource_manager.h"
+#include "core/string.h"
 #include "engine.h"
 #include "renderer/material.h"
 #include "renderer/model.h"
@@ -27,6 +31,16 @@ namespace Lumix
 
 static const int GRASS_QUAD_SIZE = 10;
 static const float GRASS_QUAD_RADIUS = GRASS_QUAD_SIZE * 0.7072f;
+static const int MAX_GRASS_QUADS_PER_FRAME = 8;
+// quads farther than this part of the grass distance are thinned out
+static const float GRASS_THINNING_START = 0.5f;
+static const float GRASS_MIN_DENSITY = 0.25f;
+// in heightmap pixels, the selected terrain patches are reused until the camera moves farther
+static const float INFO_CACHE_DISTANCE = 1.0f;
+static const int MAX_TILE_COUNT = 64;
+static const int MAX_TILES_STREAMED_PER_FRAME = 4;
+// tiles are streamed out a bit farther than they are streamed in so they do not flicker
+static const float TILE_STREAM_OUT_FACTOR = 1.25f;
 static const int GRID_SIZE = 16;
 static const int COPY_COUNT = 50;
 static const uint32 TERRAIN_HASH = crc32("terrain");
@@ -40,6 +54,101 @@ static const uint32 MAP_SIZE_HASH = crc32("map_size");
 static const uint32 CAMERA_POS_HASH = crc32("camera_pos");
 static const char* TEX_COLOR_UNIFORM = "u_texColor";
 
+// stateless, the same quad always gets the same grass no matter which thread generates it
+static uint32 hashUInt32(uint32 x)
+{
+	x ^= x >> 16;
+	x *= 0x7feb352d;
+	x ^= x >> 15;
+	x *= 0x846ca68b;
+	x ^= x >> 16;
+	return x;
+}
+
+
+struct GrassRandom
+{
+	explicit GrassRandom(uint32 seed)
+		: m_state(seed)
+	{
+	}
+
+	int next(int range)
+	{
+		++m_state;
+		return int(hashUInt32(m_state) % (uint32)range);
+	}
+
+	uint32 m_state;
+};
+
+
+struct HeightmapSampler
+{
+	explicit HeightmapSampler(Texture* heightmap)
+	{
+		data = heightmap ? heightmap->getData() : nullptr;
+		if (!data) return;
+		bpp = heightmap->getBytesPerPixel();
+		width = heightmap->getWidth();
+		height = heightmap->getHeight();
+	}
+
+
+	// in [0, 1]
+	float getNormalized(int x, int z) const
+	{
+		int idx = Math::clamp(x, 0, width - 1) + Math::clamp(z, 0, height - 1) * width;
+		if (bpp == 2) return ((const uint16*)data)[idx] * (1 / 65535.0f);
+		ASSERT(bpp == 4);
+		return data[idx * 4] * (1 / 255.0f);
+	}
+
+
+	const uint8* data;
+	int bpp;
+	int width;
+	int height;
+};
+
+
+// entry distance of the ray to the box, 0 if the origin is inside
+static bool getRayAABBDistance(const Vec3& origin,
+	const Vec3& dir,
+	const Vec3& min,
+	const Vec3& max,
+	float& out_t)
+{
+	float t_near = 0;
+	float t_far = FLT_MAX;
+	for (int i = 0; i < 3; ++i)
+	{
+		float o = (&origin.x)[i];
+		float d = (&dir.x)[i];
+		float lo = (&min.x)[i];
+		float hi = (&max.x)[i];
+		if (Math::abs(d) < 1e-9f)
+		{
+			if (o < lo || o > hi) return false;
+			continue;
+		}
+		float t0 = (lo - o) / d;
+		float t1 = (hi - o) / d;
+		if (t0 > t1)
+		{
+			float tmp = t0;
+			t0 = t1;
+			t1 = tmp;
+		}
+		t_near = Math::maxValue(t_near, t0);
+		t_far = Math::minValue(t_far, t1);
+		if (t_near > t_far) return false;
+	}
+	out_t = t_near;
+	return true;
+}
+
+
 struct Sample
 {
 	Vec3 pos;
@@ -59,6 +168,8 @@ struct TerrainQuad
 
 	TerrainQuad(IAllocator& allocator)
 		: m_allocator(allocator)
+		, m_min_height(0)
+		, m_max_height(0)
 	{
 		for (int i = 0; i < CHILD_COUNT; ++i)
 		{
@@ -135,32 +246,81 @@ struct TerrainQuad
 		return (size > 17 ? 2.25f : 1.25f) * Math::SQRT2 * size;
 	}
 
-	bool getInfos(Array<const TerrainInfo*>& infos,
+	// recomputes bounds of quads overlapping cells [from_x, to_x) x [from_z, to_z)
+	void updateHeightBounds(const Terrain& terrain, int from_x, int from_z, int to_x, int to_z)
+	{
+		int min_x = (int)m_min.x;
+		int min_z = (int)m_min.z;
+		int max_x = (int)(m_min.x + m_size);
+		int max_z = (int)(m_min.z + m_size);
+		if (from_x >= max_x || from_z >= max_z || to_x <= min_x || to_z <= min_z) return;
+
+		Terrain::HeightBounds bounds = {FLT_MAX, -FLT_MAX};
+		if (m_children[0])
+		{
+			for (int i = 0; i < CHILD_COUNT; ++i)
+			{
+				TerrainQuad* child = m_children[i];
+				child->updateHeightBounds(terrain, from_x, from_z, to_x, to_z);
+				bounds.min = Math::minValue(bounds.min, child->m_min_height);
+				bounds.max = Math::maxValue(bounds.max, child->m_max_height);
+			}
+		}
+		else
+		{
+			bounds = terrain.getHeightBounds(min_x, min_z, max_x, max_z);
+		}
+		if (bounds.min > bounds.max) bounds.min = bounds.max = 0;
+		m_min_height = bounds.min;
+		m_max_height = bounds.max;
+	}
+
+	// the patch is quarter info.m_index of this quad, the child has tighter bounds if it exists
+	void addInfo(Array<TerrainInfo>& infos, const TerrainInfo& info, const Terrain& terrain) const
+	{
+		TerrainInfo& added = infos.pushEmpty();
+		added = info;
+
+		const TerrainQuad* child = m_children[info.m_index];
+		float min_height = child ? child->m_min_height : m_min_height;
+		float max_height = child ? child->m_max_height : m_max_height;
+		float half_size = m_size * 0.25f;
+		float offset_x = (info.m_index & 1) ? m_size * 0.5f : 0;
+		float offset_z = (info.m_index & 2) ? m_size * 0.5f : 0;
+
+		Vec3 scale = terrain.getScale();
+		Vec3 local_center((m_min.x + offset_x + half_size) * scale.x,
+			(min_height + max_height) * 0.5f * scale.y,
+			(m_min.z + offset_z + half_size) * scale.z);
+		Vec3 extents(
+			half_size * scale.x, (max_height - min_height) * 0.5f * scale.y, half_size * scale.z);
+		added.m_center = info.m_world_matrix.multiplyPosition(local_center);
+		added.m_radius = extents.length() * info.m_world_matrix.getXVector().length();
+	}
+
+	bool getInfos(Array<TerrainInfo>& infos,
 		const Vec3& camera_pos,
 		Terrain* terrain,
-		const Matrix& world_matrix,
-		LIFOAllocator& allocator)
+		const Matrix& world_matrix)
 	{
 		float squared_dist = getSquaredDistance(camera_pos);
 		float r = getRadiusOuter(m_size);
 		if (squared_dist > r * r && m_lod > 1) return false;
 
-		Vec3 morph_const(r, getRadiusInner(m_size), 0);
-		Shader& shader = *terrain->getMesh()->getMaterial()->getShader();
+		TerrainInfo data;
+		data.m_morph_const.set(r, getRadiusInner(m_size), 0);
+		data.m_terrain = terrain;
+		data.m_size = m_size;
+		data.m_min = m_min;
+		data.m_shader = terrain->getMesh()->getMaterial()->getShader();
+		data.m_world_matrix = world_matrix;
 		for (int i = 0; i < CHILD_COUNT; ++i)
 		{
 			if (!m_children[i] ||
-				!m_children[i]->getInfos(infos, camera_pos, terrain, world_matrix, allocator))
+				!m_children[i]->getInfos(infos, camera_pos, terrain, world_matrix))
 			{
-				TerrainInfo* data = (TerrainInfo*)allocator.allocate(sizeof(TerrainInfo));
-				data->m_morph_const = morph_const;
-				data->m_index = i;
-				data->m_terrain = terrain;
-				data->m_size = m_size;
-				data->m_min = m_min;
-				data->m_shader = &shader;
-				data->m_world_matrix = world_matrix;
-				infos.push(data);
+				data.m_index = i;
+				addInfo(infos, data, *terrain);
 			}
 		}
 		return true;
@@ -171,6 +331,9 @@ struct TerrainQuad
 	TerrainQuad* m_children[CHILD_COUNT];
 	Vec3 m_min;
 	float m_size;
+	// normalized like Terrain::HeightBounds
+	float m_min_height;
+	float m_max_height;
 	int m_lod;
 };
 
@@ -180,6 +343,14 @@ Terrain::Terrain(Renderer& renderer, Entity entity, RenderScene& scene, IAllocat
 	, m_material(nullptr)
 	, m_root(nullptr)
 	, m_detail_texture(nullptr)
+	, m_tiles(m_allocator)
+	, m_tile_count(0)
+	, m_tile_size(512)
+	, m_tile_distance(1000.0f)
+	, m_tile_offset(0, 0, 0)
+	, m_is_tile(false)
+	, m_streaming_center(0, 0, 0)
+	, m_has_streaming_center(false)
 	, m_heightmap(nullptr)
 	, m_splatmap(nullptr)
 	, m_width(0)
@@ -191,13 +362,25 @@ Terrain::Terrain(Renderer& renderer, Entity entity, RenderScene& scene, IAllocat
 	, m_allocator(allocator)
 	, m_grass_quads(m_allocator)
 	, m_last_camera_position(m_allocator)
+	, m_info_caches(m_allocator)
 	, m_grass_types(m_allocator)
+	, m_height_bounds(m_allocator)
+	, m_height_bounds_levels(m_allocator)
 	, m_free_grass_quads(m_allocator)
+	, m_retired_grass_quads(m_allocator)
+	, m_grass_sync_point(true, m_allocator)
+	, m_force_grass_update(false)
 	, m_renderer(renderer)
 	, m_vertices_handle(BGFX_INVALID_HANDLE)
 	, m_indices_handle(BGFX_INVALID_HANDLE)
 	, m_grass_distance(5)
 {
+	m_grass_instance_decl.begin()
+		.add(bgfx::Attrib::TexCoord7, 4, bgfx::AttribType::Float)
+		.add(bgfx::Attrib::TexCoord6, 4, bgfx::AttribType::Float)
+		.add(bgfx::Attrib::TexCoord5, 4, bgfx::AttribType::Float)
+		.add(bgfx::Attrib::TexCoord4, 4, bgfx::AttribType::Float)
+		.end();
 	generateGeometry();
 }
 
@@ -212,10 +395,16 @@ Terrain::GrassType::~GrassType()
 
 Terrain::~Terrain()
 {
+	destroyTiles();
+	waitForGrassJobs();
 	bgfx::destroyIndexBuffer(m_indices_handle);
 	bgfx::destroyVertexBuffer(m_vertices_handle);
 
 	setMaterial(nullptr);
+	for (int i = 0; i < m_info_caches.size(); ++i)
+	{
+		LUMIX_DELETE(m_allocator, m_info_caches.at(i));
+	}
 	LUMIX_DELETE(m_allocator, m_mesh);
 	LUMIX_DELETE(m_allocator, m_root);
 	for(int i = 0; i < m_grass_types.size(); ++i)
@@ -227,12 +416,16 @@ Terrain::~Terrain()
 		Array<GrassQuad*>& quads = m_grass_quads.at(j);
 		for (int i = 0; i < quads.size(); ++i)
 		{
-			LUMIX_DELETE(m_allocator, quads[i]);
+			destroyGrassQuad(quads[i]);
 		}
 	}
 	for (int i = 0; i < m_free_grass_quads.size(); ++i)
 	{
-		LUMIX_DELETE(m_allocator, m_free_grass_quads[i]);
+		destroyGrassQuad(m_free_grass_quads[i]);
+	}
+	for (int i = 0; i < m_retired_grass_quads.size(); ++i)
+	{
+		destroyGrassQuad(m_retired_grass_quads[i]);
 	}
 }
 
@@ -254,6 +447,7 @@ float Terrain::getRootSize() const
 
 void Terrain::addGrassType(int index)
 {
+	forceGrassUpdate();
 	if(index < 0)
 	{
 		m_grass_types.push(LUMIX_NEW(m_allocator, GrassType)(*this));
@@ -262,14 +456,33 @@ void Terrain::addGrassType(int index)
 	{
 		m_grass_types.insert(index, LUMIX_NEW(m_allocator, GrassType)(*this));
 	}
+	syncTiles();
 }
 
 
 void Terrain::removeGrassType(int index)
 {
 	forceGrassUpdate();
+	GrassType* type = m_grass_types[index];
+	for (int i = 0; i < m_grass_quads.size(); ++i)
+	{
+		for (auto* quad : m_grass_quads.at(i))
+		{
+			for (int j = quad->m_patches.size() - 1; j >= 0; --j)
+			{
+				GrassPatch& patch = quad->m_patches[j];
+				if (patch.m_type != type) continue;
+				if (bgfx::isValid(patch.m_instance_buffer))
+				{
+					bgfx::destroyVertexBuffer(patch.m_instance_buffer);
+				}
+				quad->m_patches.erase(j);
+			}
+		}
+	}
 	LUMIX_DELETE(m_allocator, m_grass_types[index]);
 	m_grass_types.erase(index);
+	syncTiles();
 }
 
 
@@ -278,6 +491,7 @@ void Terrain::setGrassTypeDensity(int index, int density)
 	forceGrassUpdate();
 	GrassType& type = *m_grass_types[index];
 	type.m_density = Math::clamp(density, 0, 50);
+	syncTiles();
 }
 
 
@@ -294,6 +508,7 @@ void Terrain::setGrassTypeGround(int index, int ground)
 	forceGrassUpdate();
 	GrassType& type = *m_grass_types[index];
 	type.m_ground = ground;
+	syncTiles();
 }
 	
 	
@@ -330,21 +545,107 @@ void Terrain::setGrassTypePath(int index, const Path& path)
 		type.m_grass_model = static_cast<Model*>(m_scene.getEngine().getResourceManager().get(ResourceManager::MODEL)->load(path));
 		type.m_grass_model->onLoaded<GrassType, &GrassType::grassLoaded>(&type);
 	}
+	syncTiles();
 }
 	
 
 void Terrain::forceGrassUpdate()
 {
+	// running jobs read the grass types and the splatmap, which are about to change
+	waitForGrassJobs();
 	m_force_grass_update = true;
 	for (int i = 0; i < m_grass_quads.size(); ++i)
 	{
-		Array<GrassQuad*>& quads = m_grass_quads.at(i);
-		while(!quads.empty())
+		// old patches are drawn until the new ones are generated
+		for (auto* quad : m_grass_quads.at(i))
+		{
+			quad->m_state = (int32)GrassQuad::State::QUEUED;
+		}
+	}
+}
+
+
+void Terrain::waitForGrassJobs()
+{
+	if (m_grass_sync_point.getDependenceCount() > 0) m_grass_sync_point.sync();
+
+	for (int i = 0; i < m_grass_quads.size(); ++i)
+	{
+		finishGrassQuads(m_grass_quads.at(i));
+	}
+	for (auto* quad : m_retired_grass_quads)
+	{
+		quad->m_state = (int32)GrassQuad::State::READY;
+		m_free_grass_quads.push(quad);
+	}
+	m_retired_grass_quads.clear();
+}
+
+
+void Terrain::destroyGrassPatches(Array<GrassPatch>& patches)
+{
+	for (auto& patch : patches)
+	{
+		if (bgfx::isValid(patch.m_instance_buffer))
 		{
-			m_free_grass_quads.push(quads.back());
-			quads.pop();
+			bgfx::destroyVertexBuffer(patch.m_instance_buffer);
 		}
 	}
+	patches.clear();
+}
+
+
+void Terrain::destroyGrassQuad(GrassQuad* quad)
+{
+	destroyGrassPatches(quad->m_patches);
+	LUMIX_DELETE(m_allocator, quad);
+}
+
+
+void Terrain::retireGrassQuad(GrassQuad* quad)
+{
+	destroyGrassPatches(quad->m_patches);
+	if (quad->m_state == (int32)GrassQuad::State::GENERATING)
+	{
+		m_retired_grass_quads.push(quad);
+		return;
+	}
+	quad->m_state = (int32)GrassQuad::State::READY;
+	m_free_grass_quads.push(quad);
+}
+
+
+void Terrain::finishGrassQuads(Array<GrassQuad*>& quads)
+{
+	for (auto* quad : quads)
+	{
+		if (quad->m_state != (int32)GrassQuad::State::GENERATED) continue;
+
+		MT::memoryBarrier();
+		destroyGrassPatches(quad->m_patches);
+		quad->m_patches.swap(quad->m_generated_patches);
+		// uploaded once, drawn every frame until the quad is generated again
+		for (auto& patch : quad->m_patches)
+		{
+			if (patch.m_matrices.empty()) continue;
+			const bgfx::Memory* mem =
+				bgfx::copy(&patch.m_matrices[0], patch.m_matrices.size() * sizeof(Matrix));
+			patch.m_instance_buffer = bgfx::createVertexBuffer(mem, m_grass_instance_decl);
+		}
+		quad->pos.y = quad->generated_y;
+		quad->radius = quad->generated_radius;
+		quad->m_state = (int32)GrassQuad::State::READY;
+	}
+
+	for (int i = m_retired_grass_quads.size() - 1; i >= 0; --i)
+	{
+		GrassQuad* quad = m_retired_grass_quads[i];
+		if (quad->m_state != (int32)GrassQuad::State::GENERATED) continue;
+
+		quad->m_state = (int32)GrassQuad::State::READY;
+		m_free_grass_quads.push(quad);
+		m_retired_grass_quads.eraseFast(i);
+	}
 }
 
 Array<Terrain::GrassQuad*>& Terrain::getQuads(ComponentIndex camera)
@@ -362,13 +663,16 @@ Array<Terrain::GrassQuad*>& Terrain::getQuads(ComponentIndex camera)
 void Terrain::generateGrassTypeQuad(GrassPatch& patch,
 									const Matrix& terrain_matrix,
 									float quad_x,
-									float quad_z)
+									float quad_z,
+									uint32 seed)
 {
 	if (!patch.m_type->m_grass_model || !patch.m_type->m_grass_model->isReady())
 		return;
 
 	Texture* splat_map = m_splatmap;
 	float step = GRASS_QUAD_SIZE / (float)patch.m_type->m_density;
+	GrassRandom random(seed);
+	int shared_pixel = m_is_tile ? 1 : 0;
 
 	for (float dx = 0; dx < GRASS_QUAD_SIZE; dx += step)
 	{
@@ -376,9 +680,9 @@ void Terrain::generateGrassTypeQuad(GrassPatch& patch,
 		{
 			uint32 pixel_value = splat_map->getPixelNearest(
 				int(splat_map->getWidth() * (quad_x + dx) /
-					(m_width * m_scale.x)),
+					((m_width - shared_pixel) * m_scale.x)),
 				int(splat_map->getHeight() * (quad_z + dz) /
-					(m_height * m_scale.x)));
+					((m_height - shared_pixel) * m_scale.x)));
 
 			int ground_index = pixel_value & 0xff;
 			int weight = (pixel_value >> 8) & 0xff;
@@ -388,16 +692,107 @@ void Terrain::generateGrassTypeQuad(GrassPatch& patch,
 			if (density < 0.25f) continue;
 
 			Matrix& grass_mtx = patch.m_matrices.pushEmpty();
-			grass_mtx = Matrix::IDENTITY;
-			float x = quad_x + dx + step * (rand() % 100 - 50) / 100.0f;
-			float z = quad_z + dz + step * (rand() % 100 - 50) / 100.0f;
-			grass_mtx.setTranslation(Vec3(x, getHeight(x, z), z));
-			Quat q(Vec3(0, 1, 0), Math::degreesToRadians((float)(rand() % 360)));
-			Matrix rotMatrix;
-			q.toMatrix(rotMatrix);
-			grass_mtx = terrain_matrix * grass_mtx * rotMatrix;
-			grass_mtx.multiply3x3(density + (rand() % 20 - 10) / 100.0f);
+			float x = quad_x + dx + step * (random.next(100) - 50) / 100.0f;
+			float z = quad_z + dz + step * (random.next(100) - 50) / 100.0f;
+			Quat q(Vec3(0, 1, 0), Math::degreesToRadians((float)random.next(360)));
+			q.toMatrix(grass_mtx);
+			grass_mtx.multiply3x3(density + (random.next(20) - 10) / 100.0f);
+			grass_mtx.setTranslation(Vec3(x, 0, z));
+		}
+	}
+
+	// heights of the whole patch at once
+	Array<Vec3> positions(m_allocator);
+	positions.resize(patch.m_matrices.size());
+	for (int i = 0; i < positions.size(); ++i)
+	{
+		positions[i] = patch.m_matrices[i].getTranslation();
+	}
+	getHeights(positions.begin(), positions.size());
+	for (int i = 0; i < positions.size(); ++i)
+	{
+		Matrix& grass_mtx = patch.m_matrices[i];
+		grass_mtx.setTranslation(positions[i]);
+		grass_mtx = terrain_matrix * grass_mtx;
+	}
+
+	for (int i = patch.m_matrices.size() - 1; i > 0; --i)
+	{
+		int j = random.next(i + 1);
+		Matrix tmp = patch.m_matrices[i];
+		patch.m_matrices[i] = patch.m_matrices[j];
+		patch.m_matrices[j] = tmp;
+	}
+}
+
+
+// runs in a job, touches only the quad's m_generated_patches and generated_* members
+void Terrain::generateGrassQuad(GrassQuad& quad, const Matrix& terrain_matrix)
+{
+	PROFILE_FUNCTION();
+	quad.m_generated_patches.clear();
+	uint32 quad_seed =
+		hashUInt32((uint32)(int)quad.pos.x * 73856093U ^ (uint32)(int)quad.pos.z * 19349663U);
+
+	float min_y = FLT_MAX;
+	float max_y = -FLT_MAX;
+	for (int i = 0; i < m_grass_types.size(); ++i)
+	{
+		GrassType* grass_type = m_grass_types[i];
+		Model* model = grass_type->m_grass_model;
+		if (!model || !model->isReady()) continue;
+		GrassPatch& patch = quad.m_generated_patches.emplace(m_allocator);
+		patch.m_matrices.clear();
+		patch.m_type = grass_type;
+
+		generateGrassTypeQuad(patch, terrain_matrix, quad.pos.x, quad.pos.z, hashUInt32(quad_seed + i));
+		for (auto mtx : patch.m_matrices)
+		{
+			min_y = Math::minValue(mtx.getTranslation().y, min_y);
+			max_y = Math::maxValue(mtx.getTranslation().y, max_y);
+		}
+	}
+
+	quad.generated_y = (max_y + min_y) * 0.5f;
+	quad.generated_radius = Math::maxValue((max_y - min_y) * 0.5f, (float)GRASS_QUAD_SIZE) * 1.42f;
+}
+
+
+void Terrain::scheduleGrassQuads(Array<GrassQuad*>& quads,
+	const Vec3& local_camera_pos,
+	const Matrix& terrain_matrix)
+{
+	MTJD::Manager& manager = m_scene.getEngine().getMTJDManager();
+	// nearest quads first, the rest waits for the next frames
+	for (int i = 0; i < MAX_GRASS_QUADS_PER_FRAME; ++i)
+	{
+		GrassQuad* nearest = nullptr;
+		float nearest_dist = FLT_MAX;
+		for (auto* quad : quads)
+		{
+			if (quad->m_state != (int32)GrassQuad::State::QUEUED) continue;
+
+			float dx = quad->pos.x + GRASS_QUAD_SIZE * 0.5f - local_camera_pos.x;
+			float dz = quad->pos.z + GRASS_QUAD_SIZE * 0.5f - local_camera_pos.z;
+			float dist = dx * dx + dz * dz;
+			if (dist < nearest_dist)
+			{
+				nearest_dist = dist;
+				nearest = quad;
+			}
 		}
+		if (!nearest) return;
+
+		nearest->m_state = (int32)GrassQuad::State::GENERATING;
+		MTJD::Job* job = MTJD::makeJob(manager,
+			[this, nearest, terrain_matrix]() {
+				generateGrassQuad(*nearest, terrain_matrix);
+				MT::memoryBarrier();
+				nearest->m_state = (int32)GrassQuad::State::GENERATED;
+			},
+			m_allocator);
+		job->addDependency(&m_grass_sync_point);
+		manager.schedule(job);
 	}
 }
 
@@ -409,6 +804,7 @@ void Terrain::updateGrass(ComponentIndex camera)
 		return;
 
 	Array<GrassQuad*>& quads = getQuads(camera);
+	finishGrassQuads(quads);
 
 	if (m_free_grass_quads.size() + quads.size() < m_grass_distance * m_grass_distance)
 	{
@@ -422,16 +818,19 @@ void Terrain::updateGrass(ComponentIndex camera)
 	Universe& universe = m_scene.getUniverse();
 	Entity camera_entity = m_scene.getCameraEntity(camera);
 	Vec3 camera_pos = universe.getPosition(camera_entity);
+	Matrix mtx = getMatrix();
+	Matrix inv_mtx = mtx;
+	inv_mtx.fastInverse();
+	Vec3 local_camera_pos = inv_mtx.multiplyPosition(camera_pos);
 
 	if ((m_last_camera_position[camera] - camera_pos).length() <= FLT_MIN && !m_force_grass_update)
+	{
+		scheduleGrassQuads(quads, local_camera_pos, mtx);
 		return;
+	}
 	m_last_camera_position[camera] = camera_pos;
 
 	m_force_grass_update = false;
-	Matrix mtx = universe.getMatrix(m_entity);
-	Matrix inv_mtx = mtx;
-	inv_mtx.fastInverse();
-	Vec3 local_camera_pos = inv_mtx.multiplyPosition(camera_pos);
 	float cx = (int)(local_camera_pos.x / (GRASS_QUAD_SIZE)) * (float)GRASS_QUAD_SIZE;
 	float cz = (int)(local_camera_pos.z / (GRASS_QUAD_SIZE)) * (float)GRASS_QUAD_SIZE;
 	float from_quad_x = cx - (m_grass_distance >> 1) * GRASS_QUAD_SIZE;
@@ -450,7 +849,7 @@ void Terrain::updateGrass(ComponentIndex camera)
 		if (quad->pos.x < from_quad_x || quad->pos.x > to_quad_x || quad->pos.z < from_quad_z ||
 			quad->pos.z > to_quad_z)
 		{
-			m_free_grass_quads.push(quads[i]);
+			retireGrassQuad(quads[i]);
 			quads.eraseFast(i);
 		}
 	}
@@ -478,33 +877,15 @@ void Terrain::updateGrass(ComponentIndex camera)
 			}
 			quads.push(quad);
 			quad->pos.x = quad_x;
+			quad->pos.y = 0;
 			quad->pos.z = quad_z;
-			quad->m_patches.clear();
-			srand((int)quad_x + (int)quad_z * m_grass_distance);
-
-			float min_y = FLT_MAX;
-			float max_y = -FLT_MAX;
-			for (auto* grass_type : m_grass_types)
-			{
-				Model* model = grass_type->m_grass_model;
-				if (!model || !model->isReady()) continue;
-				GrassPatch& patch = quad->m_patches.emplace(m_allocator);
-				patch.m_matrices.clear();
-				patch.m_type = grass_type;
-
-				generateGrassTypeQuad(patch, mtx, quad_x, quad_z);
-				for (auto mtx : patch.m_matrices)
-				{
-					min_y = Math::minValue(mtx.getTranslation().y, min_y);
-					max_y = Math::maxValue(mtx.getTranslation().y, max_y);
-				}
-			}
-
-			quad->pos.y = (max_y + min_y) * 0.5f;
-			quad->radius = Math::maxValue((max_y - min_y) * 0.5f, (float)GRASS_QUAD_SIZE) * 1.42f;
-
+			quad->radius = 0;
+			destroyGrassPatches(quad->m_patches);
+			quad->m_state = (int32)GrassQuad::State::QUEUED;
 		}
 	}
+
+	scheduleGrassQuads(quads, local_camera_pos, mtx);
 }
 
 
@@ -516,26 +897,51 @@ void Terrain::GrassType::grassLoaded(Resource::State, Resource::State)
 
 void Terrain::getGrassInfos(const Frustum& frustum, Array<GrassInfo>& infos, ComponentIndex camera)
 {
+	if (m_tile_count > 0)
+	{
+		for (auto* tile : m_tiles)
+		{
+			if (tile) tile->getGrassInfos(frustum, infos, camera);
+		}
+		return;
+	}
+
 	updateGrass(camera);
 	Array<GrassQuad*>& quads = getQuads(camera);
 	
 	Universe& universe = m_scene.getUniverse();
-	Matrix mtx = universe.getMatrix(m_entity);
+	Matrix mtx = getMatrix();
+	Vec3 camera_pos = universe.getPosition(m_scene.getCameraEntity(camera));
+	float max_distance = (m_grass_distance >> 1) * (float)GRASS_QUAD_SIZE * m_scale.x;
+	float thinning_start = max_distance * GRASS_THINNING_START;
 	for (auto* quad : quads)
 	{
 		Vec3 quad_center(quad->pos.x + GRASS_QUAD_SIZE * 0.5f, quad->pos.y, quad->pos.z + GRASS_QUAD_SIZE * 0.5f);
 		quad_center = mtx.multiplyPosition(quad_center);
 		if(frustum.isSphereInside(quad_center, quad->radius)) 
 		{
+			float density = 1;
+			float distance = (quad_center - camera_pos).length();
+			if (distance > thinning_start && max_distance > thinning_start)
+			{
+				float t = Math::minValue(
+					(distance - thinning_start) / (max_distance - thinning_start), 1.0f);
+				density = 1 - t * (1 - GRASS_MIN_DENSITY);
+			}
+
 			for(int patch_idx = 0; patch_idx < quad->m_patches.size(); ++patch_idx)
 			{
 				const GrassPatch& patch = quad->m_patches[patch_idx];
-				if (!patch.m_matrices.empty())
+				Model* model = patch.m_type->m_grass_model;
+				if (bgfx::isValid(patch.m_instance_buffer) && model && model->isReady())
 				{
 					GrassInfo& info = infos.pushEmpty();
-					info.m_matrices = &patch.m_matrices[0];
-					info.m_matrix_count = patch.m_matrices.size();
-					info.m_model = patch.m_type->m_grass_model;
+					info.m_instance_buffer_idx = patch.m_instance_buffer.idx;
+					info.m_matrix_count =
+						Math::maxValue(1, int(patch.m_matrices.size() * density));
+					info.m_model = model;
+					info.m_center = quad_center;
+					info.m_radius = quad->radius;
 				}
 			}
 		}
@@ -547,14 +953,20 @@ void Terrain::setMaterial(Material* material)
 {
 	if (material != m_material)
 	{
+		waitForGrassJobs();
 		if (m_material)
 		{
 			m_material->getResourceManager().get(ResourceManager::MATERIAL)->unload(*m_material);
 			m_material->getObserverCb().unbind<Terrain, &Terrain::onMaterialLoaded>(this);
 		}
+		// tiles are named after the material
+		destroyTiles();
 		m_material = material;
 		m_splatmap = nullptr;
 		m_heightmap = nullptr;
+		m_height_bounds.clear();
+		m_height_bounds_levels.clear();
+		invalidateInfoCaches();
 		if (m_mesh && m_material)
 		{
 			m_mesh->setMaterial(m_material);
@@ -567,7 +979,238 @@ void Terrain::setMaterial(Material* material)
 	}
 }
 
-void Terrain::deserialize(InputBlob& serializer, Universe& universe, RenderScene& scene, int index)
+void Terrain::setXZScale(float scale)
+{
+	m_scale.x = scale;
+	m_scale.z = scale;
+	invalidateInfoCaches();
+	syncTiles();
+}
+
+
+void Terrain::setYScale(float scale)
+{
+	m_scale.y = scale;
+	invalidateInfoCaches();
+	syncTiles();
+}
+
+
+void Terrain::setGrassDistance(int value)
+{
+	m_grass_distance = value;
+	forceGrassUpdate();
+	syncTiles();
+}
+
+
+void Terrain::getSize(float* width, float* height) const
+{
+	ASSERT(width);
+	ASSERT(height);
+	if (m_tile_count > 0)
+	{
+		*width = m_tile_count * m_tile_size * m_scale.x;
+		*height = m_tile_count * m_tile_size * m_scale.z;
+		return;
+	}
+	int shared_pixel = m_is_tile ? 1 : 0;
+	*width = (m_width - shared_pixel) * m_scale.x;
+	*height = (m_height - shared_pixel) * m_scale.z;
+}
+
+
+Matrix Terrain::getMatrix() const
+{
+	Matrix matrix = m_scene.getUniverse().getMatrix(m_entity);
+	matrix.setTranslation(matrix.multiplyPosition(m_tile_offset));
+	return matrix;
+}
+
+
+void Terrain::setTileCount(int count)
+{
+	count = Math::clamp(count, 0, MAX_TILE_COUNT);
+	if (count == m_tile_count) return;
+
+	destroyTiles();
+	m_tile_count = count;
+	m_tiles.resize(count * count);
+	for (auto& tile : m_tiles)
+	{
+		tile = nullptr;
+	}
+	// switches between the terrain's own heightmap and the tiles
+	if (m_material && m_material->isReady())
+	{
+		onMaterialLoaded(Resource::State::READY, Resource::State::READY);
+	}
+}
+
+
+void Terrain::setTileSize(int size)
+{
+	size = Math::maxValue(1, size);
+	if (size == m_tile_size) return;
+	// tiles are placed by their size, the streaming recreates them
+	destroyTiles();
+	m_tile_size = size;
+}
+
+
+Terrain* Terrain::getTile(int x, int z) const
+{
+	if (x < 0 || z < 0 || x >= m_tile_count || z >= m_tile_count) return nullptr;
+	return m_tiles[x + z * m_tile_count];
+}
+
+
+Terrain* Terrain::getTileAt(float& x, float& z) const
+{
+	float tile_size = m_tile_size * m_scale.x;
+	int tile_x = (int)floorf(x / tile_size);
+	int tile_z = (int)floorf(z / tile_size);
+	Terrain* tile = getTile(tile_x, tile_z);
+	if (!tile) return nullptr;
+
+	x -= tile_x * tile_size;
+	z -= tile_z * tile_size;
+	return tile;
+}
+
+
+Terrain* Terrain::createTile(int x, int z)
+{
+	// "terrain.mat" has tiles "terrain_0_0.mat", "terrain_1_0.mat", ...
+	char dir[MAX_PATH_LENGTH];
+	char basename[MAX_PATH_LENGTH];
+	PathUtils::getDir(dir, lengthOf(dir), m_material->getPath().c_str());
+	PathUtils::getBasename(basename, lengthOf(basename), m_material->getPath().c_str());
+	char tmp[20];
+	char path[MAX_PATH_LENGTH];
+	copyString(path, dir);
+	catString(path, basename);
+	catString(path, "_");
+	toCString(x, tmp, lengthOf(tmp));
+	catString(path, tmp);
+	catString(path, "_");
+	toCString(z, tmp, lengthOf(tmp));
+	catString(path, tmp);
+	catString(path, ".mat");
+
+	// neighbouring tiles overlap by one pixel, the heightmap of a tile is tile size + 1 pixels
+	// wide and its last row and column repeat the first ones of the next tiles, so both sides
+	// of an edge sample the same heights and there are no cracks
+	Terrain* tile = LUMIX_NEW(m_allocator, Terrain)(m_renderer, m_entity, m_scene, m_allocator);
+	tile->m_is_tile = true;
+	syncTile(*tile, x + z * m_tile_count);
+	auto* material_manager = m_scene.getEngine().getResourceManager().get(ResourceManager::MATERIAL);
+	tile->setMaterial(static_cast<Material*>(material_manager->load(Path(path))));
+	return tile;
+}
+
+
+void Terrain::destroyTiles()
+{
+	for (auto& tile : m_tiles)
+	{
+		LUMIX_DELETE(m_allocator, tile);
+		tile = nullptr;
+	}
+}
+
+
+void Terrain::syncTile(Terrain& tile, int index)
+{
+	// waits for the tile's grass jobs before its settings change
+	tile.forceGrassUpdate();
+	tile.m_tile_offset.set(index % m_tile_count * m_tile_size * m_scale.x,
+		0,
+		index / m_tile_count * m_tile_size * m_scale.z);
+	tile.m_tile_size = m_tile_size;
+	tile.m_scale = m_scale;
+	tile.m_layer_mask = m_layer_mask;
+	tile.m_grass_distance = m_grass_distance;
+	tile.invalidateInfoCaches();
+
+	while (tile.m_grass_types.size() > m_grass_types.size())
+	{
+		tile.removeGrassType(tile.m_grass_types.size() - 1);
+	}
+	while (tile.m_grass_types.size() < m_grass_types.size())
+	{
+		tile.addGrassType(-1);
+	}
+	for (int i = 0; i < m_grass_types.size(); ++i)
+	{
+		tile.m_grass_types[i]->m_ground = m_grass_types[i]->m_ground;
+		tile.m_grass_types[i]->m_density = m_grass_types[i]->m_density;
+		Path path = getGrassTypePath(i);
+		if (!(tile.getGrassTypePath(i) == path)) tile.setGrassTypePath(i, path);
+	}
+}
+
+
+void Terrain::syncTiles()
+{
+	for (int i = 0; i < m_tiles.size(); ++i)
+	{
+		if (m_tiles[i]) syncTile(*m_tiles[i], i);
+	}
+}
+
+
+void Terrain::updateTiles()
+{
+	if (m_tile_count == 0 || !m_has_streaming_center || !m_material) return;
+	PROFILE_FUNCTION();
+
+	float tile_size = m_tile_size * m_scale.x;
+	int streamed_in = 0;
+	for (int z = 0; z < m_tile_count; ++z)
+	{
+		for (int x = 0; x < m_tile_count; ++x)
+		{
+			// distance from the center to the tile's rectangle
+			float dx = Math::maxValue(x * tile_size - m_streaming_center.x,
+				m_streaming_center.x - (x + 1) * tile_size);
+			float dz = Math::maxValue(z * tile_size - m_streaming_center.z,
+				m_streaming_center.z - (z + 1) * tile_size);
+			dx = Math::maxValue(0.0f, dx);
+			dz = Math::maxValue(0.0f, dz);
+			float distance = sqrtf(dx * dx + dz * dz);
+
+			Terrain*& tile = m_tiles[x + z * m_tile_count];
+			if (!tile && distance < m_tile_distance && streamed_in < MAX_TILES_STREAMED_PER_FRAME)
+			{
+				tile = createTile(x, z);
+				++streamed_in;
+			}
+			else if (tile && distance > m_tile_distance * TILE_STREAM_OUT_FACTOR)
+			{
+				LUMIX_DELETE(m_allocator, tile);
+				tile = nullptr;
+			}
+		}
+	}
+}
+
+
+void Terrain::update()
+{
+	updateTiles();
+	for (auto* tile : m_tiles)
+	{
+		if (tile) tile->update();
+	}
+}
+
+
+void Terrain::deserialize(InputBlob& serializer,
+	Universe& universe,
+	RenderScene& scene,
+	int index,
+	bool has_tiles)
 {
 	serializer.read(m_entity);
 	serializer.read(m_layer_mask);
@@ -596,6 +1239,15 @@ void Terrain::deserialize(InputBlob& serializer, Universe& universe, RenderScene
 		serializer.read(m_grass_types[i]->m_density);
 		setGrassTypePath(i, Path(path));
 	}
+	int32 tile_count = 0;
+	if (has_tiles)
+	{
+		serializer.read(tile_count);
+		serializer.read(m_tile_size);
+		serializer.read(m_tile_distance);
+	}
+	destroyTiles();
+	setTileCount(tile_count);
 	universe.addComponent(m_entity, TERRAIN_HASH, &scene, index);
 }
 
@@ -616,26 +1268,96 @@ void Terrain::serialize(OutputBlob& serializer)
 		serializer.write(type.m_ground);
 		serializer.write(type.m_density);
 	}
+	serializer.write(m_tile_count);
+	serializer.write(m_tile_size);
+	serializer.write(m_tile_distance);
 }
 
 
-void Terrain::getInfos(Array<const TerrainInfo*>& infos, const Vec3& camera_pos, LIFOAllocator& allocator)
+void Terrain::invalidateInfoCaches()
 {
+	for (int i = 0; i < m_info_caches.size(); ++i)
+	{
+		m_info_caches.at(i)->is_valid = false;
+	}
+}
+
+
+void Terrain::destroyInfoCache(ComponentIndex camera)
+{
+	for (auto* tile : m_tiles)
+	{
+		if (tile) tile->destroyInfoCache(camera);
+	}
+	int cache_index = m_info_caches.find(camera);
+	if (cache_index < 0) return;
+
+	LUMIX_DELETE(m_allocator, m_info_caches.at(cache_index));
+	m_info_caches.eraseAt(cache_index);
+}
+
+
+void Terrain::getInfos(const Frustum& frustum,
+	Array<const TerrainInfo*>& infos,
+	ComponentIndex camera,
+	const Vec3& camera_pos)
+{
+	if (m_tile_count > 0)
+	{
+		Matrix inv_matrix = getMatrix();
+		inv_matrix.fastInverse();
+		m_streaming_center = inv_matrix.multiplyPosition(camera_pos);
+		m_has_streaming_center = true;
+		for (auto* tile : m_tiles)
+		{
+			if (tile) tile->getInfos(frustum, infos, camera, camera_pos);
+		}
+		return;
+	}
 	if (!m_root) return;
 	if (!m_material || !m_material->isReady()) return;
 
-	Matrix matrix = m_scene.getUniverse().getMatrix(m_entity);
+	Matrix matrix = getMatrix();
 	Matrix inv_matrix = matrix;
 	inv_matrix.fastInverse();
 	Vec3 local_camera_pos = inv_matrix.multiplyPosition(camera_pos);
 	local_camera_pos.x /= m_scale.x;
 	local_camera_pos.z /= m_scale.z;
-	m_root->getInfos(infos, local_camera_pos, this, matrix, allocator);
+
+	int cache_index = m_info_caches.find(camera);
+	if (cache_index < 0)
+	{
+		m_info_caches.insert(camera, LUMIX_NEW(m_allocator, InfoCache)(m_allocator));
+		cache_index = m_info_caches.find(camera);
+	}
+	InfoCache& cache = *m_info_caches.at(cache_index);
+	if (!cache.is_valid ||
+		(cache.local_camera_pos - local_camera_pos).squaredLength() >
+			INFO_CACHE_DISTANCE * INFO_CACHE_DISTANCE ||
+		compareMemory(&cache.world_matrix, &matrix, sizeof(matrix)) != 0)
+	{
+		PROFILE_BLOCK("select terrain patches");
+		cache.infos.clear();
+		m_root->getInfos(cache.infos, local_camera_pos, this, matrix);
+		cache.local_camera_pos = local_camera_pos;
+		cache.world_matrix = matrix;
+		cache.is_valid = true;
+	}
+
+	for (const auto& info : cache.infos)
+	{
+		if (frustum.isSphereInside(info.m_center, info.m_radius)) infos.push(&info);
+	}
 }
 
 
 Vec3 Terrain::getNormal(float x, float z)
 {
+	if (m_tile_count > 0)
+	{
+		Terrain* tile = getTileAt(x, z);
+		return tile ? tile->getNormal(x, z) : Vec3(0, 1, 0);
+	}
 	int int_x = (int)(x / m_scale.x);
 	int int_z = (int)(z / m_scale.x);
 	float dec_x = (x - (int_x * m_scale.x)) / m_scale.x;
@@ -659,6 +1381,11 @@ Vec3 Terrain::getNormal(float x, float z)
 	
 float Terrain::getHeight(float x, float z)
 {
+	if (m_tile_count > 0)
+	{
+		Terrain* tile = getTileAt(x, z);
+		return tile ? tile->getHeight(x, z) : 0;
+	}
 	int int_x = (int)(x / m_scale.x);
 	int int_z = (int)(z / m_scale.x);
 	float dec_x = (x - (int_x * m_scale.x)) / m_scale.x;
@@ -686,25 +1413,204 @@ float Terrain::getHeight(float x, float z)
 
 float Terrain::getHeight(int x, int z)
 {
-	if (!m_heightmap) return 0;
+	HeightmapSampler sampler(m_heightmap);
+	if (!sampler.data) return 0;
+	return m_scale.y * sampler.getNormalized(x, z);
+}
+
 
-	int texture_x = x;
-	int texture_y = z;
-	Texture* t = m_heightmap;
-	int idx = Math::clamp(texture_x, 0, m_width) + Math::clamp(texture_y, 0, m_height) * m_width;
-	if (t->getBytesPerPixel() == 2)
+void Terrain::getHeights(Vec3* points, int count)
+{
+	PROFILE_FUNCTION();
+	if (m_tile_count > 0)
 	{
-		return m_scale.y / 65535.0f * ((uint16*)t->getData())[idx];
+		for (int i = 0; i < count; ++i)
+		{
+			float x = points[i].x;
+			float z = points[i].z;
+			Terrain* tile = getTileAt(x, z);
+			points[i].y = tile ? tile->getHeight(x, z) : 0;
+		}
+		return;
 	}
-	else if(t->getBytesPerPixel() == 4)
+	HeightmapSampler sampler(m_heightmap);
+	if (!sampler.data)
 	{
-		return ((m_scale.y / 255.0f) * ((uint8*)t->getData())[idx * 4]);
+		for (int i = 0; i < count; ++i) points[i].y = 0;
+		return;
 	}
-	else
+
+	float inv_scale = 1 / m_scale.x;
+	for (int i = 0; i < count; ++i)
+	{
+		Vec3& p = points[i];
+		float fx = p.x * inv_scale;
+		float fz = p.z * inv_scale;
+		int int_x = (int)fx;
+		int int_z = (int)fz;
+		float dec_x = fx - int_x;
+		float dec_z = fz - int_z;
+		float h0 = sampler.getNormalized(int_x, int_z);
+		float h;
+		if (dec_x > dec_z)
+		{
+			float h1 = sampler.getNormalized(int_x + 1, int_z);
+			float h2 = sampler.getNormalized(int_x + 1, int_z + 1);
+			h = h0 + (h1 - h0) * dec_x + (h2 - h1) * dec_z;
+		}
+		else
+		{
+			float h1 = sampler.getNormalized(int_x + 1, int_z + 1);
+			float h2 = sampler.getNormalized(int_x, int_z + 1);
+			h = h0 + (h2 - h0) * dec_z + (h1 - h2) * dec_x;
+		}
+		p.y = h * m_scale.y;
+	}
+}
+
+
+Terrain::HeightBounds Terrain::getHeightBounds(int from_x,
+	int from_z,
+	int to_x,
+	int to_z) const
+{
+	HeightBounds bounds = {FLT_MAX, -FLT_MAX};
+	if (m_height_bounds_levels.empty()) return bounds;
+
+	int top_level = m_height_bounds_levels.size() - 1;
+	getHeightBounds(top_level, 0, 0, from_x, from_z, to_x, to_z, bounds);
+	return bounds;
+}
+
+
+void Terrain::getHeightBounds(int level,
+	int x,
+	int z,
+	int from_x,
+	int from_z,
+	int to_x,
+	int to_z,
+	HeightBounds& bounds) const
+{
+	const HeightBoundsLevel& info = m_height_bounds_levels[level];
+	if (x >= info.width || z >= info.height) return;
+
+	int cell_min_x = x << level;
+	int cell_min_z = z << level;
+	int cell_max_x = (x + 1) << level;
+	int cell_max_z = (z + 1) << level;
+	if (cell_min_x >= to_x || cell_min_z >= to_z || cell_max_x <= from_x || cell_max_z <= from_z)
+	{
+		return;
+	}
+
+	if (level == 0 ||
+		(cell_min_x >= from_x && cell_min_z >= from_z && cell_max_x <= to_x && cell_max_z <= to_z))
+	{
+		const HeightBounds& node = m_height_bounds[info.offset + x + z * info.width];
+		bounds.min = Math::minValue(bounds.min, node.min);
+		bounds.max = Math::maxValue(bounds.max, node.max);
+		return;
+	}
+
+	for (int k = 0; k < 4; ++k)
+	{
+		getHeightBounds(
+			level - 1, x * 2 + (k & 1), z * 2 + (k >> 1), from_x, from_z, to_x, to_z, bounds);
+	}
+}
+
+
+void Terrain::buildHeightBounds()
+{
+	PROFILE_FUNCTION();
+	m_height_bounds.clear();
+	m_height_bounds_levels.clear();
+	if (!m_heightmap || !m_heightmap->getData() || m_width < 2 || m_height < 2) return;
+
+	int width = m_width - 1;
+	int height = m_height - 1;
+	int offset = 0;
+	for (;;)
 	{
-		ASSERT(false);
+		HeightBoundsLevel& level = m_height_bounds_levels.pushEmpty();
+		level.offset = offset;
+		level.width = width;
+		level.height = height;
+		offset += width * height;
+		if (width == 1 && height == 1) break;
+		width = (width + 1) >> 1;
+		height = (height + 1) >> 1;
 	}
-	return 0;
+	m_height_bounds.resize(offset);
+	updateHeightBounds(0, 0, m_width, m_height);
+}
+
+
+void Terrain::updateHeightBounds(int x, int z, int width, int height)
+{
+	PROFILE_FUNCTION();
+	if (m_height_bounds_levels.empty()) return;
+	HeightmapSampler sampler(m_heightmap);
+	if (!sampler.data) return;
+
+	// a pixel is a corner of up to four cells
+	const HeightBoundsLevel& base = m_height_bounds_levels[0];
+	int from_x = Math::maxValue(0, x - 1);
+	int from_z = Math::maxValue(0, z - 1);
+	int to_x = Math::minValue(base.width - 1, x + width - 1);
+	int to_z = Math::minValue(base.height - 1, z + height - 1);
+	for (int j = from_z; j <= to_z; ++j)
+	{
+		for (int i = from_x; i <= to_x; ++i)
+		{
+			float h0 = sampler.getNormalized(i, j);
+			float h1 = sampler.getNormalized(i + 1, j);
+			float h2 = sampler.getNormalized(i, j + 1);
+			float h3 = sampler.getNormalized(i + 1, j + 1);
+			HeightBounds& bounds = m_height_bounds[base.offset + i + j * base.width];
+			bounds.min = Math::minValue(Math::minValue(h0, h1), Math::minValue(h2, h3));
+			bounds.max = Math::maxValue(Math::maxValue(h0, h1), Math::maxValue(h2, h3));
+		}
+	}
+
+	for (int level_idx = 1; level_idx < m_height_bounds_levels.size(); ++level_idx)
+	{
+		const HeightBoundsLevel& child = m_height_bounds_levels[level_idx - 1];
+		const HeightBoundsLevel& level = m_height_bounds_levels[level_idx];
+		from_x >>= 1;
+		from_z >>= 1;
+		to_x >>= 1;
+		to_z >>= 1;
+		for (int j = from_z; j <= to_z; ++j)
+		{
+			for (int i = from_x; i <= to_x; ++i)
+			{
+				HeightBounds bounds = {FLT_MAX, -FLT_MAX};
+				for (int k = 0; k < 4; ++k)
+				{
+					int child_x = i * 2 + (k & 1);
+					int child_z = j * 2 + (k >> 1);
+					if (child_x >= child.width || child_z >= child.height) continue;
+					const HeightBounds& child_bounds =
+						m_height_bounds[child.offset + child_x + child_z * child.width];
+					bounds.min = Math::minValue(bounds.min, child_bounds.min);
+					bounds.max = Math::maxValue(bounds.max, child_bounds.max);
+				}
+				m_height_bounds[level.offset + i + j * level.width] = bounds;
+			}
+		}
+	}
+
+	if (m_root)
+	{
+		m_root->updateHeightBounds(*this,
+			Math::maxValue(0, x - 1),
+			Math::maxValue(0, z - 1),
+			x + width,
+			z + height);
+	}
+	invalidateInfoCaches();
 }
 
 
@@ -750,72 +1656,116 @@ bool getRayTriangleIntersection(const Vec3& local_origin, const Vec3& local_dir,
 }
 
 
-RayCastModelHit Terrain::castRay(const Vec3& origin, const Vec3& dir)
+// nearest hit in the node, children are visited front to back and skipped when they can not
+// be nearer than the hit found so far
+bool Terrain::castRayHeightBounds(int level,
+	int x,
+	int z,
+	const Vec3& origin,
+	const Vec3& dir,
+	float& out_t)
 {
-	RayCastModelHit hit;
-	hit.m_is_hit = false;
-	if (m_root)
+	if (level == 0)
 	{
-		Matrix mtx = m_scene.getUniverse().getMatrix(m_entity);
-		mtx.fastInverse();
-		Vec3 rel_origin = mtx.multiplyPosition(origin);
-		Vec3 rel_dir = mtx * Vec4(dir, 0);
-		Vec3 start;
-		Vec3 size(m_root->m_size * m_scale.x, m_scale.y * 65535.0f, m_root->m_size * m_scale.x);
-		if (Math::getRayAABBIntersection(rel_origin, rel_dir, m_root->m_min, size, start))
+		float px = x * m_scale.x;
+		float pz = z * m_scale.x;
+		Vec3 p0(px, getHeight(x, z), pz);
+		Vec3 p1(px + m_scale.x, getHeight(x + 1, z), pz);
+		Vec3 p2(px + m_scale.x, getHeight(x + 1, z + 1), pz + m_scale.x);
+		Vec3 p3(px, getHeight(x, z + 1), pz + m_scale.x);
+		float t;
+		bool is_hit = false;
+		if (getRayTriangleIntersection(origin, dir, p0, p1, p2, t) && t < out_t)
 		{
-			int hx = (int)(start.x / m_scale.x);
-			int hz = (int)(start.z / m_scale.x);
+			out_t = t;
+			is_hit = true;
+		}
+		if (getRayTriangleIntersection(origin, dir, p0, p2, p3, t) && t < out_t)
+		{
+			out_t = t;
+			is_hit = true;
+		}
+		return is_hit;
+	}
 
-			float next_x = fabs(rel_dir.x) < 0.01f ? hx : ((hx + (rel_dir.x < 0 ? 0 : 1)) * m_scale.x - rel_origin.x) / rel_dir.x;
-			float next_z = fabs(rel_dir.z) < 0.01f ? hx : ((hz + (rel_dir.z < 0 ? 0 : 1)) * m_scale.x - rel_origin.z) / rel_dir.z;
+	const HeightBoundsLevel& child_level = m_height_bounds_levels[level - 1];
+	float child_size = (1 << (level - 1)) * m_scale.x;
+	int children[4];
+	float children_t[4];
+	int child_count = 0;
+	for (int k = 0; k < 4; ++k)
+	{
+		int child_x = x * 2 + (k & 1);
+		int child_z = z * 2 + (k >> 1);
+		if (child_x >= child_level.width || child_z >= child_level.height) continue;
+
+		const HeightBounds& bounds =
+			m_height_bounds[child_level.offset + child_x + child_z * child_level.width];
+		Vec3 min(child_x * child_size, bounds.min * m_scale.y, child_z * child_size);
+		Vec3 max = min + Vec3(child_size, (bounds.max - bounds.min) * m_scale.y, child_size);
+		float t;
+		if (!getRayAABBDistance(origin, dir, min, max, t) || t > out_t) continue;
+
+		int idx = child_count;
+		while (idx > 0 && children_t[idx - 1] > t)
+		{
+			children[idx] = children[idx - 1];
+			children_t[idx] = children_t[idx - 1];
+			--idx;
+		}
+		children[idx] = k;
+		children_t[idx] = t;
+		++child_count;
+	}
 
-			float delta_x = fabs(rel_dir.x) < 0.01f ? 0 : m_scale.x / Math::abs(rel_dir.x);
-			float delta_z = fabs(rel_dir.z) < 0.01f ? 0 : m_scale.x / Math::abs(rel_dir.z);
-			int step_x = (int)Math::signum(rel_dir.x);
-			int step_z = (int)Math::signum(rel_dir.z);
+	bool is_hit = false;
+	for (int i = 0; i < child_count; ++i)
+	{
+		if (children_t[i] > out_t) break;
+		int k = children[i];
+		is_hit |= castRayHeightBounds(level - 1, x * 2 + (k & 1), z * 2 + (k >> 1), origin, dir, out_t);
+	}
+	return is_hit;
+}
 
-			while (hx >= 0 && hz >= 0 && hx + 1 < m_width && hz + 1 < m_height)
-			{
-				float t;
-				float x = hx * m_scale.x;
-				float z = hz * m_scale.x;
-				Vec3 p0(x, getHeight(x, z), z);
-				Vec3 p1(x + m_scale.x, getHeight(x + m_scale.x, z), z);
-				Vec3 p2(x + m_scale.x, getHeight(x + m_scale.x, z + m_scale.x), z + m_scale.x);
-				Vec3 p3(x, getHeight(x, z + m_scale.x), z + m_scale.x);
-				if (getRayTriangleIntersection(rel_origin, rel_dir, p0, p1, p2, t))
-				{
-					hit.m_is_hit = true;
-					hit.m_origin = origin;
-					hit.m_dir = dir;
-					hit.m_t = t;
-					return hit;
-				}
-				if (getRayTriangleIntersection(rel_origin, rel_dir, p0, p2, p3, t))
-				{
-					hit.m_is_hit = true;
-					hit.m_origin = origin;
-					hit.m_dir = dir;
-					hit.m_t = t;
-					return hit;
-				}
-				if (next_x < next_z)
-				{
-					next_x += delta_x;
-					hx += step_x;
-				}
-				else
-				{
-					next_z += delta_z;
-					hz += step_z;
-				}
-				if (delta_x == 0 && delta_z == 0)
-				{
-					return hit;
-				}
-			}
+
+RayCastModelHit Terrain::castRay(const Vec3& origin, const Vec3& dir)
+{
+	PROFILE_FUNCTION();
+	RayCastModelHit hit;
+	hit.m_is_hit = false;
+	if (m_tile_count > 0)
+	{
+		for (auto* tile : m_tiles)
+		{
+			if (!tile) continue;
+			RayCastModelHit tile_hit = tile->castRay(origin, dir);
+			if (tile_hit.m_is_hit && (!hit.m_is_hit || tile_hit.m_t < hit.m_t)) hit = tile_hit;
 		}
+		return hit;
+	}
+	if (!m_root || m_height_bounds_levels.empty()) return hit;
+
+	Matrix mtx = getMatrix();
+	mtx.fastInverse();
+	Vec3 rel_origin = mtx.multiplyPosition(origin);
+	Vec3 rel_dir = mtx * Vec4(dir, 0);
+
+	int top_level = m_height_bounds_levels.size() - 1;
+	const HeightBounds& bounds = m_height_bounds[m_height_bounds_levels[top_level].offset];
+	float size = (1 << top_level) * m_scale.x;
+	Vec3 min(0, bounds.min * m_scale.y, 0);
+	Vec3 max(size, bounds.max * m_scale.y, size);
+	float t = FLT_MAX;
+	if (!getRayAABBDistance(rel_origin, rel_dir, min, max, t)) return hit;
+
+	t = FLT_MAX;
+	if (castRayHeightBounds(top_level, 0, 0, rel_origin, rel_dir, t))
+	{
+		hit.m_is_hit = true;
+		hit.m_origin = origin;
+		hit.m_dir = dir;
+		hit.m_t = t;
 	}
 	return hit;
 }
@@ -897,6 +1847,19 @@ TerrainQuad* Terrain::generateQuadTree(float size)
 void Terrain::onMaterialLoaded(Resource::State, Resource::State new_state)
 {
 	PROFILE_FUNCTION();
+	waitForGrassJobs();
+	invalidateInfoCaches();
+	if (m_tile_count > 0)
+	{
+		// the material only names the tiles, their materials have the heightmaps
+		LUMIX_DELETE(m_allocator, m_root);
+		m_root = nullptr;
+		m_heightmap = nullptr;
+		m_splatmap = nullptr;
+		m_height_bounds.clear();
+		m_height_bounds_levels.clear();
+		return;
+	}
 	if (new_state == Resource::State::READY)
 	{
 		m_detail_texture = m_material->getTextureByUniform(TEX_COLOR_UNIFORM);
@@ -929,14 +1892,22 @@ void Terrain::onMaterialLoaded(Resource::State, Resource::State new_state)
 			{
 				m_width = m_heightmap->getWidth();
 				m_height = m_heightmap->getHeight();
-				m_root = generateQuadTree((float)m_width);
+				if (m_is_tile && (m_width != m_tile_size + 1 || m_height != m_tile_size + 1))
+				{
+					g_log_warning.log("renderer") << "Heightmap " << m_heightmap->getPath().c_str()
+						<< " of a terrain tile should be " << m_tile_size + 1 << " pixels wide";
+				}
+				m_root = generateQuadTree((float)(m_is_tile ? m_width - 1 : m_width));
 			}
+			buildHeightBounds();
 		}
 	}
 	else
 	{
 		LUMIX_DELETE(m_allocator, m_root);
 		m_root = nullptr;
+		m_height_bounds.clear();
+		m_height_bounds_levels.clear();
 	}
 }
 
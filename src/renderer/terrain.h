@@ -4,6 +4,7 @@
 #include "core/array.h"
 #include "core/associative_array.h"
 #include "core/matrix.h"
+#include "core/mtjd/group.h"
 #include "core/resource.h"
 #include "core/vec.h"
 #include "renderer/render_scene.h"
@@ -14,7 +15,6 @@ namespace Lumix
 {
 
 
-class LIFOAllocator;
 class Material;
 class Mesh;
 class OutputBlob;
@@ -28,6 +28,20 @@ class Texture;
 class Terrain
 {
 	public:
+		// heights are normalized to [0, 1], scaled by m_scale.y when used
+		struct HeightBounds
+		{
+			float min;
+			float max;
+		};
+
+		struct HeightBoundsLevel
+		{
+			int offset;
+			int width;
+			int height;
+		};
+
 		class GrassType
 		{
 			public:
@@ -47,22 +61,41 @@ class Terrain
 			public:
 				GrassPatch(IAllocator& allocator)
 					: m_matrices(allocator)
+					, m_instance_buffer(BGFX_INVALID_HANDLE)
 				{ }
 
+				// in random order, so any prefix is an evenly thinned out patch
 				Array<Matrix> m_matrices;
+				// created from m_matrices when the patch is shown, see destroyGrassPatches
+				bgfx::VertexBufferHandle m_instance_buffer;
 				GrassType* m_type;
 		};
 
 		class GrassQuad
 		{
 			public:
+				enum class State : int32
+				{
+					READY,
+					QUEUED,
+					GENERATING,
+					GENERATED
+				};
+
 				GrassQuad(IAllocator& allocator)
 					: m_patches(allocator)
+					, m_generated_patches(allocator)
+					, m_state((int32)State::READY)
 				{}
 
+				// drawn until the job's m_generated_patches replace them
 				Array<GrassPatch> m_patches;
+				Array<GrassPatch> m_generated_patches;
 				Vec3 pos;
 				float radius;
+				float generated_y;
+				float generated_radius;
+				volatile int32 m_state;
 		};
 
 	public:
@@ -79,45 +112,126 @@ class Terrain
 		float getRootSize() const;
 		Vec3 getNormal(float x, float z);
 		float getHeight(float x, float z);
+		// sets y of each point to the height at its x, z
+		void getHeights(Vec3* points, int count);
 		float getXZScale() const { return m_scale.x; }
 		float getYScale() const { return m_scale.y; }
 		Mesh* getMesh() { return m_mesh; }
 		Path getGrassTypePath(int index);
 		Vec3 getScale() const { return m_scale; }
-		void getSize(float* width, float* height) const { ASSERT(width); ASSERT(height); *width = m_width * m_scale.x; *height = m_height * m_scale.z; }
+		void getSize(float* width, float* height) const;
 		int getGrassTypeGround(int index);
 		int getGrassTypeDensity(int index);
 		int getGrassTypeCount() const { return m_grass_types.size(); }
 		int getGrassDistance() const { return m_grass_distance; }
+		// tiles per side, 0 if the terrain is not tiled
+		int getTileCount() const { return m_tile_count; }
+		// heightmap cells per tile side, tile heightmaps are one pixel larger, see createTile
+		int getTileSize() const { return m_tile_size; }
+		float getTileDistance() const { return m_tile_distance; }
+		// null if the tile is not streamed in
+		Terrain* getTile(int x, int z) const;
+		Texture* getHeightmap() const { return m_heightmap; }
 
-		void setXZScale(float scale) { m_scale.x = scale; m_scale.z = scale; }
-		void setYScale(float scale) { m_scale.y = scale; }
+		void setXZScale(float scale);
+		void setYScale(float scale);
 		void setGrassTypePath(int index, const Path& path);
 		void setGrassTypeGround(int index, int ground);
 		void setGrassTypeDensity(int index, int density);
-		void setGrassDistance(int value) { m_grass_distance = value; forceGrassUpdate(); }
+		void setGrassDistance(int value);
 		void setMaterial(Material* material);
+		void setTileCount(int count);
+		void setTileSize(int size);
+		void setTileDistance(float distance) { m_tile_distance = distance; }
 
-		void getInfos(Array<const TerrainInfo*>& infos, const Vec3& camera_pos, LIFOAllocator& allocator);
+		void getInfos(const Frustum& frustum,
+			Array<const TerrainInfo*>& infos,
+			ComponentIndex camera,
+			const Vec3& camera_pos);
 		void getGrassInfos(const Frustum& frustum, Array<GrassInfo>& infos, ComponentIndex camera);
 
 		RayCastModelHit castRay(const Vec3& origin, const Vec3& dir);
 		void serialize(OutputBlob& serializer);
-		void deserialize(InputBlob& serializer, Universe& universe, RenderScene& scene, int index);
+		void deserialize(InputBlob& serializer,
+			Universe& universe,
+			RenderScene& scene,
+			int index,
+			bool has_tiles);
 
 		void addGrassType(int index);
 		void removeGrassType(int index);
 		void forceGrassUpdate();
+		// x, z, width and height are in heightmap pixels
+		void updateHeightBounds(int x, int z, int width, int height);
+		// bounds of cells [from_x, to_x) x [from_z, to_z), min > max if there are none
+		HeightBounds getHeightBounds(int from_x, int from_z, int to_x, int to_z) const;
+		void invalidateInfoCaches();
+		// frees the patches selected for a camera which is being destroyed
+		void destroyInfoCache(ComponentIndex camera);
+		// streams tiles around the last camera, called once per frame
+		void update();
+
+	private:
+		// patches selected by distance, reused until the camera moves far enough
+		struct InfoCache
+		{
+			InfoCache(IAllocator& allocator)
+				: infos(allocator)
+				, is_valid(false)
+			{
+			}
+
+			Array<TerrainInfo> infos;
+			Vec3 local_camera_pos;
+			Matrix world_matrix;
+			bool is_valid;
+		};
+
+		friend struct TerrainQuad;
 
 	private: 
 		Array<Terrain::GrassQuad*>& getQuads(ComponentIndex camera);
+		// world matrix of the entity moved to m_tile_offset
+		Matrix getMatrix() const;
+		// the resident tile containing local x, z, which are then made relative to the tile
+		Terrain* getTileAt(float& x, float& z) const;
+		Terrain* createTile(int x, int z);
+		void destroyTiles();
+		void syncTile(Terrain& tile, int index);
+		void syncTiles();
+		void updateTiles();
 		TerrainQuad* generateQuadTree(float size);
 		float getHeight(int x, int z);
+		void buildHeightBounds();
+		void getHeightBounds(int level,
+			int x,
+			int z,
+			int from_x,
+			int from_z,
+			int to_x,
+			int to_z,
+			HeightBounds& bounds) const;
+		bool castRayHeightBounds(int level,
+			int x,
+			int z,
+			const Vec3& origin,
+			const Vec3& dir,
+			float& out_t);
 		void updateGrass(ComponentIndex camera);
+		void finishGrassQuads(Array<GrassQuad*>& quads);
+		void scheduleGrassQuads(Array<GrassQuad*>& quads,
+			const Vec3& local_camera_pos,
+			const Matrix& terrain_matrix);
+		void retireGrassQuad(GrassQuad* quad);
+		void destroyGrassPatches(Array<GrassPatch>& patches);
+		void destroyGrassQuad(GrassQuad* quad);
+		void waitForGrassJobs();
+		void generateGrassQuad(GrassQuad& quad, const Matrix& terrain_matrix);
 		void generateGrassTypeQuad(GrassPatch& patch,
 								   const Matrix& terrain_matrix,
 								   float quad_x,
-								   float quad_z);
+								   float quad_z,
+								   uint32 seed);
 		void generateGeometry();
 		void onMaterialLoaded(Resource::State, Resource::State new_state);
 
@@ -125,6 +239,8 @@ class Terrain
 		IAllocator& m_allocator;
 		bgfx::VertexBufferHandle m_vertices_handle;
 		bgfx::IndexBufferHandle m_indices_handle;
+		// one matrix per vertex, the same layout as bgfx instance data
+		bgfx::VertexDecl m_grass_instance_decl;
 		Mesh* m_mesh;
 		TerrainQuad* m_root;
 		int32 m_width;
@@ -137,11 +253,30 @@ class Terrain
 		Texture* m_heightmap;
 		Texture* m_splatmap;
 		Texture* m_detail_texture;
+		// resident tiles are terrains with their own material, quadtree and grass
+		Array<Terrain*> m_tiles;
+		int32 m_tile_count;
+		int32 m_tile_size;
+		float m_tile_distance;
+		// position of a tile in its parent's space
+		Vec3 m_tile_offset;
+		// tiles cover one heightmap pixel less than their width, the last one is shared
+		bool m_is_tile;
+		// parent's space camera position tiles are streamed around
+		Vec3 m_streaming_center;
+		bool m_has_streaming_center;
+		// min/max pyramid over heightmap cells, level 0 has one item per cell, the last has one
+		Array<HeightBounds> m_height_bounds;
+		Array<HeightBoundsLevel> m_height_bounds_levels;
 		RenderScene& m_scene;
 		Array<GrassType*> m_grass_types;
 		Array<GrassQuad*> m_free_grass_quads;
+		// out of range but still generating, freed when their job is done
+		Array<GrassQuad*> m_retired_grass_quads;
+		MTJD::Group m_grass_sync_point;
 		AssociativeArray<ComponentIndex, Array<GrassQuad*> > m_grass_quads;
 		AssociativeArray<ComponentIndex, Vec3> m_last_camera_position;
+		AssociativeArray<ComponentIndex, InfoCache*> m_info_caches;
 		bool m_force_grass_update;
 		Renderer& m_renderer;
 };
@@ -0,0 +1,272 @@
+#include "terrain_brush.h"
+#include "core/binary_array.h"
+#include "core/math_utils.h"
+#include "core/mtjd/generic_job.h"
+#include "core/mtjd/group.h"
+#include "core/mtjd/manager.h"
+#include "core/profiler.h"
+#include "core/simd.h"
+#include <cmath>
+
+
+namespace Lumix
+{
+
+
+static const int MAX_BANDS = 16;
+static const int MIN_PIXELS_PER_BAND = 16384;
+
+
+// dx and dz are relative to the pixel center
+static float getAttenuation(const TerrainBrush::Stamp& stamp, float dx, float dz)
+{
+	float dist = sqrtf(dx * dx + dz * dz);
+	return 1.0f - Math::minValue(dist / stamp.radius, 1.0f);
+}
+
+
+static bool isMasked(const BinaryArray* mask, float x, float y)
+{
+	if (!mask || mask->size() == 0) return true;
+
+	int s = int(sqrt(mask->size()));
+	int ix = int(x * s);
+	int iy = int(y * s);
+
+	return (*mask)[int(ix + x * iy)];
+}
+
+
+TerrainBrush::TerrainBrush(MTJD::Manager* manager, IAllocator& allocator)
+	: m_manager(manager)
+	, m_allocator(allocator)
+{
+}
+
+
+template <typename T> void TerrainBrush::runBands(const Stamp& stamp, T function)
+{
+	int rows = stamp.to_z - stamp.from_z;
+	int pixels = rows * (stamp.to_x - stamp.from_x);
+	int band_count = 1;
+	if (m_manager)
+	{
+		band_count = Math::minValue((int)m_manager->getCpuThreadsCount(), pixels / MIN_PIXELS_PER_BAND);
+		band_count = Math::minValue(band_count, MAX_BANDS);
+	}
+	if (band_count <= 1)
+	{
+		function(0, stamp.from_z, stamp.to_z);
+		return;
+	}
+
+	MTJD::Group sync_point(true, m_allocator);
+	MTJD::Job* jobs[MAX_BANDS];
+	int job_count = 0;
+	int step = (rows + band_count - 1) / band_count;
+	for (int from = stamp.from_z; from < stamp.to_z; from += step)
+	{
+		int band = job_count;
+		int to = Math::minValue(stamp.to_z, from + step);
+		jobs[job_count] = MTJD::makeJob(*m_manager,
+			[function, band, from, to]()
+			{
+				PROFILE_BLOCK("terrain brush band");
+				function(band, from, to);
+			},
+			m_allocator);
+		jobs[job_count]->addDependency(&sync_point);
+		++job_count;
+	}
+	for (int i = 0; i < job_count; ++i)
+	{
+		m_manager->schedule(jobs[i]);
+	}
+	sync_point.sync();
+}
+
+
+void TerrainBrush::addHeight(uint16* heights, int width, const Stamp& stamp, float amount)
+{
+	PROFILE_FUNCTION();
+	runBands(stamp,
+		[heights, width, &stamp, amount](int, int from_z, int to_z)
+		{
+			for (int j = from_z; j < to_z; ++j)
+			{
+				float dz = stamp.z - 0.5f - j;
+				uint16* row = heights + j * width;
+				for (int i = stamp.from_x; i < stamp.to_x; ++i)
+				{
+					int add = int(getAttenuation(stamp, stamp.x - 0.5f - i, dz) * amount);
+					row[i] = uint16(Math::clamp(row[i] + add, 0, 0xffff));
+				}
+			}
+		});
+}
+
+
+void TerrainBrush::smoothHeight(uint16* heights, int width, const Stamp& stamp)
+{
+	PROFILE_FUNCTION();
+	if (stamp.from_x >= stamp.to_x || stamp.from_z >= stamp.to_z) return;
+
+	uint64 sums[MAX_BANDS] = {};
+	runBands(stamp,
+		[heights, width, &stamp, &sums](int band, int from_z, int to_z)
+		{
+			uint64 sum = 0;
+			for (int j = from_z; j < to_z; ++j)
+			{
+				const uint16* row = heights + j * width;
+				for (int i = stamp.from_x; i < stamp.to_x; ++i)
+				{
+					sum += row[i];
+				}
+			}
+			sums[band] = sum;
+		});
+	uint64 sum = 0;
+	for (auto band_sum : sums)
+	{
+		sum += band_sum;
+	}
+	int count = (stamp.to_x - stamp.from_x) * (stamp.to_z - stamp.from_z);
+	float avg = float(uint16(sum / count));
+
+	runBands(stamp,
+		[heights, width, &stamp, avg](int, int from_z, int to_z)
+		{
+			float4 center_x = f4Splat(stamp.x - 0.5f);
+			float4 radius = f4Splat(stamp.radius);
+			float4 one = f4Splat(1);
+			float4 avg4 = f4Splat(avg);
+			float4 amount = f4Splat(stamp.amount);
+			for (int j = from_z; j < to_z; ++j)
+			{
+				float dz = stamp.z - 0.5f - j;
+				float4 dz2 = f4Splat(dz * dz);
+				uint16* row = heights + j * width;
+				int i = stamp.from_x;
+				for (; i + 4 <= stamp.to_x; i += 4)
+				{
+					float4 dx = f4Sub(center_x, f4Set(float(i), float(i + 1), float(i + 2), float(i + 3)));
+					float4 dist = f4Sqrt(f4Add(f4Mul(dx, dx), dz2));
+					float4 attenuation = f4Sub(one, f4Min(f4Div(dist, radius), one));
+					int4 height = i4LoadU16(row + i);
+					float4 delta = f4Mul(f4Mul(f4Sub(avg4, i4ToFloat4(height)), amount), attenuation);
+					i4StoreU16(row + i, i4Add(height, f4ToInt4(delta)));
+				}
+				for (; i < stamp.to_x; ++i)
+				{
+					float attenuation = getAttenuation(stamp, stamp.x - 0.5f - i, dz);
+					row[i] = uint16(row[i] + int((avg - row[i]) * stamp.amount * attenuation));
+				}
+			}
+		});
+}
+
+
+void TerrainBrush::flattenHeight(uint16* heights, int width, const Stamp& stamp, uint16 height)
+{
+	PROFILE_FUNCTION();
+	runBands(stamp,
+		[heights, width, &stamp, height](int, int from_z, int to_z)
+		{
+			int4 value = i4SplatU16(height);
+			for (int j = from_z; j < to_z; ++j)
+			{
+				uint16* row = heights + j * width;
+				int i = stamp.from_x;
+				for (; i + 8 <= stamp.to_x; i += 8)
+				{
+					i4StoreUnaligned(row + i, value);
+				}
+				for (; i < stamp.to_x; ++i)
+				{
+					row[i] = height;
+				}
+			}
+		});
+}
+
+
+void TerrainBrush::paintColor(uint8* colors,
+	int width,
+	const Stamp& stamp,
+	const Vec3& color,
+	const BinaryArray* mask)
+{
+	PROFILE_FUNCTION();
+	if (stamp.from_x >= stamp.to_x || stamp.from_z >= stamp.to_z) return;
+
+	float step_x = 1.0f / (stamp.to_x - stamp.from_x);
+	float step_z = 1.0f / (stamp.to_z - stamp.from_z);
+	runBands(stamp,
+		[colors, width, &stamp, &color, mask, step_x, step_z](int, int from_z, int to_z)
+		{
+			for (int j = from_z; j < to_z; ++j)
+			{
+				float dz = stamp.z - 0.5f - j;
+				float fz = (j - stamp.from_z) * step_z;
+				for (int i = stamp.from_x; i < stamp.to_x; ++i)
+				{
+					if (!isMasked(mask, (i - stamp.from_x) * step_x, fz)) continue;
+
+					float attenuation = getAttenuation(stamp, stamp.x - 0.5f - i, dz);
+					uint8* d = &colors[4 * (i + j * width)];
+					d[0] = uint8(d[0] + int((color.x * 255 - d[0]) * attenuation));
+					d[1] = uint8(d[1] + int((color.y * 255 - d[1]) * attenuation));
+					d[2] = uint8(d[2] + int((color.z * 255 - d[2]) * attenuation));
+					d[3] = 255;
+				}
+			}
+		});
+}
+
+
+void TerrainBrush::paintLayer(uint8* splatmap,
+	int width,
+	const Stamp& stamp,
+	uint8 layer,
+	const BinaryArray* mask)
+{
+	PROFILE_FUNCTION();
+	if (stamp.from_x >= stamp.to_x || stamp.from_z >= stamp.to_z) return;
+
+	float step_x = 1.0f / (stamp.to_x - stamp.from_x);
+	float step_z = 1.0f / (stamp.to_z - stamp.from_z);
+	runBands(stamp,
+		[splatmap, width, &stamp, layer, mask, step_x, step_z](int, int from_z, int to_z)
+		{
+			for (int j = from_z; j < to_z; ++j)
+			{
+				float dz = stamp.z - 0.5f - j;
+				float fz = (j - stamp.from_z) * step_z;
+				for (int i = stamp.from_x; i < stamp.to_x; ++i)
+				{
+					if (!isMasked(mask, (i - stamp.from_x) * step_x, fz)) continue;
+
+					float attenuation = getAttenuation(stamp, stamp.x - 0.5f - i, dz);
+					int add = int(attenuation * stamp.amount * 255);
+					if (add <= 0) continue;
+
+					uint8* d = &splatmap[4 * (i + j * width)];
+					if (d[0] == layer)
+					{
+						d[1] += Math::minValue(255 - d[1], add);
+					}
+					else
+					{
+						d[1] = add;
+					}
+					d[0] = layer;
+					d[2] = 0;
+					d[3] = 255;
+				}
+			}
+		});
+}
+
+
+} // namespace Lumix
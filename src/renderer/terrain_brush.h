@@ -0,0 +1,71 @@
+#pragma once
+
+
+#include "lumix.h"
+#include "core/vec.h"
+
+
+namespace Lumix
+{
+
+
+class BinaryArray;
+class IAllocator;
+namespace MTJD
+{
+class Manager;
+}
+
+
+// Rasterizes terrain editor brush stamps into heightmap, splatmap and colormap pixels.
+// Big stamps are split into row bands processed by MTJD workers, each call returns after
+// all its pixels are written. Positions are in pixels of the modified texture.
+class LUMIX_RENDERER_API TerrainBrush
+{
+public:
+	struct Stamp
+	{
+		float x;
+		float z;
+		float radius;
+		float amount;
+		// pixels covered by the stamp, already clipped to the texture
+		int from_x;
+		int from_z;
+		int to_x;
+		int to_z;
+	};
+
+public:
+	// manager can be null, everything then runs on the calling thread
+	TerrainBrush(MTJD::Manager* manager, IAllocator& allocator);
+
+	// adds amount * attenuation, negative amount lowers the terrain
+	void addHeight(uint16* heights, int width, const Stamp& stamp, float amount);
+	// moves heights towards the average height under the stamp
+	void smoothHeight(uint16* heights, int width, const Stamp& stamp);
+	void flattenHeight(uint16* heights, int width, const Stamp& stamp, uint16 height);
+	// RGBA8 pixels, mask can be null
+	void paintColor(uint8* colors,
+		int width,
+		const Stamp& stamp,
+		const Vec3& color,
+		const BinaryArray* mask);
+	// splatmap pixels, the first byte is the layer index and the second one its weight
+	void paintLayer(uint8* splatmap,
+		int width,
+		const Stamp& stamp,
+		uint8 layer,
+		const BinaryArray* mask);
+
+private:
+	// function(band, from_z, to_z) is called for disjoint row ranges covering the stamp
+	template <typename T> void runBands(const Stamp& stamp, T function);
+
+private:
+	MTJD::Manager* m_manager;
+	IAllocator& m_allocator;
+};
+
+
+} // namespace Lumix
@@ -18,10 +18,13 @@
 #include "metadata.h"
 #include "physics/physics_geometry_manager.h"
 #include "platform_interface.h"
+#include "renderer/mesh_optimizer.h"
+#include "renderer/mesh_simplifier.h"
 #include "renderer/model.h"
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb/stb_image.h"
 #include "utils.h"
+#include <cmath>
 
 
 typedef StringBuilder<Lumix::MAX_PATH_LENGTH> PathBuilder;
@@ -292,6 +295,114 @@ struct ImportTextureTask : public Lumix::MT::Task
 }; // struct ImportTextureTask
 
 
+// FIFO size the import report measures, typical for current GPUs
+static const int VERTEX_CACHE_SIZE = 16;
+
+
+template <typename T>
+static void remapVertices(T*& vertices, const Lumix::Array<int>& remap, int vertex_count)
+{
+	if (!vertices) return;
+
+	T* remapped = new T[vertex_count];
+	for (int i = 0; i < remap.size(); ++i)
+	{
+		if (remap[i] >= 0) remapped[remap[i]] = vertices[i];
+	}
+	delete[] vertices;
+	vertices = remapped;
+}
+
+
+// reorders triangles for the post-transform cache and vertices in the order of first use,
+// unused vertices are dropped; returns false if the mesh is left untouched
+static bool optimizeMesh(aiMesh& mesh,
+	bool optimize_overdraw,
+	Lumix::IAllocator& allocator,
+	float& acmr_before,
+	float& acmr_after)
+{
+	if (mesh.mNumFaces == 0 || mesh.mNumAnimMeshes > 0) return false;
+
+	Lumix::Array<int> indices(allocator);
+	indices.resize(mesh.mNumFaces * 3);
+	for (unsigned int i = 0; i < mesh.mNumFaces; ++i)
+	{
+		const aiFace& face = mesh.mFaces[i];
+		if (face.mNumIndices != 3) return false;
+		indices[i * 3] = face.mIndices[0];
+		indices[i * 3 + 1] = face.mIndices[1];
+		indices[i * 3 + 2] = face.mIndices[2];
+	}
+
+	int vertex_count = mesh.mNumVertices;
+	acmr_before = Lumix::computeACMR(
+		indices.begin(), indices.size(), vertex_count, VERTEX_CACHE_SIZE, allocator);
+
+	Lumix::Array<int> optimized(allocator);
+	optimized.resize(indices.size());
+	Lumix::optimizeVertexCache(
+		indices.begin(), indices.size(), vertex_count, optimized.begin(), allocator);
+	if (optimize_overdraw)
+	{
+		Lumix::Array<Lumix::Vec3> positions(allocator);
+		positions.resize(vertex_count);
+		for (int i = 0; i < vertex_count; ++i)
+		{
+			const aiVector3D& v = mesh.mVertices[i];
+			positions[i].set(v.x, v.y, v.z);
+		}
+		Lumix::optimizeOverdraw(
+			optimized.begin(), optimized.size(), positions.begin(), vertex_count, allocator);
+	}
+	acmr_after = Lumix::computeACMR(
+		optimized.begin(), optimized.size(), vertex_count, VERTEX_CACHE_SIZE, allocator);
+
+	Lumix::Array<int> remap(allocator);
+	remap.resize(vertex_count);
+	int used_count =
+		Lumix::optimizeVertexFetch(optimized.begin(), optimized.size(), vertex_count, remap.begin());
+
+	remapVertices(mesh.mVertices, remap, used_count);
+	remapVertices(mesh.mNormals, remap, used_count);
+	remapVertices(mesh.mTangents, remap, used_count);
+	remapVertices(mesh.mBitangents, remap, used_count);
+	for (int i = 0; i < AI_MAX_NUMBER_OF_TEXTURECOORDS; ++i)
+	{
+		remapVertices(mesh.mTextureCoords[i], remap, used_count);
+	}
+	for (int i = 0; i < AI_MAX_NUMBER_OF_COLOR_SETS; ++i)
+	{
+		remapVertices(mesh.mColors[i], remap, used_count);
+	}
+	mesh.mNumVertices = used_count;
+
+	for (unsigned int i = 0; i < mesh.mNumBones; ++i)
+	{
+		aiBone& bone = *mesh.mBones[i];
+		unsigned int weight_count = 0;
+		for (unsigned int j = 0; j < bone.mNumWeights; ++j)
+		{
+			int vertex = remap[bone.mWeights[j].mVertexId];
+			if (vertex < 0) continue;
+			bone.mWeights[weight_count].mVertexId = vertex;
+			bone.mWeights[weight_count].mWeight = bone.mWeights[j].mWeight;
+			++weight_count;
+		}
+		bone.mNumWeights = weight_count;
+	}
+
+	for (unsigned int i = 0; i < mesh.mNumFaces; ++i)
+	{
+		aiFace& face = mesh.mFaces[i];
+		face.mIndices[0] = optimized[i * 3];
+		face.mIndices[1] = optimized[i * 3 + 1];
+		face.mIndices[2] = optimized[i * 3 + 2];
+	}
+	return true;
+}
+
+
 struct ImportTask : public Lumix::MT::Task
 {
 	struct ProgressHandler : public Assimp::ProgressHandler
@@ -324,6 +435,7 @@ struct ImportTask : public Lumix::MT::Task
 	int task() override
 	{
 		m_progress_handler.m_task = this;
+		m_dialog.m_acmr_before = m_dialog.m_acmr_after = 0;
 		Lumix::enableFloatingPointTraps(false);
 		m_dialog.m_importer.SetPropertyInteger(
 			AI_CONFIG_PP_RVC_FLAGS, aiComponent_LIGHTS | aiComponent_CAMERAS);
@@ -343,6 +455,7 @@ struct ImportTask : public Lumix::MT::Task
 		}
 		else
 		{
+			if (m_dialog.m_optimize_vertex_cache) optimizeMeshes(*scene);
 			m_dialog.m_mesh_mask.resize(scene->mNumMeshes);
 			for (int i = 0; i < m_dialog.m_mesh_mask.size(); ++i)
 			{
@@ -356,6 +469,34 @@ struct ImportTask : public Lumix::MT::Task
 	}
 
 
+	void optimizeMeshes(const aiScene& scene)
+	{
+		m_dialog.setImportMessage("Optimizing meshes...");
+		auto& allocator = m_dialog.m_editor.getAllocator();
+		float misses_before = 0;
+		float misses_after = 0;
+		int triangle_count = 0;
+		for (unsigned int i = 0; i < scene.mNumMeshes; ++i)
+		{
+			aiMesh& mesh = *scene.mMeshes[i];
+			float acmr_before, acmr_after;
+			if (!optimizeMesh(mesh, m_dialog.m_optimize_overdraw, allocator, acmr_before, acmr_after))
+			{
+				continue;
+			}
+			misses_before += acmr_before * mesh.mNumFaces;
+			misses_after += acmr_after * mesh.mNumFaces;
+			triangle_count += mesh.mNumFaces;
+		}
+		if (triangle_count == 0) return;
+
+		m_dialog.m_acmr_before = misses_before / triangle_count;
+		m_dialog.m_acmr_after = misses_after / triangle_count;
+		Lumix::g_log_info.log("import") << "Vertex cache ACMR " << m_dialog.m_acmr_before << " -> "
+										<< m_dialog.m_acmr_after;
+	}
+
+
 	ImportAssetDialog& m_dialog;
 	ProgressHandler m_progress_handler;
 
@@ -382,6 +523,7 @@ struct ConvertTask : public Lumix::MT::Task
 		: Task(dialog.m_editor.getAllocator())
 		, m_dialog(dialog)
 		, m_filtered_meshes(dialog.m_editor.getAllocator())
+		, m_generated_lod_count(0)
 	{
 	}
 
@@ -902,12 +1044,7 @@ struct ConvertTask : public Lumix::MT::Task
 	void writeMeshes(Lumix::FS::IFile& file) const
 	{
 		const aiScene* scene = m_dialog.m_importer.GetScene();
-		Lumix::int32 mesh_count = 0;
-		for (int i = 0; i < m_dialog.m_mesh_mask.size(); ++i)
-		{
-			if (m_dialog.m_mesh_mask[i]) ++mesh_count;
-		}
-
+		Lumix::int32 mesh_count = m_filtered_meshes.size();
 		file.write((const char*)&mesh_count, sizeof(mesh_count));
 		Lumix::int32 attribute_array_offset = 0;
 		Lumix::int32 indices_offset = 0;
@@ -1007,6 +1144,12 @@ struct ConvertTask : public Lumix::MT::Task
 
 	void writeLods(Lumix::FS::IFile& file) const
 	{
+		if (m_generated_lod_count > 0)
+		{
+			writeGeneratedLods(file);
+			return;
+		}
+
 		Lumix::int32 lods[] = { -1, -1, -1, -1, -1, -1, -1, -1 };
 		Lumix::int32 lod_count = -1;
 		float factors[8];
@@ -1042,6 +1185,198 @@ struct ConvertTask : public Lumix::MT::Task
 	}
 
 
+	// LOD n uses triangle_ratio^n of the triangles, screen area falls with squared distance,
+	// so the switch distance grows with 1 / sqrt(triangle_ratio) per LOD. LOD0 is drawn up to
+	// 10 bounding radii, the written distances are squared like in Model::getLODIndex
+	void writeGeneratedLods(Lumix::FS::IFile& file) const
+	{
+		static const float LOD0_DISTANCE_IN_RADII = 10;
+
+		Lumix::int32 lod_count = m_generated_lod_count + 1;
+		int mesh_count = m_filtered_meshes.size() / lod_count;
+		float radius_squared = 0;
+		for (int i = 0; i < mesh_count; ++i)
+		{
+			const aiMesh* mesh = m_filtered_meshes[i];
+			for (unsigned int j = 0; j < mesh->mNumVertices; ++j)
+			{
+				radius_squared = Lumix::Math::maxValue(radius_squared, mesh->mVertices[j].SquareLength());
+			}
+		}
+
+		file.write((const char*)&lod_count, sizeof(lod_count));
+		float distance_squared = LOD0_DISTANCE_IN_RADII * LOD0_DISTANCE_IN_RADII * radius_squared;
+		for (int i = 0; i < lod_count; ++i)
+		{
+			Lumix::int32 to_mesh = (i + 1) * mesh_count - 1;
+			file.write((const char*)&to_mesh, sizeof(to_mesh));
+			float distance = i == lod_count - 1 ? FLT_MAX : distance_squared;
+			file.write((const char*)&distance, sizeof(distance));
+			distance_squared /= m_dialog.m_lod_triangle_ratio;
+		}
+	}
+
+
+	// artists' LODs (meshes named *_LOD<n>) take precedence, otherwise every mesh gets
+	// simplified copies appended after the source meshes, one block per LOD
+	void generateLods()
+	{
+		m_generated_lod_count = 0;
+		int lod_count = (int)(m_dialog.m_lod_count + 0.5f);
+		if (!m_dialog.m_create_lods || lod_count <= 0) return;
+		for (int i = 0; i < m_filtered_meshes.size(); ++i)
+		{
+			if (getMeshLOD(&m_filtered_meshes[i]) >= 0) return;
+		}
+
+		int mesh_count = m_filtered_meshes.size();
+		for (int lod = 1; lod <= lod_count; ++lod)
+		{
+			m_dialog.setImportMessage(StringBuilder<50>("Generating LOD ", lod, "..."));
+			float ratio = powf(m_dialog.m_lod_triangle_ratio, (float)lod);
+			for (int i = 0; i < mesh_count; ++i)
+			{
+				m_filtered_meshes.push(createLodMesh(*m_filtered_meshes[i], ratio, lod));
+			}
+		}
+		m_generated_lod_count = lod_count;
+	}
+
+
+	void destroyGeneratedLods()
+	{
+		if (m_generated_lod_count == 0) return;
+
+		int mesh_count = m_filtered_meshes.size() / (m_generated_lod_count + 1);
+		for (int i = mesh_count; i < m_filtered_meshes.size(); ++i)
+		{
+			delete m_filtered_meshes[i];
+		}
+		m_filtered_meshes.resize(mesh_count);
+		m_generated_lod_count = 0;
+	}
+
+
+	aiMesh* createLodMesh(const aiMesh& src, float triangle_ratio, int lod) const
+	{
+		auto& allocator = m_dialog.m_editor.getAllocator();
+		Lumix::Array<Lumix::Vec3> positions(allocator);
+		positions.resize(src.mNumVertices);
+		for (unsigned int i = 0; i < src.mNumVertices; ++i)
+		{
+			positions[i].set(src.mVertices[i].x, src.mVertices[i].y, src.mVertices[i].z);
+		}
+		Lumix::Array<int> indices(allocator);
+		for (unsigned int i = 0; i < src.mNumFaces; ++i)
+		{
+			indices.push(src.mFaces[i].mIndices[0]);
+			indices.push(src.mFaces[i].mIndices[1]);
+			indices.push(src.mFaces[i].mIndices[2]);
+		}
+
+		Lumix::Array<int> lod_indices(allocator);
+		lod_indices.resize(indices.size());
+		int target_count = Lumix::Math::maxValue(3, int(indices.size() * triangle_ratio) / 3 * 3);
+		int count = Lumix::simplifyMesh(positions.begin(),
+			positions.size(),
+			indices.begin(),
+			indices.size(),
+			target_count,
+			lod_indices.begin(),
+			allocator);
+
+		// keep only the vertices the simplified triangles use
+		Lumix::Array<int> remap(allocator);
+		Lumix::Array<int> used_vertices(allocator);
+		remap.resize(src.mNumVertices);
+		for (int& i : remap) i = -1;
+		for (int i = 0; i < count; ++i)
+		{
+			int& vertex = lod_indices[i];
+			if (remap[vertex] < 0)
+			{
+				remap[vertex] = used_vertices.size();
+				used_vertices.push(vertex);
+			}
+			vertex = remap[vertex];
+		}
+
+		aiMesh* mesh = new aiMesh;
+		mesh->mPrimitiveTypes = aiPrimitiveType_TRIANGLE;
+		mesh->mMaterialIndex = src.mMaterialIndex;
+		mesh->mName = getMeshName(&src);
+		mesh->mName.Append(StringBuilder<20>("_LOD", lod));
+
+		int vertex_count = used_vertices.size();
+		mesh->mNumVertices = vertex_count;
+		mesh->mVertices = new aiVector3D[vertex_count];
+		if (src.HasNormals()) mesh->mNormals = new aiVector3D[vertex_count];
+		if (src.HasTextureCoords(0))
+		{
+			mesh->mTextureCoords[0] = new aiVector3D[vertex_count];
+			mesh->mNumUVComponents[0] = src.mNumUVComponents[0];
+		}
+		if (src.mTangents) mesh->mTangents = new aiVector3D[vertex_count];
+		if (src.mColors[0]) mesh->mColors[0] = new aiColor4D[vertex_count];
+		for (int i = 0; i < vertex_count; ++i)
+		{
+			int src_vertex = used_vertices[i];
+			mesh->mVertices[i] = src.mVertices[src_vertex];
+			if (src.HasNormals()) mesh->mNormals[i] = src.mNormals[src_vertex];
+			if (src.HasTextureCoords(0)) mesh->mTextureCoords[0][i] = src.mTextureCoords[0][src_vertex];
+			if (src.mTangents) mesh->mTangents[i] = src.mTangents[src_vertex];
+			if (src.mColors[0]) mesh->mColors[0][i] = src.mColors[0][src_vertex];
+		}
+
+		mesh->mNumFaces = count / 3;
+		mesh->mFaces = new aiFace[mesh->mNumFaces];
+		for (unsigned int i = 0; i < mesh->mNumFaces; ++i)
+		{
+			aiFace& face = mesh->mFaces[i];
+			face.mNumIndices = 3;
+			face.mIndices = new unsigned int[3];
+			face.mIndices[0] = lod_indices[i * 3];
+			face.mIndices[1] = lod_indices[i * 3 + 1];
+			face.mIndices[2] = lod_indices[i * 3 + 2];
+		}
+
+		if (src.mNumBones > 0)
+		{
+			mesh->mNumBones = src.mNumBones;
+			mesh->mBones = new aiBone*[src.mNumBones];
+			for (unsigned int i = 0; i < src.mNumBones; ++i)
+			{
+				const aiBone& src_bone = *src.mBones[i];
+				aiBone* bone = new aiBone;
+				bone->mName = src_bone.mName;
+				bone->mOffsetMatrix = src_bone.mOffsetMatrix;
+				for (unsigned int j = 0; j < src_bone.mNumWeights; ++j)
+				{
+					if (remap[src_bone.mWeights[j].mVertexId] >= 0) ++bone->mNumWeights;
+				}
+				bone->mWeights = new aiVertexWeight[bone->mNumWeights];
+				int weight_index = 0;
+				for (unsigned int j = 0; j < src_bone.mNumWeights; ++j)
+				{
+					const aiVertexWeight& weight = src_bone.mWeights[j];
+					if (remap[weight.mVertexId] < 0) continue;
+					bone->mWeights[weight_index].mVertexId = remap[weight.mVertexId];
+					bone->mWeights[weight_index].mWeight = weight.mWeight;
+					++weight_index;
+				}
+				mesh->mBones[i] = bone;
+			}
+		}
+
+		if (m_dialog.m_optimize_vertex_cache)
+		{
+			float acmr_before, acmr_after;
+			optimizeMesh(*mesh, m_dialog.m_optimize_overdraw, allocator, acmr_before, acmr_after);
+		}
+		return mesh;
+	}
+
+
 	void writeSkeleton(Lumix::FS::IFile& file) const
 	{
 		const aiScene* scene = m_dialog.m_importer.GetScene();
@@ -1275,6 +1610,7 @@ struct ConvertTask : public Lumix::MT::Task
 		}
 
 		filterMeshes();
+		generateLods();
 
 		writeModelHeader(*file);
 		writeMeshes(*file);
@@ -1282,11 +1618,13 @@ struct ConvertTask : public Lumix::MT::Task
 		writeSkeleton(*file);
 		writeLods(*file);
 
+		destroyGeneratedLods();
 		fs.close(*file);
 		return true;
 	}
 
 	Lumix::Array<aiMesh*> m_filtered_meshes;
+	int m_generated_lod_count;
 	ImportAssetDialog& m_dialog;
 
 }; // struct ConvertTask
@@ -1304,6 +1642,13 @@ ImportAssetDialog::ImportAssetDialog(Lumix::WorldEditor& editor, Metadata& metad
 	, m_is_importing_texture(false)
 	, m_mutex(false)
 	, m_make_convex(false)
+	, m_create_lods(false)
+	, m_optimize_vertex_cache(true)
+	, m_optimize_overdraw(false)
+	, m_acmr_before(0)
+	, m_acmr_after(0)
+	, m_lod_count(3)
+	, m_lod_triangle_ratio(0.5f)
 	, m_saved_textures(editor.getAllocator())
 	, m_saved_embedded_textures(editor.getAllocator())
 	, m_path_mapping(editor.getAllocator())
@@ -1583,6 +1928,12 @@ void ImportAssetDialog::onGUI()
 		if (m_gui->checkbox("Optimize meshes", &m_optimize_mesh_on_import)) checkSource();
 		m_gui->sameLine();
 		if (m_gui->checkbox("Smooth normals", &m_gen_smooth_normal)) checkSource();
+		if (m_gui->checkbox("Optimize vertex cache", &m_optimize_vertex_cache)) checkSource();
+		if (m_optimize_vertex_cache)
+		{
+			m_gui->sameLine();
+			if (m_gui->checkbox("Optimize overdraw", &m_optimize_overdraw)) checkSource();
+		}
 
 		if (m_gui->inputText("Source", m_source, sizeof(m_source))) checkSource();
 
@@ -1627,6 +1978,13 @@ void ImportAssetDialog::onGUI()
 		{
 			auto* scene = m_importer.GetScene();
 			m_gui->checkbox("Import model", &m_import_model);
+			if (m_acmr_before > 0)
+			{
+				m_gui->text(StringBuilder<100>("Vertex cache misses per triangle: ",
+					m_acmr_before,
+					" -> ",
+					m_acmr_after));
+			}
 
 			if (scene->HasMaterials())
 			{
@@ -1649,6 +2007,12 @@ void ImportAssetDialog::onGUI()
 				m_gui->sameLine();
 				m_gui->checkbox("Make convex", &m_make_convex);
 			}
+			m_gui->checkbox("Generate LODs", &m_create_lods);
+			if (m_create_lods)
+			{
+				m_gui->sliderFloat("LOD count", &m_lod_count, 1, 4, "%.0f");
+				m_gui->sliderFloat("LOD triangle ratio", &m_lod_triangle_ratio, 0.1f, 0.9f);
+			}
 
 			if (scene->mNumMeshes > 1)
 			{
@@ -79,6 +79,13 @@ class ImportAssetDialog
 		bool m_is_importing;
 		bool m_make_convex;
 		bool m_is_importing_texture;
+		bool m_create_lods;
+		bool m_optimize_vertex_cache;
+		bool m_optimize_overdraw;
+		float m_acmr_before;
+		float m_acmr_after;
+		float m_lod_count;
+		float m_lod_triangle_ratio;
 		float m_raw_texture_scale;
 		Lumix::MT::Task* m_task;
 		Lumix::MT::SpinMutex m_mutex;
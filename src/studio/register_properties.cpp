@@ -560,6 +560,25 @@ void registerRendererProperties(Lumix::WorldEditor& editor)
 		&RenderScene::getGrassDistance,
 		&RenderScene::setGrassDistance,
 		allocator));
+	auto tile_count = LUMIX_NEW(allocator, IntPropertyDescriptor<RenderScene>)("Tiles",
+		&RenderScene::getTerrainTileCount,
+		&RenderScene::setTerrainTileCount,
+		allocator);
+	tile_count->setLimit(0, 64);
+	PropertyRegister::add("terrain", tile_count);
+	PropertyRegister::add("terrain",
+		LUMIX_NEW(allocator, IntPropertyDescriptor<RenderScene>)("Tile size",
+		&RenderScene::getTerrainTileSize,
+		&RenderScene::setTerrainTileSize,
+		allocator));
+	PropertyRegister::add("terrain",
+		LUMIX_NEW(allocator, DecimalPropertyDescriptor<RenderScene>)("Tile distance",
+		&RenderScene::getTerrainTileDistance,
+		&RenderScene::setTerrainTileDistance,
+		0.0f,
+		FLT_MAX,
+		1.0f,
+		allocator));
 
 	auto grass = LUMIX_NEW(allocator, ArrayDescriptor<RenderScene>)("Grass",
 		&RenderScene::getGrassCount,
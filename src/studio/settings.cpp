@@ -100,6 +100,7 @@ Settings::Settings(Lumix::IAllocator& allocator)
 	m_is_crash_reporting_enabled = true;
 
 	m_autosave_time = 300;
+	m_terrain_undo_memory = 256;
 
 	m_state = luaL_newstate();
 	luaL_openlibs(m_state);
@@ -158,6 +159,7 @@ bool Settings::load(Action** actions, int actions_count)
 	m_is_crash_reporting_enabled = getBoolean(L, "error_reporting_enabled", true);
 	Lumix::enableCrashReporting(m_is_crash_reporting_enabled);
 	m_autosave_time = getInteger(L, "autosave_time", 300);
+	m_terrain_undo_memory = getInteger(L, "terrain_undo_memory", 256);
 
 	if (lua_getglobal(L, "actions") == LUA_TTABLE)
 	{
@@ -255,6 +257,7 @@ bool Settings::save(Action** actions, int actions_count)
 	writeBool("clip_manager_opened", m_is_clip_manager_opened);
 	writeBool("error_reporting_enabled", m_is_crash_reporting_enabled);
 	file << "autosave_time = " << m_autosave_time << "\n";
+	file << "terrain_undo_memory = " << m_terrain_undo_memory << "\n";
 
 	file << "custom = {\n";
 	lua_getglobal(m_state, "custom");
@@ -334,6 +337,7 @@ void Settings::onGUI(Action** actions, int actions_count)
 		m_gui->text("Settings are saved when the application closes");
 
 		ImGui::DragInt("Autosave time (seconds)", &m_autosave_time);
+		ImGui::DragInt("Terrain undo memory (MB)", &m_terrain_undo_memory, 1, 1, 4096);
 		if (m_gui->checkbox("Crash reporting", &m_is_crash_reporting_enabled))
 		{
 			Lumix::enableCrashReporting(m_is_crash_reporting_enabled);
@@ -42,6 +42,8 @@ struct Settings
 	bool m_is_clip_manager_opened;
 
 	int m_autosave_time;
+	// megabytes of terrain undo data kept before the oldest strokes are forgotten
+	int m_terrain_undo_memory;
 
 	Settings(Lumix::IAllocator& allocator);
 	~Settings();
@@ -1,8 +1,10 @@
 #include "terrain_editor.h"
 #include "core/blob.h"
 #include "core/crc32.h"
+#include "core/delta_rle.h"
 #include "core/frustum.h"
 #include "core/json_serializer.h"
+#include "core/log.h"
 #include "core/profiler.h"
 #include "core/resource_manager.h"
 #include "core/resource_manager_base.h"
@@ -12,11 +14,14 @@
 #include "editor/property_register.h"
 #include "engine.h"
 #include "gui_interface.h"
+#include "physics/physics_scene.h"
 #include "platform_interface.h"
 #include "renderer/material.h"
 #include "renderer/model.h"
 #include "renderer/render_scene.h"
+#include "renderer/terrain_brush.h"
 #include "renderer/texture.h"
+#include "settings.h"
 #include "stb/stb_image.h"
 #include "universe/universe.h"
 #include "utils.h"
@@ -25,6 +30,7 @@
 
 static const Lumix::uint32 RENDERABLE_HASH = Lumix::crc32("renderable");
 static const Lumix::uint32 TERRAIN_HASH = Lumix::crc32("terrain");
+static const Lumix::uint32 HEIGHTFIELD_HASH = Lumix::crc32("physical_heightfield");
 static const char* HEIGHTMAP_UNIFORM = "u_texHeightmap";
 static const char* SPLATMAP_UNIFORM = "u_texSplatmap";
 static const char* COLORMAP_UNIFORM = "u_texColormap";
@@ -155,7 +161,7 @@ struct PaintEntitiesCommand : public Lumix::IEditorCommand
 
 		Lumix::Array<Lumix::RenderableMesh> meshes(m_world_editor.getAllocator());
 		meshes.clear();
-		scene->getRenderableInfos(frustum, meshes, ~0);
+		scene->getRenderableInfos(frustum, meshes, ~0, frustum.getPosition(), 1);
 
 		float w, h;
 		scene->getTerrainSize(m_component.index, &w, &h);
@@ -514,6 +520,10 @@ struct RemoveEntitiesCommand : public Lumix::IEditorCommand
 
 struct PaintTerrainCommand : public Lumix::IEditorCommand
 {
+	// undo data is kept per tile of the destination texture, only for tiles a stroke touches
+	static const int TILE_SIZE = 64;
+
+
 	struct Rectangle
 	{
 		int m_from_x;
@@ -523,17 +533,27 @@ struct PaintTerrainCommand : public Lumix::IEditorCommand
 	};
 
 
+	// commands created this way, e.g. when a recorded session is replayed, are not tracked
+	// in any history, so their undo data is not limited
 	PaintTerrainCommand(Lumix::WorldEditor& editor)
 		: m_world_editor(editor)
-		, m_new_data(editor.getAllocator())
-		, m_old_data(editor.getAllocator())
+		, m_history(nullptr)
+		, m_tiles(editor.getAllocator())
+		, m_buffer(editor.getAllocator())
 		, m_items(editor.getAllocator())
 		, m_mask(editor.getAllocator())
+		, m_has_dirty_tiles(false)
+		, m_is_undo_dropped(false)
+		, m_memory(0)
+		, m_prev(nullptr)
+		, m_next(nullptr)
+		, m_is_in_history(false)
 	{
 	}
 
 
 	PaintTerrainCommand(Lumix::WorldEditor& editor,
+		PaintTerrainHistory& history,
 		TerrainEditor::Type type,
 		int texture_idx,
 		const Lumix::Vec3& hit_pos,
@@ -545,15 +565,22 @@ struct PaintTerrainCommand : public Lumix::IEditorCommand
 		Lumix::ComponentUID terrain,
 		bool can_be_merged)
 		: m_world_editor(editor)
+		, m_history(&history)
 		, m_terrain(terrain)
 		, m_can_be_merged(can_be_merged)
-		, m_new_data(editor.getAllocator())
-		, m_old_data(editor.getAllocator())
+		, m_tiles(editor.getAllocator())
+		, m_buffer(editor.getAllocator())
 		, m_items(editor.getAllocator())
 		, m_type(type)
 		, m_texture_idx(texture_idx)
 		, m_mask(editor.getAllocator())
 		, m_flat_height(flat_height)
+		, m_has_dirty_tiles(false)
+		, m_is_undo_dropped(false)
+		, m_memory(0)
+		, m_prev(nullptr)
+		, m_next(nullptr)
+		, m_is_in_history(false)
 	{
 		m_mask.resize(mask.size());
 		for (int i = 0; i < mask.size(); ++i)
@@ -561,7 +588,6 @@ struct PaintTerrainCommand : public Lumix::IEditorCommand
 			m_mask[i] = mask[i];
 		}
 
-		m_width = m_height = m_x = m_y = -1;
 		Lumix::Matrix entity_mtx =
 			editor.getUniverse()->getMatrix(terrain.entity);
 		entity_mtx.fastInverse();
@@ -579,6 +605,12 @@ struct PaintTerrainCommand : public Lumix::IEditorCommand
 	}
 
 
+	~PaintTerrainCommand()
+	{
+		removeFromHistory();
+	}
+
+
 	void serialize(Lumix::JsonSerializer& serializer) override
 	{
 		serializer.serialize("type", (int)m_type);
@@ -641,17 +673,25 @@ struct PaintTerrainCommand : public Lumix::IEditorCommand
 
 	bool execute() override
 	{
-		if (m_new_data.empty())
+		auto* texture = getDestinationTexture();
+		if (m_tiles.empty() && !m_is_undo_dropped)
+		{
+			for (auto& item : m_items)
+			{
+				rasterItem(texture, item);
+			}
+		}
+		if (m_has_dirty_tiles)
 		{
-			saveOldData();
-			generateNewData();
+			storeDirtyTiles(texture);
+			return true;
 		}
-		applyData(m_new_data);
+		applyTiles(texture, false);
 		return true;
 	}
 
 
-	void undo() override { applyData(m_old_data); }
+	void undo() override { applyTiles(getDestinationTexture(), true); }
 
 
 	Lumix::uint32 getType() override
@@ -670,17 +710,24 @@ struct PaintTerrainCommand : public Lumix::IEditorCommand
 		PaintTerrainCommand& my_command =
 			static_cast<PaintTerrainCommand&>(command);
 		if (m_terrain == my_command.m_terrain && m_type == my_command.m_type &&
-			m_texture_idx == my_command.m_texture_idx)
+			m_texture_idx == my_command.m_texture_idx && !my_command.m_is_undo_dropped)
 		{
+			// the editor executes my_command right after this, which stores the touched tiles
 			my_command.m_items.push(m_items.back());
-			my_command.resizeData();
-			my_command.rasterItem(
-				getDestinationTexture(), my_command.m_new_data, m_items.back());
+			my_command.rasterItem(getDestinationTexture(), m_items.back());
 			return true;
 		}
 		return false;
 	}
 
+
+	// the history is destroyed before the undo stack, the command keeps its data
+	void detachFromHistory()
+	{
+		removeFromHistory();
+		m_history = nullptr;
+	}
+
 private:
 	struct Item
 	{
@@ -700,6 +747,25 @@ private:
 		Lumix::Vec3 m_color;
 	};
 
+
+	struct Tile
+	{
+		explicit Tile(Lumix::IAllocator& allocator)
+			: old_data(allocator)
+			, new_data(allocator)
+			, is_dirty(false)
+		{
+		}
+
+		int x;
+		int y;
+		// delta RLE compressed pixels, see compressDeltaRLE
+		Lumix::Array<Lumix::uint8> old_data;
+		Lumix::Array<Lumix::uint8> new_data;
+		// modified since the last execute
+		bool is_dirty;
+	};
+
 private:
 	Lumix::Material* getMaterial()
 	{
@@ -733,386 +799,290 @@ private:
 	}
 
 
-	Lumix::uint16 computeAverage16(const Lumix::Texture* texture,
-							  int from_x,
-							  int to_x,
-							  int from_y,
-							  int to_y)
+	void rasterItem(Lumix::Texture* texture, Item& item)
 	{
-		ASSERT(texture->getBytesPerPixel() == 2);
-		Lumix::uint32 sum = 0;
-		int texture_width = texture->getWidth();
-		for (int i = from_x, end = to_x; i < end; ++i)
-		{
-			for (int j = from_y, end2 = to_y; j < end2; ++j)
-			{
-				sum += ((Lumix::uint16*)texture->getData())[(i + j * texture_width)];
-			}
-		}
-		return Lumix::uint16(sum / (to_x - from_x) / (to_y - from_y));
-	}
-
-
-	float getAttenuation(Item& item, int i, int j) const
-	{
-		float dist = sqrt(
-			(item.m_local_pos.x - 0.5f - i) * (item.m_local_pos.x - 0.5f - i) +
-			(item.m_local_pos.z - 0.5f - j) * (item.m_local_pos.z - 0.5f - j));
-		return 1.0f - Lumix::Math::minValue(dist / item.m_radius, 1.0f);
-	}
-
-
-	void rasterColorItem(Lumix::Texture* texture,
-						 Lumix::Array<Lumix::uint8>& data,
-						 Item& item)
-	{
-		int texture_width = texture->getWidth();
-		Rectangle r =
-			item.getBoundingRectangle(texture_width, texture->getHeight());
-
-		if (texture->getBytesPerPixel() != 4)
+		bool is_height = m_type != TerrainEditor::COLOR && m_type != TerrainEditor::LAYER;
+		if (texture->getBytesPerPixel() != (is_height ? 2 : 4))
 		{
 			ASSERT(false);
 			return;
 		}
-		float fx = 0;
-		float fstepx = 1.0f / (r.m_to_x - r.m_from_x);
-		float fstepy = 1.0f / (r.m_to_y - r.m_from_y);
-		for (int i = r.m_from_x, end = r.m_to_x; i < end; ++i, fx += fstepx)
+
+		int width = texture->getWidth();
+		Rectangle rect = item.getBoundingRectangle(width, texture->getHeight());
+		touchTiles(texture, rect);
+
+		Lumix::TerrainBrush::Stamp stamp;
+		stamp.x = item.m_local_pos.x;
+		stamp.z = item.m_local_pos.z;
+		stamp.radius = item.m_radius;
+		stamp.amount = item.m_amount;
+		stamp.from_x = rect.m_from_x;
+		stamp.from_z = rect.m_from_y;
+		stamp.to_x = rect.m_to_x;
+		stamp.to_z = rect.m_to_y;
+
+		Lumix::TerrainBrush brush(
+			&m_world_editor.getEngine().getMTJDManager(), m_world_editor.getAllocator());
+		auto* heights = (Lumix::uint16*)texture->getData();
+		switch (m_type)
 		{
-			float fy = 0;
-			for (int j = r.m_from_y, end2 = r.m_to_y; j < end2; ++j, fy += fstepy)
+			case TerrainEditor::COLOR:
+				brush.paintColor(texture->getData(), width, stamp, item.m_color, &m_mask);
+				break;
+			case TerrainEditor::LAYER:
+				brush.paintLayer(
+					texture->getData(), width, stamp, (Lumix::uint8)m_texture_idx, &m_mask);
+				break;
+			case TerrainEditor::SMOOTH_HEIGHT:
+				brush.smoothHeight(heights, width, stamp);
+				break;
+			case TerrainEditor::FLAT_HEIGHT:
+				brush.flattenHeight(heights, width, stamp, m_flat_height);
+				break;
+			default:
 			{
-				if (isMasked(fx, fy))
-				{
-					float attenuation = getAttenuation(item, i, j);
-					int offset = 4 * (i - m_x + (j - m_y) * m_width);
-					Lumix::uint8* d = &data[offset];
-					d[0] += Lumix::uint8((item.m_color.x * 255 - d[0]) * attenuation);
-					d[1] += Lumix::uint8((item.m_color.y * 255 - d[1]) * attenuation);
-					d[2] += Lumix::uint8((item.m_color.z * 255 - d[2]) * attenuation);
-					d[3] = 255;
-				}
+				const float STRENGTH_MULTIPLICATOR = 256.0f;
+				float amount = Lumix::Math::maxValue(
+					item.m_amount * item.m_amount * STRENGTH_MULTIPLICATOR, 1.0f);
+				brush.addHeight(
+					heights, width, stamp, m_type == TerrainEditor::RAISE_HEIGHT ? amount : -amount);
+				break;
 			}
 		}
 	}
 
 
-	bool isMasked(float x, float y)
+	Tile* findTile(int x, int y)
 	{
-		if (m_mask.size() == 0) return true;
-
-		int s = int(sqrt(m_mask.size()));
-		int ix = int(x * s);
-		int iy = int(y * s);
-
-		return m_mask[int(ix + x * iy)];
+		for (auto& tile : m_tiles)
+		{
+			if (tile.x == x && tile.y == y) return &tile;
+		}
+		return nullptr;
 	}
 
 
-	void rasterLayerItem(Lumix::Texture* texture,
-						 Lumix::Array<Lumix::uint8>& data,
-						 Item& item)
+	Rectangle getTileRectangle(Lumix::Texture* texture, const Tile& tile) const
 	{
-		int texture_width = texture->getWidth();
-		Rectangle r =
-			item.getBoundingRectangle(texture_width, texture->getHeight());
-
-		if (texture->getBytesPerPixel() != 4)
-		{
-			ASSERT(false);
-			return;
-		}
-
-		float fx = 0;
-		float fstepx = 1.0f / (r.m_to_x - r.m_from_x);
-		float fstepy = 1.0f / (r.m_to_y - r.m_from_y);
-		for (int i = r.m_from_x, end = r.m_to_x; i < end; ++i, fx += fstepx)
-		{
-			float fy = 0;
-			for (int j = r.m_from_y, end2 = r.m_to_y; j < end2; ++j, fy += fstepy)
-			{
-				if (isMasked(fx, fy))
-				{
-					int offset = 4 * (i - m_x + (j - m_y) * m_width);
-					float attenuation = getAttenuation(item, i, j);
-					int add = int(attenuation * item.m_amount * 255);
-					if (add > 0)
-					{
-						if (data[offset] == m_texture_idx)
-						{
-							data[offset + 1] += Lumix::Math::minValue(255 - data[offset + 1], add);
-						}
-						else
-						{
-							data[offset + 1] = add;
-						}
-						data[offset] = m_texture_idx;
-						data[offset + 2] = 0;
-						data[offset + 3] = 255;
-					}
-				}
-			}
-		}
+		Rectangle rect;
+		rect.m_from_x = tile.x * TILE_SIZE;
+		rect.m_from_y = tile.y * TILE_SIZE;
+		rect.m_to_x = Lumix::Math::minValue(rect.m_from_x + TILE_SIZE, texture->getWidth());
+		rect.m_to_y = Lumix::Math::minValue(rect.m_from_y + TILE_SIZE, texture->getHeight());
+		return rect;
 	}
 
 
-	void rasterSmoothHeightItem(Lumix::Texture* texture, Lumix::Array<Lumix::uint8>& data, Item& item)
+	// must be called before pixels in rect are modified, saves the original content of tiles
+	// touched for the first time
+	void touchTiles(Lumix::Texture* texture, const Rectangle& rect)
 	{
-		ASSERT(texture->getBytesPerPixel() == 2);
-
-		int texture_width = texture->getWidth();
-		Rectangle rect;
-		rect = item.getBoundingRectangle(texture_width, texture->getHeight());
+		if (rect.m_from_x >= rect.m_to_x || rect.m_from_y >= rect.m_to_y) return;
 
-		float avg = computeAverage16(texture, rect.m_from_x, rect.m_to_x, rect.m_from_y, rect.m_to_y);
-		for (int i = rect.m_from_x, end = rect.m_to_x; i < end; ++i)
+		for (int y = rect.m_from_y / TILE_SIZE; y * TILE_SIZE < rect.m_to_y; ++y)
 		{
-			for (int j = rect.m_from_y, end2 = rect.m_to_y; j < end2; ++j)
+			for (int x = rect.m_from_x / TILE_SIZE; x * TILE_SIZE < rect.m_to_x; ++x)
 			{
-				float attenuation = getAttenuation(item, i, j);
-				int offset = i - m_x + (j - m_y) * m_width;
-				Lumix::uint16 x = ((Lumix::uint16*)texture->getData())[(i + j * texture_width)];
-				x += Lumix::uint16((avg - x) * item.m_amount * attenuation);
-				((Lumix::uint16*)&data[0])[offset] = x;
+				Tile* tile = findTile(x, y);
+				if (!tile)
+				{
+					tile = &m_tiles.emplace(m_world_editor.getAllocator());
+					tile->x = x;
+					tile->y = y;
+					readTile(texture, *tile, tile->old_data);
+				}
+				tile->is_dirty = true;
 			}
 		}
+		m_has_dirty_tiles = true;
 	}
 
 
-	void rasterFlatHeightItem(Lumix::Texture* texture, Lumix::Array<Lumix::uint8>& data, Item& item)
+	void readTile(Lumix::Texture* texture, const Tile& tile, Lumix::Array<Lumix::uint8>& data)
 	{
-		ASSERT(texture->getBytesPerPixel() == 2);
-
-		int texture_width = texture->getWidth();
-		Rectangle rect;
-		rect = item.getBoundingRectangle(texture_width, texture->getHeight());
-
-		for (int i = rect.m_from_x, end = rect.m_to_x; i < end; ++i)
+		Rectangle rect = getTileRectangle(texture, tile);
+		int bpp = texture->getBytesPerPixel();
+		int row_size = (rect.m_to_x - rect.m_from_x) * bpp;
+		m_buffer.resize(row_size * (rect.m_to_y - rect.m_from_y));
+		for (int j = rect.m_from_y; j < rect.m_to_y; ++j)
 		{
-			for (int j = rect.m_from_y, end2 = rect.m_to_y; j < end2; ++j)
-			{
-				int offset = i - m_x + (j - m_y) * m_width;
-				((Lumix::uint16*)&data[0])[offset] = m_flat_height;
-			}
+			Lumix::copyMemory(&m_buffer[(j - rect.m_from_y) * row_size],
+				&texture->getData()[(rect.m_from_x + j * texture->getWidth()) * bpp],
+				row_size);
 		}
+		Lumix::compressDeltaRLE(&m_buffer[0], m_buffer.size(), bpp, data);
 	}
 
 
-	void rasterItem(Lumix::Texture* texture, Lumix::Array<Lumix::uint8>& data, Item& item)
+	bool writeTile(Lumix::Texture* texture, const Tile& tile, const Lumix::Array<Lumix::uint8>& data)
 	{
-		if (m_type == TerrainEditor::COLOR)
-		{
-			rasterColorItem(texture, data, item);
-			return;
-		}
-		else if (m_type == TerrainEditor::LAYER)
-		{
-			rasterLayerItem(texture, data, item);
-			return;
-		}
-		else if (m_type == TerrainEditor::SMOOTH_HEIGHT)
+		Rectangle rect = getTileRectangle(texture, tile);
+		int bpp = texture->getBytesPerPixel();
+		int row_size = (rect.m_to_x - rect.m_from_x) * bpp;
+		m_buffer.resize(row_size * (rect.m_to_y - rect.m_from_y));
+		if (data.empty() ||
+			!Lumix::decompressDeltaRLE(&data[0], data.size(), bpp, &m_buffer[0], m_buffer.size()))
 		{
-			rasterSmoothHeightItem(texture, data, item);
-			return;
+			Lumix::g_log_error.log("editor") << "Corrupted terrain undo data";
+			return false;
 		}
-		else if (m_type == TerrainEditor::FLAT_HEIGHT)
+		for (int j = rect.m_from_y; j < rect.m_to_y; ++j)
 		{
-			rasterFlatHeightItem(texture, data, item);
-			return;		
+			Lumix::copyMemory(&texture->getData()[(rect.m_from_x + j * texture->getWidth()) * bpp],
+				&m_buffer[(j - rect.m_from_y) * row_size],
+				row_size);
 		}
+		return true;
+	}
 
-		ASSERT(texture->getBytesPerPixel() == 2);
-
-		int texture_width = texture->getWidth();
-		Rectangle rect;
-		rect = item.getBoundingRectangle(texture_width, texture->getHeight());
-
-		const float STRENGTH_MULTIPLICATOR = 256.0f;
-		float amount =
-			Lumix::Math::maxValue(item.m_amount * item.m_amount * STRENGTH_MULTIPLICATOR, 1.0f);
 
-		for (int i = rect.m_from_x, end = rect.m_to_x; i < end; ++i)
+	void onTileUpdated(Lumix::Texture* texture, const Tile& tile)
+	{
+		Rectangle rect = getTileRectangle(texture, tile);
+		int width = rect.m_to_x - rect.m_from_x;
+		int height = rect.m_to_y - rect.m_from_y;
+		texture->onDataUpdated(rect.m_from_x, rect.m_from_y, width, height);
+		auto* scene = static_cast<Lumix::RenderScene*>(m_terrain.scene);
+		if (m_type != TerrainEditor::LAYER && m_type != TerrainEditor::COLOR)
 		{
-			for (int j = rect.m_from_y, end2 = rect.m_to_y; j < end2; ++j)
+			scene->updateTerrainHeightBounds(
+				m_terrain.index, rect.m_from_x, rect.m_from_y, width, height);
+			Lumix::ComponentUID heightfield =
+				m_world_editor.getComponent(m_terrain.entity, HEIGHTFIELD_HASH);
+			if (heightfield.isValid())
 			{
-				float attenuation = getAttenuation(item, i, j);
-				int offset = i - m_x + (j - m_y) * m_width;
-
-				int add = int(attenuation * amount);
-				Lumix::uint16 x = ((Lumix::uint16*)texture->getData())[(i + j * texture_width)];
-				x += m_type == TerrainEditor::RAISE_HEIGHT ? Lumix::Math::minValue(add, 0xFFFF - x)
-														   : Lumix::Math::maxValue(-add, -x);
-				((Lumix::uint16*)&data[0])[offset] = x;
+				static_cast<Lumix::PhysicsScene*>(heightfield.scene)
+					->updateHeightfieldData(
+						heightfield.index, rect.m_from_x, rect.m_from_y, width, height);
 			}
 		}
 	}
 
 
-	void generateNewData()
+	// pixels of dirty tiles are already in the texture, remember them for redo
+	void storeDirtyTiles(Lumix::Texture* texture)
 	{
-		auto texture = getDestinationTexture();
-		int bpp = texture->getBytesPerPixel();
-		Rectangle rect;
-		getBoundingRectangle(texture, rect);
-		m_new_data.resize(bpp * Lumix::Math::maxValue(1,
-									 (rect.m_to_x - rect.m_from_x) *
-										 (rect.m_to_y - rect.m_from_y)));
-		Lumix::copyMemory(&m_new_data[0], &m_old_data[0], m_new_data.size());
-
-		for (int item_index = 0; item_index < m_items.size(); ++item_index)
+		for (auto& tile : m_tiles)
 		{
-			Item& item = m_items[item_index];
-			rasterItem(texture, m_new_data, item);
+			if (!tile.is_dirty) continue;
+
+			tile.is_dirty = false;
+			readTile(texture, tile, tile.new_data);
+			onTileUpdated(texture, tile);
 		}
+		m_has_dirty_tiles = false;
+		static_cast<Lumix::RenderScene*>(m_terrain.scene)->forceGrassUpdate(m_terrain.index);
+		updateHistory();
 	}
 
 
-	void saveOldData()
+	void applyTiles(Lumix::Texture* texture, bool is_undo)
 	{
-		auto texture = getDestinationTexture();
-		int bpp = texture->getBytesPerPixel();
-		Rectangle rect;
-		getBoundingRectangle(texture, rect);
-		m_x = rect.m_from_x;
-		m_y = rect.m_from_y;
-		m_width = rect.m_to_x - rect.m_from_x;
-		m_height = rect.m_to_y - rect.m_from_y;
-		m_old_data.resize(bpp * (rect.m_to_x - rect.m_from_x) *
-						  (rect.m_to_y - rect.m_from_y));
-
-		int index = 0;
-		for (int j = rect.m_from_y, end2 = rect.m_to_y; j < end2; ++j)
+		if (m_is_undo_dropped)
 		{
-			for (int i = rect.m_from_x, end = rect.m_to_x; i < end; ++i)
-			{
-				for (int k = 0; k < bpp; ++k)
-				{
-					m_old_data[index] =
-						texture->getData()[(i + j * texture->getWidth()) * bpp +
-										   k];
-					++index;
-				}
-			}
+			Lumix::g_log_warning.log("editor")
+				<< "Terrain stroke can not be " << (is_undo ? "undone" : "redone")
+				<< ", its data exceeded the terrain undo memory limit";
+			return;
 		}
-	}
-
 
-	void applyData(Lumix::Array<Lumix::uint8>& data)
-	{
-		auto texture = getDestinationTexture();
-		int bpp = texture->getBytesPerPixel();
-
-		for (int j = m_y; j < m_y + m_height; ++j)
+		for (auto& tile : m_tiles)
 		{
-			for (int i = m_x; i < m_x + m_width; ++i)
+			if (writeTile(texture, tile, is_undo ? tile.old_data : tile.new_data))
 			{
-				int index = bpp * (i + j * texture->getWidth());
-				for (int k = 0; k < bpp; ++k)
-				{
-					texture->getData()[index + k] =
-						data[bpp * (i - m_x + (j - m_y) * m_width) + k];
-				}
+				onTileUpdated(texture, tile);
 			}
 		}
-		texture->onDataUpdated(m_x, m_y, m_width, m_height);
 		static_cast<Lumix::RenderScene*>(m_terrain.scene)->forceGrassUpdate(m_terrain.index);
 	}
 
 
-	void resizeData()
+	void updateHistory()
 	{
-		Lumix::Array<Lumix::uint8> new_data(m_world_editor.getAllocator());
-		Lumix::Array<Lumix::uint8> old_data(m_world_editor.getAllocator());
-		auto texture = getDestinationTexture();
-		Rectangle rect;
-		getBoundingRectangle(texture, rect);
+		if (!m_history) return;
 
-		int new_w = rect.m_to_x - rect.m_from_x;
-		int bpp = texture->getBytesPerPixel();
-		new_data.resize(bpp * new_w * (rect.m_to_y - rect.m_from_y));
-		old_data.resize(bpp * new_w * (rect.m_to_y - rect.m_from_y));
+		auto& history = *m_history;
+		if (!m_is_in_history)
+		{
+			m_prev = history.last;
+			m_next = nullptr;
+			if (history.last) history.last->m_next = this;
+			if (!history.first) history.first = this;
+			history.last = this;
+			m_is_in_history = true;
+		}
 
-		// original
-		for (int row = rect.m_from_y; row < rect.m_to_y; ++row)
+		Lumix::int64 memory = m_tiles.size() * sizeof(Tile);
+		for (auto& tile : m_tiles)
 		{
-			Lumix::copyMemory(&new_data[(row - rect.m_from_y) * new_w * bpp],
-				&texture->getData()[row * bpp * texture->getWidth() + rect.m_from_x * bpp],
-				bpp * new_w);
-			Lumix::copyMemory(&old_data[(row - rect.m_from_y) * new_w * bpp],
-				&texture->getData()[row * bpp * texture->getWidth() + rect.m_from_x * bpp],
-				bpp * new_w);
+			memory += tile.old_data.size() + tile.new_data.size();
 		}
+		history.memory += memory - m_memory;
+		m_memory = memory;
 
-		// new
-		for (int row = 0; row < m_height; ++row)
+		// the command being executed always keeps its data
+		Settings* settings = Settings::getInstance();
+		Lumix::int64 limit = Lumix::int64(settings ? settings->m_terrain_undo_memory : 256) << 20;
+		while (history.memory > limit && history.first != this)
 		{
-			Lumix::copyMemory(&new_data[((row + m_y - rect.m_from_y) * new_w + m_x - rect.m_from_x) * bpp],
-				&m_new_data[row * bpp * m_width],
-				bpp * m_width);
-			Lumix::copyMemory(&old_data[((row + m_y - rect.m_from_y) * new_w + m_x - rect.m_from_x) * bpp],
-				&m_old_data[row * bpp * m_width],
-				bpp * m_width);
+			history.first->dropUndoData();
 		}
+	}
 
-		m_x = rect.m_from_x;
-		m_y = rect.m_from_y;
-		m_height = rect.m_to_y - rect.m_from_y;
-		m_width = rect.m_to_x - rect.m_from_x;
 
-		m_new_data.swap(new_data);
-		m_old_data.swap(old_data);
+	void dropUndoData()
+	{
+		removeFromHistory();
+		m_tiles.clear();
+		m_is_undo_dropped = true;
 	}
 
 
-	void getBoundingRectangle(Lumix::Texture* texture, Rectangle& rect)
+	void removeFromHistory()
 	{
-		Item& item = m_items[0];
-		rect.m_from_x = Lumix::Math::maxValue(int(item.m_local_pos.x - item.m_radius - 0.5f), 0);
-		rect.m_from_y = Lumix::Math::maxValue(int(item.m_local_pos.z - item.m_radius - 0.5f), 0);
-		rect.m_to_x = Lumix::Math::minValue(int(item.m_local_pos.x + item.m_radius + 0.5f),
-						   texture->getWidth());
-		rect.m_to_y = Lumix::Math::minValue(int(item.m_local_pos.z + item.m_radius + 0.5f),
-						   texture->getHeight());
-		for (int i = 1; i < m_items.size(); ++i)
-		{
-			Item& item = m_items[i];
-			rect.m_from_x = Lumix::Math::minValue(int(item.m_local_pos.x - item.m_radius - 0.5f),
-								 rect.m_from_x);
-			rect.m_to_x = Lumix::Math::maxValue(int(item.m_local_pos.x + item.m_radius + 0.5f),
-							   rect.m_to_x);
-			rect.m_from_y = Lumix::Math::minValue(int(item.m_local_pos.z - item.m_radius - 0.5f),
-								 rect.m_from_y);
-			rect.m_to_y = Lumix::Math::maxValue(int(item.m_local_pos.z + item.m_radius + 0.5f),
-							   rect.m_to_y);
-		}
-		rect.m_from_x = Lumix::Math::maxValue(rect.m_from_x, 0);
-		rect.m_to_x = Lumix::Math::minValue(rect.m_to_x, texture->getWidth());
-		rect.m_from_y = Lumix::Math::maxValue(rect.m_from_y, 0);
-		rect.m_to_y = Lumix::Math::minValue(rect.m_to_y, texture->getHeight());
+		if (!m_is_in_history) return;
+
+		auto& history = *m_history;
+		if (m_prev) m_prev->m_next = m_next;
+		else history.first = m_next;
+		if (m_next) m_next->m_prev = m_prev;
+		else history.last = m_prev;
+		history.memory -= m_memory;
+		m_memory = 0;
+		m_prev = m_next = nullptr;
+		m_is_in_history = false;
 	}
 
 
 private:
-	Lumix::Array<Lumix::uint8> m_new_data;
-	Lumix::Array<Lumix::uint8> m_old_data;
+	Lumix::Array<Tile> m_tiles;
+	Lumix::Array<Lumix::uint8> m_buffer;
 	int m_texture_idx;
-	int m_width;
-	int m_height;
-	int m_x;
-	int m_y;
 	TerrainEditor::Type m_type;
 	Lumix::Array<Item> m_items;
 	Lumix::ComponentUID m_terrain;
 	Lumix::WorldEditor& m_world_editor;
+	PaintTerrainHistory* m_history;
 	Lumix::BinaryArray m_mask;
 	Lumix::uint16 m_flat_height;
 	bool m_can_be_merged;
+	bool m_has_dirty_tiles;
+	bool m_is_undo_dropped;
+	Lumix::int64 m_memory;
+	PaintTerrainCommand* m_prev;
+	PaintTerrainCommand* m_next;
+	bool m_is_in_history;
 };
 
 
 TerrainEditor::~TerrainEditor()
 {
+	while (m_paint_history.first)
+	{
+		m_paint_history.first->detachFromHistory();
+	}
+
 	if (m_brush_texture)
 	{
 		m_brush_texture->destroy();
@@ -1153,6 +1123,9 @@ TerrainEditor::TerrainEditor(Lumix::WorldEditor& editor, Lumix::Array<Action*>&
 	, m_is_enabled(false)
 	, m_gui(nullptr)
 {
+	m_paint_history.first = m_paint_history.last = nullptr;
+	m_paint_history.memory = 0;
+
 	editor.registerEditorCommandCreator("paint_entities_on_terrain", createPaintEntitiesCommand);
 	editor.registerEditorCommandCreator("remove_entities_on_terrain", createRemoveEntitiesCommand);
 	editor.registerEditorCommandCreator("paint_terrain", createPaintTerrainCommand);
@@ -1729,6 +1702,7 @@ void TerrainEditor::paint(const Lumix::RayCastModelHit& hit,
 	PaintTerrainCommand* command =
 		LUMIX_NEW(m_world_editor.getAllocator(), PaintTerrainCommand)(
 			m_world_editor,
+			m_paint_history,
 			type,
 			m_texture_idx,
 			hit_pos,
@@ -16,6 +16,16 @@ class Texture;
 
 
 class GUIInterface;
+struct PaintTerrainCommand;
+
+
+// paint commands which still hold undo data, in the order they were executed
+struct PaintTerrainHistory
+{
+	PaintTerrainCommand* first;
+	PaintTerrainCommand* last;
+	Lumix::int64 memory;
+};
 
 
 class TerrainEditor : public Lumix::WorldEditor::Plugin
@@ -92,4 +102,5 @@ private:
 	bool m_is_rotate_z;
 	bool m_is_enabled;
 	GUIInterface* m_gui;
+	PaintTerrainHistory m_paint_history;
 };
@@ -0,0 +1,77 @@
+#include "unit_tests/suite/lumix_unit_tests.h"
+#include "core/delta_rle.h"
+#include "core/default_allocator.h"
+
+
+namespace
+{
+	const int PIXEL_COUNT = 64 * 64;
+
+
+	void expectRoundTrip(Lumix::IAllocator& allocator,
+		const Lumix::uint8* data,
+		int size,
+		int stride,
+		Lumix::Array<Lumix::uint8>& compressed)
+	{
+		Lumix::compressDeltaRLE(data, size, stride, compressed);
+
+		Lumix::Array<Lumix::uint8> decompressed(allocator);
+		decompressed.resize(size + 1);
+		LUMIX_EXPECT(Lumix::decompressDeltaRLE(
+			&compressed[0], compressed.size(), stride, &decompressed[0], size));
+		for (int i = 0; i < size; ++i)
+		{
+			LUMIX_EXPECT(decompressed[i] == data[i]);
+		}
+	}
+
+
+	void UT_delta_rle(const char* params)
+	{
+		Lumix::DefaultAllocator allocator;
+		Lumix::Array<Lumix::uint8> compressed(allocator);
+
+		// 16-bit heightmap, a slope with some noise
+		Lumix::uint16 heights[PIXEL_COUNT];
+		Lumix::uint32 seed = 12345;
+		for (int i = 0; i < PIXEL_COUNT; ++i)
+		{
+			seed = seed * 1103515245 + 12345;
+			heights[i] = Lumix::uint16(20000 + (i % 64) * 3 + ((seed >> 16) & 3));
+		}
+		expectRoundTrip(allocator, (Lumix::uint8*)heights, sizeof(heights), 2, compressed);
+		LUMIX_EXPECT(compressed.size() < (int)sizeof(heights));
+
+		// flat RGBA, compresses to a few runs
+		Lumix::uint32 colors[PIXEL_COUNT];
+		for (int i = 0; i < PIXEL_COUNT; ++i)
+		{
+			colors[i] = 0xff203040;
+		}
+		expectRoundTrip(allocator, (Lumix::uint8*)colors, sizeof(colors), 4, compressed);
+		LUMIX_EXPECT(compressed.size() < 256);
+
+		// random bytes do not compress, but must survive
+		Lumix::uint8 noise[PIXEL_COUNT];
+		for (int i = 0; i < PIXEL_COUNT; ++i)
+		{
+			seed = seed * 1103515245 + 12345;
+			noise[i] = Lumix::uint8(seed >> 16);
+		}
+		expectRoundTrip(allocator, noise, sizeof(noise), 1, compressed);
+		expectRoundTrip(allocator, noise, 1, 1, compressed);
+
+		// truncated input and wrong output size are rejected
+		Lumix::compressDeltaRLE((Lumix::uint8*)heights, sizeof(heights), 2, compressed);
+		Lumix::uint8 out[sizeof(heights)];
+		LUMIX_EXPECT(!Lumix::decompressDeltaRLE(
+			&compressed[0], compressed.size() - 1, 2, out, sizeof(heights)));
+		LUMIX_EXPECT(!Lumix::decompressDeltaRLE(
+			&compressed[0], compressed.size(), 2, out, sizeof(heights) - 2));
+		LUMIX_EXPECT(!Lumix::decompressDeltaRLE(
+			&compressed[0], compressed.size(), 2, out, sizeof(heights) - 1));
+	}
+}
+
+REGISTER_TEST("unit_tests/core/delta_rle", UT_delta_rle, "");
@@ -0,0 +1,42 @@
+#include "unit_tests/suite/lumix_unit_tests.h"
+#include "core/radix_sort.h"
+
+
+namespace
+{
+	const int COUNT = 5000;
+
+
+	void UT_radix_sort(const char* params)
+	{
+		Lumix::uint64 keys[COUNT];
+		Lumix::uint64 tmp_keys[COUNT];
+		int values[COUNT];
+		int tmp_values[COUNT];
+
+		Lumix::uint64 seed = 0x9E3779B97F4A7C15ULL;
+		for (int i = 0; i < COUNT; ++i)
+		{
+			seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+			// few distinct high parts so equal keys are common
+			keys[i] = ((seed >> 60) << 48) | (seed & 0xff00);
+			values[i] = i;
+		}
+
+		Lumix::radixSort(keys, values, tmp_keys, tmp_values, COUNT);
+
+		for (int i = 1; i < COUNT; ++i)
+		{
+			LUMIX_EXPECT(keys[i - 1] <= keys[i]);
+			if (keys[i - 1] == keys[i])
+			{
+				LUMIX_EXPECT(values[i - 1] < values[i]);
+			}
+		}
+
+		Lumix::radixSort(keys, values, tmp_keys, tmp_values, 1);
+		Lumix::radixSort(keys, values, tmp_keys, tmp_values, 0);
+	}
+}
+
+REGISTER_TEST("unit_tests/core/radix_sort", UT_radix_sort, "");
@@ -0,0 +1,75 @@
+#include "unit_tests/suite/lumix_unit_tests.h"
+#include "core/spatial_hash.h"
+
+
+namespace
+{
+	const int POINT_COUNT = 1000;
+
+
+	Lumix::Vec3 getPoint(int i)
+	{
+		// deterministic spread including negative coordinates
+		return Lumix::Vec3(float((i * 37) % 200) - 100, float((i * 11) % 20) - 10, float((i * 53) % 170) - 85);
+	}
+
+
+	void UT_spatial_hash(const char* params)
+	{
+		Lumix::DefaultAllocator allocator;
+		Lumix::SpatialHash hash(8, allocator);
+		for (int i = 0; i < POINT_COUNT; ++i)
+		{
+			hash.add(i, getPoint(i));
+		}
+		LUMIX_EXPECT(hash.getCount() == POINT_COUNT);
+
+		hash.remove(5);
+		LUMIX_EXPECT(!hash.contains(5));
+		hash.move(6, Lumix::Vec3(1000, 1000, 1000));
+		LUMIX_EXPECT(hash.getCount() == POINT_COUNT - 1);
+
+		Lumix::Vec3 center(3, 1, -7);
+		float radius = 20;
+		Lumix::Array<int> result(allocator);
+		hash.getInRadius(center, radius, result);
+		int expected_count = 0;
+		for (int i = 0; i < POINT_COUNT; ++i)
+		{
+			if (i == 5 || i == 6) continue;
+			bool is_inside = (getPoint(i) - center).squaredLength() <= radius * radius;
+			if (is_inside) ++expected_count;
+			LUMIX_EXPECT(is_inside == (result.indexOf(i) >= 0));
+		}
+		LUMIX_EXPECT(result.size() == expected_count);
+
+		result.clear();
+		hash.getInAABB(Lumix::Vec3(999, 999, 999), Lumix::Vec3(1001, 1001, 1001), result);
+		LUMIX_EXPECT(result.size() == 1);
+		LUMIX_EXPECT(result[0] == 6);
+
+		int nearest[8];
+		int count = hash.getNearest(center, 1000, Lumix::lengthOf(nearest), nearest);
+		LUMIX_EXPECT(count == Lumix::lengthOf(nearest));
+		for (int i = 1; i < count; ++i)
+		{
+			LUMIX_EXPECT((getPoint(nearest[i - 1]) - center).squaredLength() <=
+						 (getPoint(nearest[i]) - center).squaredLength());
+		}
+		float farthest = (getPoint(nearest[count - 1]) - center).squaredLength();
+		for (int i = 0; i < POINT_COUNT; ++i)
+		{
+			if (i == 5 || i == 6) continue;
+			bool is_closer = (getPoint(i) - center).squaredLength() < farthest;
+			if (!is_closer) continue;
+			bool is_found = false;
+			for (int j = 0; j < count; ++j) is_found = is_found || nearest[j] == i;
+			LUMIX_EXPECT(is_found);
+		}
+
+		count = hash.getNearest(Lumix::Vec3(1000, 1000, 1000), 1, Lumix::lengthOf(nearest), nearest);
+		LUMIX_EXPECT(count == 1);
+	}
+}
+
+REGISTER_TEST("unit_tests/core/spatial_hash", UT_spatial_hash, "")
@@ -0,0 +1,107 @@
+#include "unit_tests/suite/lumix_unit_tests.h"
+#include "core/MTJD/generic_job.h"
+#include "core/MTJD/group.h"
+#include "core/MTJD/manager.h"
+#include "universe/universe.h"
+
+
+namespace
+{
+	const int THREAD_COUNT = 8;
+	const int ENTITIES_PER_THREAD = 125000;
+
+
+	void UT_command_buffer(const char* params)
+	{
+		Lumix::DefaultAllocator allocator;
+		Lumix::Universe universe(allocator);
+		Lumix::CommandBuffer& buffer = universe.getCommandQueue().allocBuffer(0);
+
+		Lumix::Quat r(0, 0, 0, 1);
+		Lumix::Entity a = buffer.createEntity(Lumix::Vec3(1, 0, 0), r);
+		Lumix::Entity b = buffer.createEntity(Lumix::Vec3(2, 0, 0), r);
+		LUMIX_EXPECT(a != b);
+		LUMIX_EXPECT(a < Lumix::INVALID_ENTITY);
+		buffer.destroyEntity(a);
+		LUMIX_EXPECT(universe.getEntityCount() == 0);
+
+		universe.getCommandQueue().playback(universe);
+		LUMIX_EXPECT(universe.getEntityCount() == 1);
+		LUMIX_EXPECT(!universe.hasEntity(0));
+		LUMIX_EXPECT(universe.hasEntity(1));
+		LUMIX_EXPECT_CLOSE_EQ(universe.getPosition(1).x, 2.0f, 0.00001f);
+		LUMIX_EXPECT(buffer.empty());
+	}
+
+
+	void UT_command_buffer_overflow(const char* params)
+	{
+		Lumix::DefaultAllocator allocator;
+		Lumix::Universe universe(allocator);
+		Lumix::CommandQueue& queue = universe.getCommandQueue();
+
+		// equal sort keys keep the allocation order, also past the preallocated slots
+		const int BUFFER_COUNT = Lumix::CommandQueue::MAX_BUFFERS + 10;
+		Lumix::Quat r(0, 0, 0, 1);
+		for (int i = 0; i < BUFFER_COUNT; ++i)
+		{
+			queue.allocBuffer(0).createEntity(Lumix::Vec3(float(i), 0, 0), r);
+		}
+
+		queue.playback(universe);
+		LUMIX_EXPECT(universe.getEntityCount() == BUFFER_COUNT);
+		for (int i = 0; i < BUFFER_COUNT; ++i)
+		{
+			LUMIX_EXPECT_CLOSE_EQ(universe.getPosition(i).x, float(i), 0.00001f);
+		}
+	}
+
+
+	void UT_command_buffer_stress(const char* params)
+	{
+		Lumix::DefaultAllocator allocator;
+		Lumix::MTJD::Manager* manager = Lumix::MTJD::Manager::create(allocator);
+		Lumix::Universe universe(allocator);
+		Lumix::MTJD::Group sync_point(true, allocator);
+		Lumix::CommandQueue& queue = universe.getCommandQueue();
+
+		Lumix::MTJD::Job* jobs[THREAD_COUNT];
+		for (int i = 0; i < THREAD_COUNT; ++i)
+		{
+			// reverse the sort keys so the playback order differs from the scheduling order
+			Lumix::uint32 sort_key = THREAD_COUNT - 1 - i;
+			jobs[i] = Lumix::MTJD::makeJob(*manager,
+				[&queue, sort_key]()
+				{
+					Lumix::CommandBuffer& buffer = queue.allocBuffer(sort_key);
+					Lumix::Quat r(0, 0, 0, 1);
+					for (int j = 0; j < ENTITIES_PER_THREAD; ++j)
+					{
+						buffer.createEntity(Lumix::Vec3(float(sort_key), float(j), 0), r);
+					}
+				},
+				allocator);
+			jobs[i]->addDependency(&sync_point);
+		}
+		for (int i = 0; i < THREAD_COUNT; ++i)
+		{
+			manager->schedule(jobs[i]);
+		}
+		sync_point.sync();
+
+		queue.playback(universe);
+		LUMIX_EXPECT(universe.getEntityCount() == THREAD_COUNT * ENTITIES_PER_THREAD);
+		for (int i = 0; i < THREAD_COUNT * ENTITIES_PER_THREAD; i += 997)
+		{
+			const Lumix::Vec3& pos = universe.getPosition(i);
+			LUMIX_EXPECT_CLOSE_EQ(pos.x, float(i / ENTITIES_PER_THREAD), 0.00001f);
+			LUMIX_EXPECT_CLOSE_EQ(pos.y, float(i % ENTITIES_PER_THREAD), 0.00001f);
+		}
+
+		Lumix::MTJD::Manager::destroy(*manager);
+	}
+} // anonymous namespace
+
+REGISTER_TEST("unit_tests/engine/command_buffer", UT_command_buffer, "");
+REGISTER_TEST("unit_tests/engine/command_buffer_overflow", UT_command_buffer_overflow, "");
+REGISTER_TEST("unit_tests/engine/command_buffer_stress", UT_command_buffer_stress, "");
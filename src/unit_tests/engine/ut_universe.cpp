@@ -1,4 +1,9 @@
 #include "unit_tests/suite/lumix_unit_tests.h"
+#include "core/blob.h"
+#include "core/crc32.h"
+#include "core/string.h"
+#include "engine/engine.h"
+#include "universe/hierarchy.h"
 #include "universe/universe.h"
 
 
@@ -94,6 +99,181 @@ namespace
 			LUMIX_EXPECT(universe.getEntityCount() == 4 - i);
 		}
 	}
+
+	void UT_universe_delta(const char* params)
+	{
+		Lumix::DefaultAllocator allocator;
+		Lumix::Universe universe(allocator);
+
+		static const int ENTITY_COUNT = 100;
+
+		Lumix::Quat r(0, 0, 0, 1);
+		for (int i = 0; i < ENTITY_COUNT; ++i)
+		{
+			universe.createEntity(Lumix::Vec3(float(i), 0, 0), r);
+		}
+		universe.setEntityName(0, "first");
+
+		Lumix::OutputBlob baseline(allocator);
+		universe.serialize(baseline);
+
+		universe.setPosition(10, 0, 10, 0);
+		universe.destroyEntity(20);
+		Lumix::Entity created = universe.createEntity(Lumix::Vec3(1, 2, 3), r);
+		universe.setEntityName(created, "created");
+		Lumix::Entity appended = universe.createEntity(Lumix::Vec3(3, 2, 1), r);
+		universe.destroyEntity(30);
+
+		Lumix::OutputBlob current(allocator);
+		universe.serialize(current);
+
+		Lumix::OutputBlob delta(allocator);
+		Lumix::InputBlob from(baseline);
+		Lumix::InputBlob to(current);
+		Lumix::Universe::serializeDelta(from, to, delta);
+		LUMIX_EXPECT(delta.getSize() < baseline.getSize());
+
+		Lumix::Universe restored(allocator);
+		Lumix::InputBlob baseline_blob(baseline);
+		restored.deserialize(baseline_blob);
+		Lumix::Array<Lumix::Entity> created_entities(allocator);
+		Lumix::Array<Lumix::Entity> destroyed_entities(allocator);
+		Lumix::Array<Lumix::Entity> transformed(allocator);
+
+		// a truncated delta must not touch the universe
+		Lumix::InputBlob truncated_blob(delta.getData(), delta.getSize() / 2);
+		LUMIX_EXPECT(!restored.deserializeDelta(
+			truncated_blob, created_entities, destroyed_entities, transformed));
+		LUMIX_EXPECT(restored.hasEntity(30));
+		LUMIX_EXPECT(!restored.hasEntity(appended));
+
+		Lumix::InputBlob delta_blob(delta);
+		LUMIX_EXPECT(restored.deserializeDelta(
+			delta_blob, created_entities, destroyed_entities, transformed));
+
+		// the created entity reused the destroyed one's id, so it is a transformation change
+		LUMIX_EXPECT(transformed.size() == 2);
+		LUMIX_EXPECT(transformed[0] == 10);
+		LUMIX_EXPECT(transformed[1] == created);
+		LUMIX_EXPECT(destroyed_entities.size() == 1);
+		LUMIX_EXPECT(destroyed_entities[0] == 30);
+		LUMIX_EXPECT(created_entities.size() == 1);
+		LUMIX_EXPECT(created_entities[0] == appended);
+		LUMIX_EXPECT(restored.getEntityCount() == universe.getEntityCount());
+		LUMIX_EXPECT(restored.hasEntity(created));
+		LUMIX_EXPECT(restored.hasEntity(appended));
+		LUMIX_EXPECT(Lumix::compareString(restored.getEntityName(created), "created") == 0);
+		LUMIX_EXPECT(Lumix::compareString(restored.getEntityName(0), "first") == 0);
+		for (int i = 0; i < ENTITY_COUNT; ++i)
+		{
+			LUMIX_EXPECT(restored.hasEntity(i) == universe.hasEntity(i));
+			if (!universe.hasEntity(i)) continue;
+
+			Lumix::Vec3 pos = restored.getPosition(i);
+			Lumix::Vec3 expected = universe.getPosition(i);
+			LUMIX_EXPECT_CLOSE_EQ(pos.x, expected.x, 0.00001f);
+			LUMIX_EXPECT_CLOSE_EQ(pos.y, expected.y, 0.00001f);
+			LUMIX_EXPECT_CLOSE_EQ(pos.z, expected.z, 0.00001f);
+		}
+
+		Lumix::Entity next_original = universe.createEntity(Lumix::Vec3(0, 0, 0), r);
+		Lumix::Entity next_restored = restored.createEntity(Lumix::Vec3(0, 0, 0), r);
+		LUMIX_EXPECT(next_original == next_restored);
+	}
+
+
+	struct EventCounter
+	{
+		EventCounter() : created(0), destroyed(0), cmp_added(0), cmp_destroyed(0) {}
+
+		void onEntityCreated(Lumix::Entity) { ++created; }
+		void onEntityDestroyed(Lumix::Entity) { ++destroyed; }
+		void onComponentAdded(const Lumix::ComponentUID&) { ++cmp_added; }
+		void onComponentDestroyed(const Lumix::ComponentUID&) { ++cmp_destroyed; }
+
+		int created;
+		int destroyed;
+		int cmp_added;
+		int cmp_destroyed;
+	};
+
+
+	void UT_universe_snapshot(const char* params)
+	{
+		static const Lumix::uint32 HIERARCHY_HASH = Lumix::crc32("hierarchy");
+
+		Lumix::DefaultAllocator allocator;
+		Lumix::Engine* engine = Lumix::Engine::create(nullptr, allocator);
+		Lumix::UniverseContext& ctx = engine->createUniverse();
+		Lumix::Universe& universe = *ctx.m_universe;
+		auto* hierarchy = static_cast<Lumix::Hierarchy*>(ctx.getScene(HIERARCHY_HASH));
+
+		Lumix::Quat r(0, 0, 0, 1);
+		Lumix::Entity parent = universe.createEntity(Lumix::Vec3(0, 0, 0), r);
+		Lumix::Entity child = universe.createEntity(Lumix::Vec3(1, 0, 0), r);
+		Lumix::Entity other = universe.createEntity(Lumix::Vec3(2, 0, 0), r);
+		hierarchy->createComponent(HIERARCHY_HASH, child);
+		hierarchy->setParent(child, parent);
+
+		Lumix::UniverseSnapshot snapshot(allocator);
+		engine->takeSnapshot(ctx, snapshot);
+
+		universe.setPosition(other, 5, 0, 0);
+		universe.destroyEntity(child);
+		Lumix::Entity created = universe.createEntity(Lumix::Vec3(3, 0, 0), r);
+		hierarchy->createComponent(HIERARCHY_HASH, created);
+		hierarchy->setParent(created, parent);
+
+		EventCounter counter;
+		universe.entityCreated().bind<EventCounter, &EventCounter::onEntityCreated>(&counter);
+		universe.entityDestroyed().bind<EventCounter, &EventCounter::onEntityDestroyed>(&counter);
+		universe.componentAdded().bind<EventCounter, &EventCounter::onComponentAdded>(&counter);
+		universe.componentDestroyed().bind<EventCounter, &EventCounter::onComponentDestroyed>(
+			&counter);
+
+		// the created entity got the child's id, so it is restored in place
+		LUMIX_EXPECT(created == child);
+		engine->restoreSnapshot(ctx, snapshot);
+
+		LUMIX_EXPECT(counter.created == 0);
+		LUMIX_EXPECT(counter.destroyed == 0);
+		LUMIX_EXPECT(counter.cmp_added == 0);
+		LUMIX_EXPECT(counter.cmp_destroyed == 0);
+		LUMIX_EXPECT(hierarchy->getParent(child) == parent);
+		LUMIX_EXPECT_CLOSE_EQ(universe.getPosition(child).x, 1, 0.00001f);
+		LUMIX_EXPECT_CLOSE_EQ(universe.getPosition(other).x, 2, 0.00001f);
+
+		// a new entity and its component are destroyed by the restore
+		Lumix::Entity extra = universe.createEntity(Lumix::Vec3(4, 0, 0), r);
+		hierarchy->createComponent(HIERARCHY_HASH, extra);
+		hierarchy->setParent(extra, parent);
+		counter = EventCounter();
+		engine->restoreSnapshot(ctx, snapshot);
+
+		LUMIX_EXPECT(counter.created == 0);
+		LUMIX_EXPECT(counter.destroyed == 1);
+		LUMIX_EXPECT(counter.cmp_added == 0);
+		LUMIX_EXPECT(counter.cmp_destroyed == 1);
+		LUMIX_EXPECT(!universe.hasEntity(extra));
+		LUMIX_EXPECT(hierarchy->getParent(child) == parent);
+		LUMIX_EXPECT(universe.getEntityCount() == 3);
+
+		// a corrupted delta is rejected
+		Lumix::OutputBlob delta(allocator);
+		engine->serializeDelta(ctx, snapshot, delta);
+		Lumix::InputBlob truncated(delta.getData(), delta.getSize() - 1);
+		LUMIX_EXPECT(!engine->deserializeDelta(ctx, truncated));
+
+		universe.entityCreated().unbind<EventCounter, &EventCounter::onEntityCreated>(&counter);
+		universe.entityDestroyed().unbind<EventCounter, &EventCounter::onEntityDestroyed>(&counter);
+		universe.componentAdded().unbind<EventCounter, &EventCounter::onComponentAdded>(&counter);
+		universe.componentDestroyed().unbind<EventCounter, &EventCounter::onComponentDestroyed>(
+			&counter);
+		engine->destroyUniverse(ctx);
+		Lumix::Engine::destroy(engine, allocator);
+	}
 } // anonymous namespace
 
 REGISTER_TEST("unit_tests/engine/universe", UT_universe, "");
+REGISTER_TEST("unit_tests/engine/universe_delta", UT_universe_delta, "");
+REGISTER_TEST("unit_tests/engine/universe_snapshot", UT_universe_snapshot, "");
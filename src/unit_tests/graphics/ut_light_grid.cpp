@@ -0,0 +1,95 @@
+#include "unit_tests/suite/lumix_unit_tests.h"
+#include "core/math_utils.h"
+#include "renderer/light_grid.h"
+
+
+namespace
+{
+	const int LIGHT_COUNT = 200;
+	const int POINT_COUNT = 2000;
+
+
+	Lumix::Vec4 getLight(int i)
+	{
+		return Lumix::Vec4(float((i * 37) % 120) - 60,
+			float((i * 11) % 40) - 20,
+			-float((i * 53) % 150),
+			1.0f + (i % 7));
+	}
+
+
+	Lumix::Vec3 getPoint(int i)
+	{
+		return Lumix::Vec3(float((i * 29) % 100) - 50 + 0.25f,
+			float((i * 17) % 30) - 15 + 0.5f,
+			-float((i * 41) % 140) - 0.75f);
+	}
+
+
+	void UT_light_grid(const char* params)
+	{
+		Lumix::DefaultAllocator allocator;
+		Lumix::LightGrid grid(allocator);
+
+		Lumix::ComponentIndex lights[LIGHT_COUNT];
+		Lumix::Vec4 lights_pos_radius[LIGHT_COUNT];
+		for (int i = 0; i < LIGHT_COUNT; ++i)
+		{
+			lights[i] = i;
+			lights_pos_radius[i] = getLight(i);
+		}
+		lights_pos_radius[0] = Lumix::Vec4(0, 0, 10, 1);
+
+		grid.build(Lumix::Matrix::IDENTITY,
+			Lumix::Math::degreesToRadians(60),
+			16.0f / 9.0f,
+			0.1f,
+			100.0f,
+			lights,
+			lights_pos_radius,
+			LIGHT_COUNT);
+
+		for (int i = 0; i < grid.getLightCount(); ++i)
+		{
+			LUMIX_EXPECT(grid.getLight(i) != 0);
+		}
+
+		const Lumix::LightGrid::Cluster* clusters = grid.getClusters();
+		const Lumix::Array<int>& indices = grid.getIndices();
+		for (int i = 0; i < POINT_COUNT; ++i)
+		{
+			Lumix::Vec3 point = getPoint(i);
+			int cluster_index = grid.getClusterIndex(point);
+			if (cluster_index < 0) continue;
+
+			const Lumix::LightGrid::Cluster& cluster = clusters[cluster_index];
+			for (int j = 0; j < grid.getLightCount(); ++j)
+			{
+				const Lumix::Vec4& light = grid.getLightPosRadius(j);
+				if ((light.xyz() - point).squaredLength() > light.w * light.w) continue;
+
+				bool found = false;
+				for (int k = cluster.offset; k < cluster.offset + cluster.count; ++k)
+				{
+					found = found || indices[k] == j;
+				}
+				LUMIX_EXPECT(found);
+			}
+		}
+
+		Lumix::Array<int> result(allocator);
+		grid.getLights(Lumix::Vec3(0, 0, -1000), 1, result);
+		LUMIX_EXPECT(result.empty());
+
+		Lumix::Vec3 center = getLight(10).xyz();
+		grid.getLights(center, 0.5f, result);
+		bool found = false;
+		for (int light : result)
+		{
+			found = found || grid.getLight(light) == 10;
+		}
+		LUMIX_EXPECT(found);
+	}
+}
+
+REGISTER_TEST("unit_tests/graphics/light_grid", UT_light_grid, "");
@@ -0,0 +1,119 @@
+#include "unit_tests/suite/lumix_unit_tests.h"
+#include "core/array.h"
+#include "core/vec.h"
+#include "renderer/mesh_optimizer.h"
+
+
+namespace
+{
+	const int GRID_SIZE = 33;
+	const int CACHE_SIZE = 16;
+
+
+	int getVertex(int x, int z)
+	{
+		return x + z * GRID_SIZE;
+	}
+
+
+	void UT_mesh_optimizer(const char* params)
+	{
+		Lumix::DefaultAllocator allocator;
+
+		Lumix::Array<Lumix::Vec3> positions(allocator);
+		for (int z = 0; z < GRID_SIZE; ++z)
+		{
+			for (int x = 0; x < GRID_SIZE; ++x)
+			{
+				positions.push(Lumix::Vec3((float)x, 0, (float)z));
+			}
+		}
+
+		Lumix::Array<int> grid(allocator);
+		for (int z = 0; z < GRID_SIZE - 1; ++z)
+		{
+			for (int x = 0; x < GRID_SIZE - 1; ++x)
+			{
+				grid.push(getVertex(x, z));
+				grid.push(getVertex(x, z + 1));
+				grid.push(getVertex(x + 1, z));
+
+				grid.push(getVertex(x + 1, z));
+				grid.push(getVertex(x, z + 1));
+				grid.push(getVertex(x + 1, z + 1));
+			}
+		}
+
+		// triangles in scattered order, the worst case for the cache
+		int triangle_count = grid.size() / 3;
+		Lumix::Array<int> indices(allocator);
+		for (int i = 0; i < triangle_count; ++i)
+		{
+			int triangle = (i * 389) % triangle_count;
+			indices.push(grid[triangle * 3]);
+			indices.push(grid[triangle * 3 + 1]);
+			indices.push(grid[triangle * 3 + 2]);
+		}
+
+		int vertex_count = positions.size();
+		float acmr_before =
+			Lumix::computeACMR(indices.begin(), indices.size(), vertex_count, CACHE_SIZE, allocator);
+		LUMIX_EXPECT(acmr_before > 2);
+
+		Lumix::Array<int> result(allocator);
+		result.resize(indices.size());
+		Lumix::optimizeVertexCache(
+			indices.begin(), indices.size(), vertex_count, result.begin(), allocator);
+		float acmr_after =
+			Lumix::computeACMR(result.begin(), result.size(), vertex_count, CACHE_SIZE, allocator);
+		LUMIX_EXPECT(acmr_after < 1);
+
+		// the output is a permutation of the input triangles with the winding kept
+		Lumix::Array<int> triangle_uses(allocator);
+		triangle_uses.resize(triangle_count);
+		for (int i = 0; i < triangle_count; ++i) triangle_uses[i] = 0;
+		for (int i = 0; i < result.size(); i += 3)
+		{
+			for (int j = 0; j < triangle_count; ++j)
+			{
+				if (grid[j * 3] == result[i] && grid[j * 3 + 1] == result[i + 1] &&
+					grid[j * 3 + 2] == result[i + 2])
+				{
+					++triangle_uses[j];
+				}
+			}
+		}
+		for (int uses : triangle_uses)
+		{
+			LUMIX_EXPECT(uses == 1);
+		}
+
+		// clusters are moved as a whole, the cache efficiency stays close
+		Lumix::optimizeOverdraw(
+			result.begin(), result.size(), positions.begin(), vertex_count, allocator);
+		float acmr_overdraw =
+			Lumix::computeACMR(result.begin(), result.size(), vertex_count, CACHE_SIZE, allocator);
+		LUMIX_EXPECT(acmr_overdraw < 1.1f);
+
+		Lumix::Array<int> remap(allocator);
+		remap.resize(vertex_count + 1);
+		Lumix::Array<int> fetch_indices(allocator);
+		fetch_indices.resize(result.size());
+		for (int i = 0; i < result.size(); ++i) fetch_indices[i] = result[i];
+		// one extra unused vertex
+		int used_count = Lumix::optimizeVertexFetch(
+			fetch_indices.begin(), fetch_indices.size(), vertex_count + 1, remap.begin());
+		LUMIX_EXPECT(used_count == vertex_count);
+		LUMIX_EXPECT(remap[vertex_count] == -1);
+
+		int max_index = -1;
+		for (int i = 0; i < fetch_indices.size(); ++i)
+		{
+			LUMIX_EXPECT(fetch_indices[i] == remap[result[i]]);
+			LUMIX_EXPECT(fetch_indices[i] <= max_index + 1);
+			if (fetch_indices[i] > max_index) max_index = fetch_indices[i];
+		}
+	}
+}
+
+REGISTER_TEST("unit_tests/graphics/mesh_optimizer", UT_mesh_optimizer, "");
@@ -0,0 +1,106 @@
+#include "unit_tests/suite/lumix_unit_tests.h"
+#include "core/array.h"
+#include "core/vec.h"
+#include "renderer/mesh_simplifier.h"
+
+
+namespace
+{
+	const int GRID_SIZE = 17;
+
+
+	int getVertex(int x, int z)
+	{
+		return x + z * GRID_SIZE;
+	}
+
+
+	void UT_mesh_simplifier(const char* params)
+	{
+		Lumix::DefaultAllocator allocator;
+
+		// wavy grid, flat regions collapse for free, the wave costs error
+		Lumix::Array<Lumix::Vec3> positions(allocator);
+		for (int z = 0; z < GRID_SIZE; ++z)
+		{
+			for (int x = 0; x < GRID_SIZE; ++x)
+			{
+				float y = x > GRID_SIZE / 2 ? float((x + z) % 2) * 0.1f : 0;
+				positions.push(Lumix::Vec3((float)x, y, (float)z));
+			}
+		}
+
+		Lumix::Array<int> indices(allocator);
+		for (int z = 0; z < GRID_SIZE - 1; ++z)
+		{
+			for (int x = 0; x < GRID_SIZE - 1; ++x)
+			{
+				indices.push(getVertex(x, z));
+				indices.push(getVertex(x, z + 1));
+				indices.push(getVertex(x + 1, z));
+
+				indices.push(getVertex(x + 1, z));
+				indices.push(getVertex(x, z + 1));
+				indices.push(getVertex(x + 1, z + 1));
+			}
+		}
+
+		Lumix::Array<int> result(allocator);
+		result.resize(indices.size());
+		int target = indices.size() / 4;
+		int count = Lumix::simplifyMesh(positions.begin(),
+			positions.size(),
+			indices.begin(),
+			indices.size(),
+			target,
+			result.begin(),
+			allocator);
+
+		LUMIX_EXPECT(count > 0);
+		LUMIX_EXPECT(count < indices.size());
+		LUMIX_EXPECT(count % 3 == 0);
+
+		Lumix::Array<bool> is_used(allocator);
+		is_used.resize(positions.size());
+		for (int i = 0; i < is_used.size(); ++i) is_used[i] = false;
+
+		Lumix::Vec3 up(0, 1, 0);
+		for (int i = 0; i < count; i += 3)
+		{
+			int a = result[i];
+			int b = result[i + 1];
+			int c = result[i + 2];
+			LUMIX_EXPECT(a >= 0 && a < positions.size());
+			LUMIX_EXPECT(b >= 0 && b < positions.size());
+			LUMIX_EXPECT(c >= 0 && c < positions.size());
+			LUMIX_EXPECT(a != b && b != c && c != a);
+
+			// no triangle may turn over
+			Lumix::Vec3 normal =
+				Lumix::crossProduct(positions[b] - positions[a], positions[c] - positions[a]);
+			LUMIX_EXPECT(Lumix::dotProduct(normal, up) > 0);
+
+			is_used[a] = is_used[b] = is_used[c] = true;
+		}
+
+		// border vertices are locked
+		for (int i = 0; i < GRID_SIZE; ++i)
+		{
+			LUMIX_EXPECT(is_used[getVertex(i, 0)]);
+			LUMIX_EXPECT(is_used[getVertex(i, GRID_SIZE - 1)]);
+			LUMIX_EXPECT(is_used[getVertex(0, i)]);
+			LUMIX_EXPECT(is_used[getVertex(GRID_SIZE - 1, i)]);
+		}
+
+		int unchanged = Lumix::simplifyMesh(positions.begin(),
+			positions.size(),
+			indices.begin(),
+			indices.size(),
+			indices.size(),
+			result.begin(),
+			allocator);
+		LUMIX_EXPECT(unchanged == indices.size());
+	}
+}
+
+REGISTER_TEST("unit_tests/graphics/mesh_simplifier", UT_mesh_simplifier, "");
@@ -0,0 +1,131 @@
+#include "unit_tests/suite/lumix_unit_tests.h"
+#include "core/math_utils.h"
+#include "core/mtjd/generic_job.h"
+#include "core/mtjd/group.h"
+#include "core/mtjd/manager.h"
+#include "core/timer.h"
+#include "renderer/particle_system.h"
+#include "universe/universe.h"
+
+
+namespace
+{
+	const int BENCHMARK_EMITTER_COUNT = 16;
+	const int BENCHMARK_PARTICLE_COUNT = 65536;
+	const int BENCHMARK_FRAME_COUNT = 10;
+
+
+	Lumix::ParticleEmitter* createEmitter(Lumix::Entity entity,
+		Lumix::Universe& universe,
+		int particle_count,
+		float life,
+		Lumix::IAllocator& allocator)
+	{
+		auto* emitter = LUMIX_NEW(allocator, Lumix::ParticleEmitter)(entity, universe, allocator);
+		// everything spawns in the first update
+		emitter->m_spawn_count.from = emitter->m_spawn_count.to = particle_count;
+		emitter->m_spawn_period.from = emitter->m_spawn_period.to = 1000;
+		emitter->m_initial_life.from = emitter->m_initial_life.to = life;
+
+		auto* force = LUMIX_NEW(allocator, Lumix::ParticleEmitter::ForceModule)(*emitter);
+		force->m_acceleration.set(0, -10, 0);
+		emitter->addModule(force);
+		emitter->addModule(LUMIX_NEW(allocator, Lumix::ParticleEmitter::AlphaModule)(*emitter));
+		emitter->addModule(LUMIX_NEW(allocator, Lumix::ParticleEmitter::SizeModule)(*emitter));
+		return emitter;
+	}
+
+
+	void UT_particle_emitter(const char* params)
+	{
+		Lumix::DefaultAllocator allocator;
+		Lumix::Universe universe(allocator);
+		Lumix::Entity entity = universe.createEntity(Lumix::Vec3(1, 2, 3), Lumix::Quat(0, 0, 0, 1));
+
+		// not a multiple of 4, so the scalar tails run too
+		const int PARTICLE_COUNT = 1001;
+		const float TIME_DELTA = 0.1f;
+		Lumix::ParticleEmitter* emitter = createEmitter(entity, universe, PARTICLE_COUNT, 1, allocator);
+
+		emitter->update(TIME_DELTA);
+		LUMIX_EXPECT(emitter->m_position.size() == PARTICLE_COUNT);
+		emitter->update(TIME_DELTA);
+		LUMIX_EXPECT(emitter->m_position.size() == PARTICLE_COUNT);
+		for (int i = 0; i < PARTICLE_COUNT; ++i)
+		{
+			const Lumix::Vec3& pos = emitter->m_position[i];
+			const Lumix::Vec3& vel = emitter->m_velocity[i];
+			LUMIX_EXPECT(Lumix::Math::abs(pos.x - 1) < 0.0001f);
+			LUMIX_EXPECT(Lumix::Math::abs(pos.y - (2 - 10 * TIME_DELTA * TIME_DELTA)) < 0.0001f);
+			LUMIX_EXPECT(Lumix::Math::abs(pos.z - 3) < 0.0001f);
+			LUMIX_EXPECT(Lumix::Math::abs(vel.y + 20 * TIME_DELTA) < 0.0001f);
+			LUMIX_EXPECT(Lumix::Math::abs(emitter->m_rel_life[i] - 2 * TIME_DELTA) < 0.0001f);
+		}
+
+		// life is 1, after 1.2 all particles are dead
+		for (int i = 0; i < 10; ++i)
+		{
+			emitter->update(TIME_DELTA);
+		}
+		LUMIX_EXPECT(emitter->m_position.empty());
+		LUMIX_EXPECT(emitter->m_velocity.empty());
+		LUMIX_EXPECT(emitter->m_rel_life.empty());
+		LUMIX_EXPECT(emitter->m_life.empty());
+		LUMIX_EXPECT(emitter->m_size.empty());
+		LUMIX_EXPECT(emitter->m_alpha.empty());
+		LUMIX_EXPECT(emitter->m_rotation.empty());
+		LUMIX_EXPECT(emitter->m_rotational_speed.empty());
+
+		LUMIX_DELETE(allocator, emitter);
+	}
+
+
+	void UT_particle_emitter_benchmark(const char* params)
+	{
+		Lumix::DefaultAllocator allocator;
+		Lumix::Universe universe(allocator);
+		Lumix::Entity entity = universe.createEntity(Lumix::Vec3(0, 0, 0), Lumix::Quat(0, 0, 0, 1));
+		Lumix::MTJD::Manager* mtjd_manager = Lumix::MTJD::Manager::create(allocator);
+
+		Lumix::ParticleEmitter* emitters[BENCHMARK_EMITTER_COUNT];
+		for (auto& emitter : emitters)
+		{
+			emitter = createEmitter(entity, universe, BENCHMARK_PARTICLE_COUNT, 100, allocator);
+			emitter->update(0.01f);
+		}
+
+		Lumix::Timer* timer = Lumix::Timer::create(allocator);
+		for (int frame = 0; frame < BENCHMARK_FRAME_COUNT; ++frame)
+		{
+			// same scheduling as RenderScene::update
+			Lumix::MTJD::Group sync_point(true, allocator);
+			for (auto* emitter : emitters)
+			{
+				Lumix::MTJD::Job* job = Lumix::MTJD::makeJob(*mtjd_manager,
+					[emitter]() { emitter->update(0.01f); },
+					allocator);
+				job->addDependency(&sync_point);
+				mtjd_manager->schedule(job);
+			}
+			sync_point.sync();
+		}
+		float time = timer->getTimeSinceStart();
+		Lumix::Timer::destroy(timer);
+
+		int particle_count = 0;
+		for (auto* emitter : emitters)
+		{
+			particle_count += emitter->m_position.size();
+			LUMIX_DELETE(allocator, emitter);
+		}
+		LUMIX_EXPECT(particle_count == BENCHMARK_EMITTER_COUNT * BENCHMARK_PARTICLE_COUNT);
+
+		Lumix::g_log_info.log("unit") << particle_count << " particles updated in "
+									  << time * 1000 / BENCHMARK_FRAME_COUNT << " ms per frame";
+
+		Lumix::MTJD::Manager::destroy(*mtjd_manager);
+	}
+}
+
+REGISTER_TEST("unit_tests/graphics/particle_emitter", UT_particle_emitter, "");
+REGISTER_TEST("unit_tests/graphics/particle_emitter_benchmark", UT_particle_emitter_benchmark, "benchmark");
@@ -0,0 +1,147 @@
+#include "unit_tests/suite/lumix_unit_tests.h"
+#include "core/array.h"
+#include "core/log.h"
+#include "core/math_utils.h"
+#include "core/mtjd/manager.h"
+#include "core/timer.h"
+#include "renderer/terrain_brush.h"
+#include <cmath>
+
+
+namespace
+{
+	const int BENCHMARK_SIZE = 4096;
+	const int BENCHMARK_STAMP_COUNT = 1000;
+	const float BENCHMARK_RADIUS = 128;
+
+
+	Lumix::TerrainBrush::Stamp makeStamp(float x, float z, float radius, float amount, int size)
+	{
+		Lumix::TerrainBrush::Stamp stamp;
+		stamp.x = x;
+		stamp.z = z;
+		stamp.radius = radius;
+		stamp.amount = amount;
+		stamp.from_x = Lumix::Math::maxValue(0, int(x - radius - 0.5f));
+		stamp.from_z = Lumix::Math::maxValue(0, int(z - radius - 0.5f));
+		stamp.to_x = Lumix::Math::minValue(size, int(x + radius + 0.5f));
+		stamp.to_z = Lumix::Math::minValue(size, int(z + radius + 0.5f));
+		return stamp;
+	}
+
+
+	void fillNoise(Lumix::Array<Lumix::uint16>& heights, int size)
+	{
+		heights.resize(size * size);
+		Lumix::uint32 seed = 12345;
+		for (auto& height : heights)
+		{
+			seed = seed * 1103515245 + 12345;
+			height = Lumix::uint16(30000 + ((seed >> 16) & 4095));
+		}
+	}
+
+
+	void UT_terrain_brush(const char* params)
+	{
+		Lumix::DefaultAllocator allocator;
+		Lumix::MTJD::Manager* mtjd_manager = Lumix::MTJD::Manager::create(allocator);
+		Lumix::TerrainBrush serial_brush(nullptr, allocator);
+		Lumix::TerrainBrush parallel_brush(mtjd_manager, allocator);
+
+		// width is not a multiple of 8, so the scalar tails of the SIMD rows run too
+		const int SIZE = 1021;
+		Lumix::Array<Lumix::uint16> serial(allocator);
+		Lumix::Array<Lumix::uint16> parallel(allocator);
+		Lumix::Array<Lumix::uint16> reference(allocator);
+		fillNoise(serial, SIZE);
+		fillNoise(parallel, SIZE);
+		fillNoise(reference, SIZE);
+
+		// smooth matches a plain per pixel implementation, with and without workers
+		auto stamp = makeStamp(500.3f, 400.7f, 301, 0.6f, SIZE);
+		serial_brush.smoothHeight(&serial[0], SIZE, stamp);
+		parallel_brush.smoothHeight(&parallel[0], SIZE, stamp);
+
+		Lumix::uint64 sum = 0;
+		for (int j = stamp.from_z; j < stamp.to_z; ++j)
+		{
+			for (int i = stamp.from_x; i < stamp.to_x; ++i)
+			{
+				sum += reference[i + j * SIZE];
+			}
+		}
+		int count = (stamp.to_x - stamp.from_x) * (stamp.to_z - stamp.from_z);
+		float avg = float(Lumix::uint16(sum / count));
+		for (int j = stamp.from_z; j < stamp.to_z; ++j)
+		{
+			for (int i = stamp.from_x; i < stamp.to_x; ++i)
+			{
+				float dx = stamp.x - 0.5f - i;
+				float dz = stamp.z - 0.5f - j;
+				float attenuation =
+					1 - Lumix::Math::minValue(sqrtf(dx * dx + dz * dz) / stamp.radius, 1.0f);
+				Lumix::uint16& height = reference[i + j * SIZE];
+				height = Lumix::uint16(height + int((avg - height) * stamp.amount * attenuation));
+			}
+		}
+		for (int i = 0; i < SIZE * SIZE; ++i)
+		{
+			LUMIX_EXPECT(serial[i] == reference[i]);
+			LUMIX_EXPECT(parallel[i] == reference[i]);
+		}
+
+		// flatten writes exactly the stamp rectangle
+		stamp = makeStamp(3, 1000, 200, 1, SIZE);
+		parallel_brush.flattenHeight(&parallel[0], SIZE, stamp, 1234);
+		for (int j = 0; j < SIZE; ++j)
+		{
+			for (int i = 0; i < SIZE; ++i)
+			{
+				bool is_in = i >= stamp.from_x && i < stamp.to_x && j >= stamp.from_z && j < stamp.to_z;
+				LUMIX_EXPECT(is_in == (parallel[i + j * SIZE] == 1234));
+			}
+		}
+
+		// raising and lowering saturates
+		serial_brush.addHeight(&serial[0], SIZE, stamp, 100000);
+		LUMIX_EXPECT(serial[3 + 1000 * SIZE] == 0xffff);
+		serial_brush.addHeight(&serial[0], SIZE, stamp, -100000);
+		LUMIX_EXPECT(serial[3 + 1000 * SIZE] == 0);
+
+		Lumix::MTJD::Manager::destroy(*mtjd_manager);
+	}
+
+
+	void UT_terrain_brush_benchmark(const char* params)
+	{
+		Lumix::DefaultAllocator allocator;
+		Lumix::MTJD::Manager* mtjd_manager = Lumix::MTJD::Manager::create(allocator);
+		Lumix::TerrainBrush brush(mtjd_manager, allocator);
+		Lumix::Array<Lumix::uint16> heights(allocator);
+		fillNoise(heights, BENCHMARK_SIZE);
+
+		Lumix::Timer* timer = Lumix::Timer::create(allocator);
+		Lumix::uint32 seed = 54321;
+		for (int i = 0; i < BENCHMARK_STAMP_COUNT; ++i)
+		{
+			seed = seed * 1103515245 + 12345;
+			float x = float((seed >> 8) % BENCHMARK_SIZE);
+			seed = seed * 1103515245 + 12345;
+			float z = float((seed >> 8) % BENCHMARK_SIZE);
+			auto stamp = makeStamp(x, z, BENCHMARK_RADIUS, 0.5f, BENCHMARK_SIZE);
+			brush.smoothHeight(&heights[0], BENCHMARK_SIZE, stamp);
+		}
+		float time = timer->getTimeSinceStart();
+		Lumix::Timer::destroy(timer);
+
+		Lumix::g_log_info.log("unit") << BENCHMARK_STAMP_COUNT << " smooth stamps on a "
+									  << BENCHMARK_SIZE << "x" << BENCHMARK_SIZE
+									  << " heightmap in " << time * 1000 << " ms";
+
+		Lumix::MTJD::Manager::destroy(*mtjd_manager);
+	}
+}
+
+REGISTER_TEST("unit_tests/graphics/terrain_brush", UT_terrain_brush, "");
+REGISTER_TEST("unit_tests/graphics/terrain_brush_benchmark", UT_terrain_brush_benchmark, "benchmark");
@@ -0,0 +1,89 @@
+#include "unit_tests/suite/lumix_unit_tests.h"
+#include "core/crc32.h"
+#include "core/log.h"
+#include "core/math_utils.h"
+#include "core/mtjd/manager.h"
+#include "core/quat.h"
+#include "core/timer.h"
+#include "engine/engine.h"
+#include "engine/plugin_manager.h"
+#include "physics/physics_scene.h"
+#include "physics/physics_system.h"
+#include "universe/universe.h"
+
+
+namespace
+{
+	// 10 x 10 columns, 50 boxes high
+	const int STACK_SIDE = 10;
+	const int STACK_HEIGHT = 50;
+	const int FRAME_COUNT = 100;
+	const float FRAME_TIME = 0.01f;
+
+
+	float simulateStack(Lumix::Engine& engine, Lumix::PhysicsSystem& system, int worker_count)
+	{
+		static const Lumix::uint32 BOX_ACTOR_HASH = Lumix::crc32("box_rigid_actor");
+
+		system.setWorkerCount(worker_count);
+		Lumix::UniverseContext& ctx = engine.createUniverse();
+		auto* scene = static_cast<Lumix::PhysicsScene*>(ctx.getScene(Lumix::crc32("physics")));
+		Lumix::Universe& universe = *ctx.m_universe;
+		Lumix::Quat rot(0, 0, 0, 1);
+
+		Lumix::Entity ground = universe.createEntity(Lumix::Vec3(0, -0.5f, 0), rot);
+		Lumix::ComponentIndex cmp = scene->createComponent(BOX_ACTOR_HASH, ground);
+		scene->setHalfExtents(cmp, Lumix::Vec3(100, 0.5f, 100));
+
+		for (int k = 0; k < STACK_HEIGHT; ++k)
+		{
+			for (int j = 0; j < STACK_SIDE; ++j)
+			{
+				for (int i = 0; i < STACK_SIDE; ++i)
+				{
+					Lumix::Vec3 pos(i * 1.1f, 0.5f + k, j * 1.1f);
+					Lumix::Entity entity = universe.createEntity(pos, rot);
+					cmp = scene->createComponent(BOX_ACTOR_HASH, entity);
+					scene->setHalfExtents(cmp, Lumix::Vec3(0.5f, 0.5f, 0.5f));
+					scene->setIsDynamic(cmp, true);
+				}
+			}
+		}
+		engine.startGame(ctx);
+
+		Lumix::Timer* timer = Lumix::Timer::create(engine.getAllocator());
+		for (int i = 0; i < FRAME_COUNT; ++i)
+		{
+			scene->update(FRAME_TIME);
+		}
+		float time = timer->getTimeSinceStart();
+		Lumix::Timer::destroy(timer);
+
+		engine.destroyUniverse(ctx);
+		return time;
+	}
+
+
+	void UT_rigid_body_stack_benchmark(const char* params)
+	{
+		Lumix::DefaultAllocator allocator;
+		Lumix::Engine* engine = Lumix::Engine::create(nullptr, allocator);
+		auto* system = static_cast<Lumix::PhysicsSystem*>(engine->getPluginManager().load("physics"));
+		LUMIX_EXPECT(system != nullptr);
+		if (system)
+		{
+			int max_workers = (int)engine->getMTJDManager().getCpuThreadsCount();
+			for (int worker_count = 1;; worker_count = Lumix::Math::minValue(worker_count * 2, max_workers))
+			{
+				float time = simulateStack(*engine, *system, worker_count);
+				Lumix::g_log_info.log("unit") << STACK_SIDE * STACK_SIDE * STACK_HEIGHT << " rigid bodies, "
+											  << worker_count << " workers: "
+											  << time * 1000 / FRAME_COUNT << " ms per step";
+				if (worker_count == max_workers) break;
+			}
+		}
+		Lumix::Engine::destroy(engine, allocator);
+	}
+}
+
+REGISTER_TEST("unit_tests/physics/rigid_body_stack_benchmark", UT_rigid_body_stack_benchmark, "benchmark");
@@ -42,7 +42,8 @@ namespace Lumix
 		void App::run(int argc, const char *argv[])
 		{
 			Manager::instance().dumpTests();
-			Manager::instance().runTests("*");
+			// e.g. "*_benchmark" runs the benchmarks, which the default "*" skips
+			Manager::instance().runTests(argc > 1 ? argv[1] : "*");
 			Manager::instance().dumpResults();
 		}
 
@@ -120,7 +120,10 @@ namespace Lumix
 					if(i < c)
 					{
 						UnitTestPair& pair = m_unit_tests[i];
-						if (shouldTest(string(pair.name, m_allocator), string(filter_tests, m_allocator)))
+						bool is_benchmark = compareString(pair.parameters, "benchmark") == 0;
+						bool is_filtered = compareString(filter_tests, "*") != 0;
+						if ((!is_benchmark || is_filtered) &&
+							shouldTest(string(pair.name, m_allocator), string(filter_tests, m_allocator)))
 						{
 							AsynTest* test = m_trans_queue.alloc(false);
 							if (test)
@@ -291,6 +294,7 @@ namespace Lumix
 		// "*test_name" -> runs all tests ending with test_names
 		// test_name* -> runs all tests beggining with test_name
 		// test_name -> runs all tests matching test_name
+		// tests registered with "benchmark" params are not run by "*"
 		void Manager::runTests(const char *filter_tests)
 		{
 			m_impl->runTests(filter_tests);